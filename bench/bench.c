@@ -0,0 +1,1178 @@
+/*
+ *  `bench.c` - Decode throughput of every read API over synthetic LAS files.
+ *
+ *  Generates one file per point format (0 - 5) with the streaming writer, then times the simple, granular, columnar
+ *  and file APIs from memory and through `laserIoReadFn`, for several attribute subsets and strides. The writer cases
+ *  encode the decoded points back into records, from the interleaved and the column layout, into a sink that drops
+ *  them (source `discard`), so they time the encoding alone. The cursor cases read XYZ through a read callback slowed
+ *  down to a given bandwidth (source `io_slow`), once sequentially and once pipelined, where the next read overlaps the
+ *  decode. `file_generic` reads XYZ and the common attributes through the scalar fused kernel and `file_flags` through
+ *  the per-point loop branching on every attribute flag that reads used before plans, the speedup of the first over the
+ *  second goes to stderr. The `file_parallel` cases decode from memory over a thread pool of 1, 2, 4, ... up to `-t` threads (column
+ *  `threads`, 1 for every other case). The kNN cases time an 8 nearest neighbour search over XYZ in file order, in a
+ *  random order and after sorting the points along a Morton or Hilbert curve, the `sort_*` cases time that sort (keys,
+ *  radix sort and reading the points back in curve order). The generated files are in acquisition order, which is
+ *  already local, the random order stands in for merged or reprocessed files. The geometry doesn't depend on the point
+ *  format, the kNN cases only run for the first format. Results go to stdout as CSV, one line per case, progress and notes go to stderr.
+ *
+ *  USAGE:
+ *      bench [-n POINTS] [-f FORMATS] [-r REPEATS] [-w WINDOW] [-o DIR] [-m MIB] [-b MBPS] [-t THREADS] [-s SEED]
+ *
+ *          -n POINTS   Points per file, accepts k, m and g suffixes, defaults to 2m.
+ *          -f FORMATS  Point formats, e.g. `0-5` (default) or `1,3`.
+ *          -r REPEATS  Runs per case, the best and mean are reported, defaults to 5.
+ *          -w WINDOW   Points decoded per call, bounds the output buffers, defaults to 1m.
+ *          -o DIR      Write the files to DIR (reused when present) instead of memory, IO cases then read the disk.
+ *          -m MIB      With `-o`, files up to this size are also loaded for the memory cases, defaults to 2048.
+ *          -b MBPS     Bandwidth of the slowed read callback in MB/s, defaults to 1000, `0` skips the cursor cases.
+ *          -t THREADS  Most threads of the parallel cases, defaults to the number of CPUs, `0` skips them.
+ *          -s SEED     Generator seed, defaults to 1.
+ *
+ *  Formats 0 and 1 are written as LAS 1.0, 2 and 3 as 1.2 and 4 and 5 as 1.3. `gb_per_s` counts the point records
+ *  read (`points * point_size`), so it is comparable across attribute subsets. Files on disk are read through the
+ *  page cache, drop it between runs for cold numbers. The pipelined cursor and the parallel cases need `LASER_PTHREADS`,
+ *  they are left out on Windows.
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if !defined(_WIN32)
+#define LASER_PTHREADS
+#endif
+
+#define LASER_IMPL
+#include "../laser.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_BATCH 65536
+#define BENCH_MAX_ATTRIBS 20
+#define BENCH_KNN_K 8
+#define BENCH_KNN_CELL_POINTS 4
+#define BENCH_PI 3.14159265358979323846
+
+typedef struct BenchPoint {
+    double x, y, z;
+    double gps_time;
+    uint64_t waveform_offset;
+    uint32_t waveform_size;
+    float waveform_location;
+    float x_t, y_t, z_t;
+    uint16_t intensity;
+    uint16_t point_id;
+    uint16_t red, green, blue;
+    uint8_t flags;
+    uint8_t classification;
+    int8_t scan_angle;
+    uint8_t usr;
+    uint8_t waveform_id;
+} BenchPoint;
+
+typedef struct BenchSink {
+    uint8_t* data;
+    FILE* file;
+    uint32_t version_minor;
+} BenchSink;
+
+typedef struct BenchSource {
+    uint8_t* data;
+    uint64_t size;
+    int on_disk;
+    double bandwidth;                                   /* Bytes per second of `bench_read_slow`. */
+#if defined(_WIN32)
+    HANDLE file;
+#else
+    int file;
+#endif
+} BenchSource;
+
+typedef struct BenchSubset {
+    const char* name;
+    laserAttribType types[BENCH_MAX_ATTRIBS];
+} BenchSubset;
+
+typedef struct BenchCase {
+    const char* api;
+    const char* source;
+    const char* attribs;
+    uint64_t stride;
+    double best;
+    double total;
+} BenchCase;
+
+typedef struct BenchContext {
+    BenchSource source;
+    laserInfo info;
+    uint64_t window;
+    uint8_t* output;
+    uint64_t output_size;
+    uint8_t* writer_buffer;
+    uint64_t writer_buffer_size;
+    uint8_t* scratch;
+    uint64_t scratch_size;
+    laserScheduler scheduler;
+    uint32_t threads;
+    uint32_t max_threads;
+    int knn;
+    int repeats;
+} BenchContext;
+
+static const laserAttribType BENCH_TYPES[] = {
+    LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_INTENSITY, LASER_ATTRIB_TYPE_FLAGS,
+    LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_ATTRIB_TYPE_SCAN_ANGLE, LASER_ATTRIB_TYPE_USR, LASER_ATTRIB_TYPE_POINT_ID,
+    LASER_ATTRIB_TYPE_GPS_TIME, LASER_ATTRIB_TYPE_RED, LASER_ATTRIB_TYPE_GREEN, LASER_ATTRIB_TYPE_BLUE,
+    LASER_ATTRIB_TYPE_WAVEFORM_ID, LASER_ATTRIB_TYPE_WAVEFORM_OFFSET, LASER_ATTRIB_TYPE_WAVEFORM_SIZE,
+    LASER_ATTRIB_TYPE_WAVEFORM_LOCATION, LASER_ATTRIB_TYPE_X_TIME, LASER_ATTRIB_TYPE_Y_TIME, LASER_ATTRIB_TYPE_Z_TIME,
+};
+
+/* Decoded sizes of `BENCH_TYPES`, as documented on `laserAttribType`. */
+static const uint64_t BENCH_TYPE_SIZES[] = { 4, 4, 4, 2, 1, 1, 1, 1, 2, 8, 2, 2, 2, 1, 8, 4, 4, 4, 4, 4 };
+
+static const uint64_t BENCH_POINT_SIZES[6] = { 20, 28, 26, 34, 57, 63 };
+static const uint32_t BENCH_VERSIONS[6] = { 0, 0, 2, 2, 3, 3 };
+
+static uint64_t bench_type_size(laserAttribType type) {
+    for(uint32_t i = 0; i < sizeof(BENCH_TYPES) / sizeof(BENCH_TYPES[0]); i++) {
+        if(BENCH_TYPES[i] == type) {
+            return BENCH_TYPE_SIZES[i];
+        }
+    }
+    return 0;
+}
+
+static int bench_format_has(uint32_t format, laserAttribType type) {
+    switch(type) {
+        case LASER_ATTRIB_TYPE_GPS_TIME:
+            return format == 1 || format >= 3;
+        case LASER_ATTRIB_TYPE_RED:
+        case LASER_ATTRIB_TYPE_GREEN:
+        case LASER_ATTRIB_TYPE_BLUE:
+            return format == 2 || format == 3 || format == 5;
+        case LASER_ATTRIB_TYPE_WAVEFORM_ID:
+        case LASER_ATTRIB_TYPE_WAVEFORM_OFFSET:
+        case LASER_ATTRIB_TYPE_WAVEFORM_SIZE:
+        case LASER_ATTRIB_TYPE_WAVEFORM_LOCATION:
+        case LASER_ATTRIB_TYPE_X_TIME:
+        case LASER_ATTRIB_TYPE_Y_TIME:
+        case LASER_ATTRIB_TYPE_Z_TIME:
+            return format >= 4;
+        default:
+            return 1;
+    }
+}
+
+/* Every attribute of `format` when `subset` is `0`, otherwise the subset. Returns the packed size of one point. */
+static uint64_t bench_attribs(laserAttrib* attribs, const BenchSubset* subset, uint32_t format) {
+    uint32_t count = 0;
+    uint64_t offset = 0;
+    for(uint32_t i = 0; i < BENCH_MAX_ATTRIBS; i++) {
+        laserAttribType type = subset ? subset->types[i]: BENCH_TYPES[i];
+        if(type == LASER_ATTRIB_TYPE_NONE) {
+            break;
+        } else if(bench_format_has(format, type)) {
+            attribs[count].type = type;
+            attribs[count].offset = offset;
+            offset += bench_type_size(type);
+            count++;
+        }
+    }
+    attribs[count].type = LASER_ATTRIB_TYPE_NONE;
+    attribs[count].offset = 0;
+    return offset;
+}
+
+/*
+ *  Synthetic airborne survey: a scanner sweeping across alternating flight lines over rolling terrain, with forest,
+ *  buildings and water. Pulses produce up to four returns in acquisition order, so neighbouring records are close in
+ *  space and time like in real files.
+ */
+
+typedef struct BenchScan {
+    uint64_t rng;
+    uint64_t pulse;
+    uint64_t pulses_per_line;
+} BenchScan;
+
+enum {
+    BENCH_GROUND,
+    BENCH_FOREST,
+    BENCH_BUILDING,
+    BENCH_WATER
+};
+
+static uint64_t bench_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double bench_uniform(uint64_t* state) {
+    return (double) (bench_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t bench_hash(int64_t x, int64_t y) {
+    uint64_t h = (uint64_t) x * 0x9E3779B97F4A7C15ull ^ (uint64_t) y * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return (uint32_t) (h >> 32);
+}
+
+static double bench_terrain(double x, double y) {
+    return 120.0 + 40.0 * sin(x / 430.0) * cos(y / 610.0) + 8.0 * sin((x + y) / 97.0) + 1.5 * sin(x / 13.0) * cos(y / 17.0);
+}
+
+/* Land cover on a 10 m grid, buildings cluster into blocks of 4 x 4 cells, vegetation is trees or shrubs. */
+static uint32_t bench_cover(double x, double y, double* height) {
+    int64_t cx = (int64_t) floor(x / 10.0), cy = (int64_t) floor(y / 10.0);
+    uint32_t block = bench_hash(cx >> 2, cy >> 2) % 100;
+    uint32_t cell = bench_hash(cx, cy);
+    if(block < 8) {
+        *height = 6.0 + (double) (bench_hash(cx >> 2, (cy >> 2) + 7919) % 900) / 100.0;
+        return BENCH_BUILDING;
+    } else if(block < 12 && bench_terrain(x, y) < 95.0) {
+        return BENCH_WATER;
+    } else if(cell % 100 < 25) {
+        *height = 8.0 + (double) (cell % 1700) / 100.0;
+        return BENCH_FOREST;
+    } else if(cell % 100 < 35) {
+        *height = 0.5 + (double) (cell % 250) / 100.0;
+        return BENCH_FOREST;
+    }
+    return BENCH_GROUND;
+}
+
+static uint16_t bench_clamp16(double value) {
+    return (uint16_t) (value < 0.0 ? 0.0: (value > 65535.0 ? 65535.0: value));
+}
+
+static void bench_colour(BenchPoint* point, uint32_t cover, uint64_t* rng) {
+    static const double palette[4][3] = { { 120, 100, 70 }, { 40, 95, 35 }, { 150, 140, 135 }, { 30, 60, 110 } };
+    double shade = 0.8 + 0.4 * bench_uniform(rng);
+    point->red = bench_clamp16(palette[cover][0] * shade * 257.0);
+    point->green = bench_clamp16(palette[cover][1] * shade * 257.0);
+    point->blue = bench_clamp16(palette[cover][2] * shade * 257.0);
+}
+
+/* Emits the returns of the next pulse into `points`, at most `capacity` of them. */
+static uint32_t bench_pulse(BenchScan* scan, BenchPoint* points, uint32_t capacity) {
+    const double rate = 200000.0, speed = 60.0, frequency = 50.0, swath = 400.0, altitude = 1000.0, spacing = 300.0;
+    uint64_t line = scan->pulse / scan->pulses_per_line;
+    double t = (double) (scan->pulse % scan->pulses_per_line) / rate;
+    double phase = sin(2.0 * BENCH_PI * frequency * t);
+    double along = speed * t;
+    double across = 0.5 * swath * phase;
+    double x = 500000.0 + (double) line * spacing + across;
+    double y = 4000000.0 + ((line & 1) ? speed * (double) scan->pulses_per_line / rate - along: along);
+    double angle = atan(across / altitude) * 180.0 / BENCH_PI;
+    uint32_t direction = cos(2.0 * BENCH_PI * frequency * t) > 0.0;
+    uint32_t edge = fabs(phase) > 0.999;
+
+    double height = 0.0;
+    uint32_t cover = bench_cover(x, y, &height);
+    double ground = bench_terrain(x, y) + 0.05 * (bench_uniform(&scan->rng) - 0.5);
+    double z[4];
+    uint32_t classes[4];
+    uint32_t count = 1;
+    if(cover == BENCH_FOREST) {
+        count = 1 + (uint32_t) (bench_random(&scan->rng) % 4);
+        double top = ground + height * (0.7 + 0.3 * bench_uniform(&scan->rng));
+        for(uint32_t i = 0; i < count; i++) {
+            int last = i + 1 == count && count > 1;
+            z[i] = last ? ground: top - (top - ground) * (double) i / (double) count * bench_uniform(&scan->rng);
+            classes[i] = last ? 2: (z[i] - ground > 5.0 ? 5: (z[i] - ground > 2.0 ? 4: 3));
+        }
+    } else if(cover == BENCH_BUILDING) {
+        z[0] = ground + height;
+        classes[0] = 6;
+    } else {
+        z[0] = cover == BENCH_WATER ? 95.0: ground;
+        classes[0] = cover == BENCH_WATER ? 9: 2;
+    }
+    if(bench_random(&scan->rng) % 1000 == 0) {
+        z[0] += (bench_random(&scan->rng) & 1) ? 150.0: -40.0;
+        classes[0] = 7;
+    }
+
+    static const double intensities[4] = { 18000.0, 9000.0, 25000.0, 2000.0 };
+    count = count < capacity ? count: capacity;
+    for(uint32_t i = 0; i < count; i++) {
+        BenchPoint* point = points + i;
+        uint32_t own = classes[i] == 2 ? BENCH_GROUND: (classes[i] == 6 ? BENCH_BUILDING: (classes[i] == 9 ? BENCH_WATER: BENCH_FOREST));
+        memset(point, 0, sizeof(BenchPoint));
+        point->x = x + 0.02 * (bench_uniform(&scan->rng) - 0.5);
+        point->y = y + 0.02 * (bench_uniform(&scan->rng) - 0.5);
+        point->z = z[i];
+        point->gps_time = 300000000.0 + (double) scan->pulse / rate;
+        point->intensity = bench_clamp16((intensities[own] + 4000.0 * (bench_uniform(&scan->rng) - 0.5)) / (double) (i + 1));
+        point->flags = (uint8_t) ((i + 1) | (count << 3) | (direction << 6) | (edge << 7));
+        point->classification = (uint8_t) classes[i];
+        point->scan_angle = (int8_t) floor(angle + 0.5);
+        point->point_id = (uint16_t) (line + 1);
+        bench_colour(point, own, &scan->rng);
+        point->waveform_id = 1;
+        point->waveform_offset = 1024 + scan->pulse * 256;
+        point->waveform_size = 256;
+        point->waveform_location = (float) ((altitude + 120.0 - z[i]) * 6671.28);
+        point->x_t = (float) (across / altitude * 1e-4);
+        point->y_t = 0.0f;
+        point->z_t = -1e-4f;
+    }
+    scan->pulse++;
+    return count;
+}
+
+static uint64_t bench_write(void* usr, const void* data, uint64_t size, uint64_t offset) {
+    BenchSink* sink = (BenchSink*) usr;
+    /* The writer has no 1.0 (`version_minor` 0 picks the default), 1.1 shares its header layout. */
+    int patch = offset == 0 && size > 25 && sink->version_minor == 0;
+    if(!sink->file) {
+        memcpy(sink->data + offset, data, size);
+        if(patch) {
+            sink->data[25] = 0;
+        }
+        return size;
+    }
+
+#if defined(_WIN32)
+    _fseeki64(sink->file, (__int64) offset, SEEK_SET);
+#else
+    fseeko(sink->file, (off_t) offset, SEEK_SET);
+#endif
+    uint64_t written = fwrite(data, 1, size, sink->file);
+    if(patch && written == size) {
+        fseek(sink->file, 25, SEEK_SET);
+        written = fputc(0, sink->file) == 0 ? size: 0;
+    }
+    return written;
+}
+
+static laserResult bench_generate(BenchSink* sink, uint32_t format, uint64_t point_count, uint64_t seed) {
+    laserWriterInfo info;
+    memset(&info, 0, sizeof(info));
+    info.version_minor = BENCH_VERSIONS[format] ? BENCH_VERSIONS[format]: 1;
+    info.point_format = format;
+    info.flags = LASER_WRITER_DOUBLE_XYZ;
+    info.scale_x = info.scale_y = info.scale_z = 0.01;
+    info.offset_x = 500000.0;
+    info.offset_y = 4000000.0;
+    sink->version_minor = BENCH_VERSIONS[format];
+
+    laserAttrib attribs[BENCH_MAX_ATTRIBS + 1];
+    uint32_t count = 0;
+    static const uint64_t offsets[] = {
+        offsetof(BenchPoint, x), offsetof(BenchPoint, y), offsetof(BenchPoint, z), offsetof(BenchPoint, intensity),
+        offsetof(BenchPoint, flags), offsetof(BenchPoint, classification), offsetof(BenchPoint, scan_angle),
+        offsetof(BenchPoint, usr), offsetof(BenchPoint, point_id), offsetof(BenchPoint, gps_time),
+        offsetof(BenchPoint, red), offsetof(BenchPoint, green), offsetof(BenchPoint, blue),
+        offsetof(BenchPoint, waveform_id), offsetof(BenchPoint, waveform_offset), offsetof(BenchPoint, waveform_size),
+        offsetof(BenchPoint, waveform_location), offsetof(BenchPoint, x_t), offsetof(BenchPoint, y_t), offsetof(BenchPoint, z_t),
+    };
+    for(uint32_t i = 0; i < BENCH_MAX_ATTRIBS; i++) {
+        if(bench_format_has(format, BENCH_TYPES[i])) {
+            attribs[count].type = BENCH_TYPES[i];
+            attribs[count].offset = offsets[i];
+            count++;
+        }
+    }
+    attribs[count].type = LASER_ATTRIB_TYPE_NONE;
+    attribs[count].offset = 0;
+
+    uint64_t buffer_size = 4 << 20;
+    void* buffer = malloc(buffer_size);
+    BenchPoint* batch = (BenchPoint*) malloc(BENCH_BATCH * sizeof(BenchPoint));
+    BenchScan scan;
+    scan.rng = 0x9E3779B97F4A7C15ull ^ (seed * 0x2545F4914F6CDD1Dull + format);
+    scan.pulse = 0;
+    scan.pulses_per_line = (uint64_t) (2000.0 / 60.0 * 200000.0);
+
+    laserWriter writer;
+    laserResult res = laser_writer_begin(&writer, &info, buffer, buffer_size, bench_write, sink);
+    uint64_t report = 1 << 26;
+    for(uint64_t written = 0; res == LASER_SUCCESS && written < point_count;) {
+        uint32_t batch_count = 0;
+        uint64_t remaining = point_count - written;
+        uint32_t target = remaining < BENCH_BATCH ? (uint32_t) remaining: BENCH_BATCH;
+        while(batch_count < target) {
+            batch_count += bench_pulse(&scan, batch + batch_count, target - batch_count);
+        }
+        res = laser_write_attribs(&writer, batch, sizeof(BenchPoint), attribs, batch_count);
+        written += batch_count;
+        if(written >= report) {
+            fprintf(stderr, "  %llu / %llu points\n", (unsigned long long) written, (unsigned long long) point_count);
+            report += 1 << 26;
+        }
+    }
+    res = res == LASER_SUCCESS ? laser_writer_finish(&writer): res;
+    free(batch);
+    free(buffer);
+    return res;
+}
+
+static uint64_t bench_read_mem(void* usr, void* data, uint64_t size, uint64_t offset) {
+    BenchSource* source = (BenchSource*) usr;
+    if(offset >= source->size) {
+        return 0;
+    }
+    size = size < source->size - offset ? size: source->size - offset;
+    memcpy(data, source->data + offset, size);
+    return size;
+}
+
+static uint64_t bench_read_file(void* usr, void* data, uint64_t size, uint64_t offset) {
+    BenchSource* source = (BenchSource*) usr;
+    uint64_t done = 0;
+    while(done < size) {
+#if defined(_WIN32)
+        OVERLAPPED overlapped;
+        DWORD read = 0;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD) (offset + done);
+        overlapped.OffsetHigh = (DWORD) ((offset + done) >> 32);
+        DWORD chunk = size - done < (1u << 30) ? (DWORD) (size - done): (1u << 30);
+        if(!ReadFile(source->file, (uint8_t*) data + done, chunk, &read, &overlapped) || read == 0) {
+            break;
+        }
+#else
+        ssize_t read = pread(source->file, (uint8_t*) data + done, (size_t) (size - done), (off_t) (offset + done));
+        if(read <= 0) {
+            break;
+        }
+#endif
+        done += (uint64_t) read;
+    }
+    return done;
+}
+
+/* Reads like `bench_read_file` or `bench_read_mem`, then waits as long as the bandwidth of the source takes for `size`. */
+static uint64_t bench_read_slow(void* usr, void* data, uint64_t size, uint64_t offset) {
+    BenchSource* source = (BenchSource*) usr;
+    uint64_t read = source->on_disk ? bench_read_file(usr, data, size, offset): bench_read_mem(usr, data, size, offset);
+    double delay = (double) size / source->bandwidth;
+#if defined(_WIN32)
+    Sleep((DWORD) (delay * 1e3));
+#else
+    struct timespec wait;
+    wait.tv_sec = (time_t) delay;
+    wait.tv_nsec = (long) ((delay - (double) wait.tv_sec) * 1e9);
+    nanosleep(&wait, 0);
+#endif
+    return read;
+}
+
+static double bench_now(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+typedef enum BenchApi {
+    BENCH_SIMPLE,
+    BENCH_GRANULAR,
+    BENCH_COLUMNS,
+    BENCH_FILE,
+    BENCH_WRITER,
+    BENCH_WRITER_COLUMNS,
+    BENCH_CURSOR,
+    BENCH_CURSOR_PIPELINED,
+    BENCH_PARALLEL,
+    BENCH_FILE_GENERIC,
+    BENCH_FILE_FLAGS
+} BenchApi;
+
+static const char* BENCH_API_NAMES[] = {
+    "simple", "granular", "columns", "file", "writer", "writer_columns", "cursor", "cursor_pipelined", "file_parallel",
+    "file_generic", "file_flags"
+};
+
+/* Sources of `bench_pass`, the slowed one is only read through cursors. */
+enum {
+    BENCH_MEM,
+    BENCH_IO,
+    BENCH_IO_SLOW
+};
+
+static uint64_t bench_discard(void* usr, const void* data, uint64_t size, uint64_t offset) {
+    (void) usr;
+    (void) data;
+    (void) offset;
+    return size;
+}
+
+/* Encodes the first window, decoded into `context->output` beforehand, over and over until the file's point count. */
+static laserResult bench_write_pass(BenchContext* context, BenchApi api, const laserAttrib* attribs, uint64_t stride, laserColumn* columns) {
+    laserWriterInfo info;
+    memset(&info, 0, sizeof(info));
+    info.version_minor = context->info.version_minor;
+    info.point_format = context->info.point_format;
+    info.scale_x = context->info.scale_x;
+    info.scale_y = context->info.scale_y;
+    info.scale_z = context->info.scale_z;
+    info.offset_x = context->info.offset_x;
+    info.offset_y = context->info.offset_y;
+    info.offset_z = context->info.offset_z;
+
+    laserWriter writer;
+    laserResult res = laser_writer_begin(&writer, &info, context->writer_buffer, context->writer_buffer_size, bench_discard, 0);
+    for(uint64_t first = 0; res == LASER_SUCCESS && first < context->info.point_count; first += context->window) {
+        uint64_t count = context->info.point_count - first < context->window ? context->info.point_count - first: context->window;
+        res = api == BENCH_WRITER ? laser_write_attribs(&writer, context->output, stride, attribs, count): laser_write_columns(&writer, columns, count);
+    }
+    return res == LASER_SUCCESS ? laser_writer_finish(&writer): res;
+}
+
+/*
+ *  The reference of the kernel cases, the per-point loop every read went through before plans: one branch per
+ *  attribute flag and the offsets looked up per field. Covers the common attributes of formats 0 - 5.
+ */
+static void bench_decode_flags(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) {
+    uint8_t* point = base + index * plan->stride;
+    uint32_t flags = plan->flags;
+    const uint64_t* offsets = plan->offsets;
+    const uint64_t* offset_table = _LASER_ATTRIB_OFFSET_TABLE[plan->point_format];
+    for(uint64_t i = 0; i < count; i++) {
+        if(flags & LASER_ATTRIB_FLAG_X) {
+            *((float*) (point + offsets[LASER_ATTRIB_TYPE_X])) = *((const int32_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_X])) * plan->scale_x + plan->offset_x;
+        }
+        if(flags & LASER_ATTRIB_FLAG_Y) {
+            *((float*) (point + offsets[LASER_ATTRIB_TYPE_Y])) = *((const int32_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_Y])) * plan->scale_y + plan->offset_y;
+        }
+        if(flags & LASER_ATTRIB_FLAG_Z) {
+            *((float*) (point + offsets[LASER_ATTRIB_TYPE_Z])) = *((const int32_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_Z])) * plan->scale_z + plan->offset_z;
+        }
+        if(flags & LASER_ATTRIB_FLAG_INTENSITY) {
+            *((uint16_t*) (point + offsets[LASER_ATTRIB_TYPE_INTENSITY])) = *((const uint16_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_INTENSITY]));
+        }
+        if(flags & LASER_ATTRIB_FLAG_FLAGS) {
+            *((uint8_t*) (point + offsets[LASER_ATTRIB_TYPE_FLAGS])) = *((const uint8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_FLAGS]));
+        }
+        if(flags & LASER_ATTRIB_FLAG_CLASSIFICATION) {
+            *((uint8_t*) (point + offsets[LASER_ATTRIB_TYPE_CLASSIFICATION])) = *((const uint8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_CLASSIFICATION]));
+        }
+        if(flags & LASER_ATTRIB_FLAG_SCAN_ANGLE) {
+            *((int8_t*) (point + offsets[LASER_ATTRIB_TYPE_SCAN_ANGLE])) = *((const int8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_SCAN_ANGLE]));
+        }
+        if(flags & LASER_ATTRIB_FLAG_USR) {
+            *((uint8_t*) (point + offsets[LASER_ATTRIB_TYPE_USR])) = *((const uint8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_USR]));
+        }
+        if(flags & LASER_ATTRIB_FLAG_POINT_ID) {
+            *((uint16_t*) (point + offsets[LASER_ATTRIB_TYPE_POINT_ID])) = *((const uint16_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_POINT_ID]));
+        }
+        point += plan->stride;
+        raw_point += plan->point_size;
+    }
+}
+
+/* Swaps the kernel `laser_plan_attribs` picked for an XYZ or common plan for the scalar fused one or the flag loop. */
+static void bench_force_decode(laserPlan* plan, BenchApi api) {
+    if(api == BENCH_FILE_FLAGS) {
+        plan->decode = bench_decode_flags;
+    } else if(plan->flags == LASER_ATTRIB_FLAGS_XYZ) {
+        plan->decode = _laser_decode_xyz_any;
+    } else if(plan->flags == LASER_ATTRIB_FLAGS_COMMON) {
+        plan->decode = plan->point_format >= 6 ? _laser_decode_common_any_14: _laser_decode_common_any;
+    }
+}
+
+/* Decodes the whole file in batches of up to a window, both cursors read the same amount per callback. */
+static laserResult bench_cursor_pass(BenchContext* context, BenchApi api, laserFile* file, const laserPlan* plan) {
+    laserCursor cursor;
+    laserResult res = LASER_SUCCESS;
+#if defined(LASER_PTHREADS)
+    laserThreads threads;
+    laserScheduler scheduler;
+    laser_threads_scheduler(&scheduler, &threads, 0);
+    res = api == BENCH_CURSOR_PIPELINED ?
+        laser_cursor_init_pipelined(&cursor, file, plan, context->scratch, context->scratch_size, 0, LASER_ALL_POINTS, &scheduler):
+        laser_cursor_init(&cursor, file, plan, context->scratch, context->scratch_size / 2, 0, LASER_ALL_POINTS);
+#else
+    res = laser_cursor_init(&cursor, file, plan, context->scratch, context->scratch_size / 2, 0, LASER_ALL_POINTS);
+#endif
+
+    if(res == LASER_SUCCESS) {
+        uint64_t decoded = 1;
+        while(res == LASER_SUCCESS && decoded) {
+            res = laser_cursor_next(&cursor, context->output, context->window, &decoded);
+        }
+        laser_cursor_close(&cursor);
+    }
+#if defined(LASER_PTHREADS)
+    laser_threads_close(&threads);
+#endif
+    return res;
+}
+
+/* Decodes the whole file once, window by window. */
+static laserResult bench_pass(BenchContext* context, BenchApi api, int io, const laserAttrib* attribs, uint64_t stride, laserColumn* columns) {
+    BenchSource* source = &context->source;
+    laserIoReadFn fn = io == BENCH_IO_SLOW ? bench_read_slow: (source->on_disk ? bench_read_file: bench_read_mem);
+    laserResult res = LASER_SUCCESS;
+    laserFile file;
+    laserPlan plan;
+    if(api == BENCH_WRITER || api == BENCH_WRITER_COLUMNS) {
+        return bench_write_pass(context, api, attribs, stride, columns);
+    } else if(api == BENCH_FILE || api == BENCH_FILE_GENERIC || api == BENCH_FILE_FLAGS || api == BENCH_PARALLEL ||
+            api == BENCH_CURSOR || api == BENCH_CURSOR_PIPELINED) {
+        res = io ? laser_open_from_io(&file, fn, source): laser_open_from_mem(&file, source->data, source->size);
+        if(res != LASER_SUCCESS) {
+            return res;
+        }
+        laser_plan_attribs(&plan, &file, attribs, stride);
+        if(api == BENCH_CURSOR || api == BENCH_CURSOR_PIPELINED) {
+            return bench_cursor_pass(context, api, &file, &plan);
+        } else if(api == BENCH_FILE_GENERIC || api == BENCH_FILE_FLAGS) {
+            bench_force_decode(&plan, api);
+        }
+    }
+
+    for(uint64_t first = 0; res == LASER_SUCCESS && first < context->info.point_count; first += context->window) {
+        uint64_t count = context->info.point_count - first < context->window ? context->info.point_count - first: context->window;
+        switch(api) {
+            case BENCH_SIMPLE:
+                res = io ? laser_read_range_from_io((laserPoint*) context->output, stride, fn, source, first, count):
+                    laser_read_range_from_mem((laserPoint*) context->output, stride, source->data, source->size, first, count);
+                break;
+            case BENCH_GRANULAR:
+                res = io ? laser_read_range_from_io_with_attribs(context->output, stride, (laserAttrib*) attribs, fn, source, first, count):
+                    laser_read_range_from_mem_with_attribs(context->output, stride, (laserAttrib*) attribs, source->data, source->size, first, count);
+                break;
+            case BENCH_COLUMNS:
+                res = io ? laser_read_range_from_io_columns(columns, fn, source, first, count):
+                    laser_read_range_from_mem_columns(columns, source->data, source->size, first, count);
+                break;
+            case BENCH_FILE:
+            case BENCH_FILE_GENERIC:
+            case BENCH_FILE_FLAGS:
+                res = laser_file_read_range(&file, &plan, context->output, first, count);
+                break;
+            case BENCH_PARALLEL:
+                res = laser_file_read_range_parallel(&file, &plan, context->output, first, count, &context->scheduler);
+                break;
+            default:
+                break;
+        }
+    }
+    return res;
+}
+
+static void bench_report(const BenchContext* context, const BenchCase* result, uint32_t threads) {
+    double points = (double) context->info.point_count;
+    printf("%u,1.%u,%llu,%u,%s,%s,%s,%llu,%u,%.6f,%.6f,%.3f,%.3f\n",
+            context->info.point_format, context->info.version_minor, (unsigned long long) context->info.point_count,
+            context->info.point_size, result->api, result->source, result->attribs, (unsigned long long) result->stride,
+            threads, result->best, result->total / context->repeats,
+            points / result->best * 1e-6, points * context->info.point_size / result->best * 1e-9);
+    fflush(stdout);
+}
+
+/* Returns the best time of the case, `0` when it failed. */
+static double bench_run(BenchContext* context, BenchApi api, int io, const char* subset, const laserAttrib* attribs, uint64_t packed, uint64_t stride) {
+    laserColumn columns[BENCH_MAX_ATTRIBS + 1];
+    uint64_t column_offset = 0;
+    uint32_t column_count = 0;
+    int column_api = api == BENCH_COLUMNS || api == BENCH_WRITER_COLUMNS;
+    for(; column_api && attribs[column_count].type != LASER_ATTRIB_TYPE_NONE; column_count++) {
+        columns[column_count].type = attribs[column_count].type;
+        columns[column_count].data = context->output + column_offset;
+        columns[column_count].stride = LASER_DEFAULT_STRIDE;
+        column_offset += context->window * bench_type_size(attribs[column_count].type);
+    }
+    columns[column_count].type = LASER_ATTRIB_TYPE_NONE;
+    columns[column_count].data = 0;
+    columns[column_count].stride = 0;
+
+    /* The writer cases encode real points, decoded once outside the timing. */
+    int writer = api == BENCH_WRITER || api == BENCH_WRITER_COLUMNS;
+    uint64_t window = context->info.point_count < context->window ? context->info.point_count: context->window;
+    laserResult res = LASER_SUCCESS;
+    if(writer && (res = api == BENCH_WRITER ?
+            laser_read_range_from_mem_with_attribs(context->output, stride, (laserAttrib*) attribs, context->source.data, context->source.size, 0, window):
+            laser_read_range_from_mem_columns(columns, context->source.data, context->source.size, 0, window)) != LASER_SUCCESS) {
+        fprintf(stderr, "  %s %s input failed: %s\n", BENCH_API_NAMES[api], subset, laser_result_str(res));
+        return 0.0;
+    }
+
+    BenchCase result;
+    result.api = BENCH_API_NAMES[api];
+    result.source = writer ? "discard": (io == BENCH_IO_SLOW ? "io_slow": (io ? (context->source.on_disk ? "io_file": "io_mem"): "mem"));
+    result.attribs = subset;
+    result.stride = column_api ? packed: stride;
+    result.best = 1e30;
+    result.total = 0.0;
+    for(int run = 0; run < context->repeats; run++) {
+        double start = bench_now();
+        res = bench_pass(context, api, io, attribs, stride, columns);
+        double elapsed = bench_now() - start;
+        if(res != LASER_SUCCESS) {
+            fprintf(stderr, "  %s %s %s failed: %s\n", result.api, result.source, subset, laser_result_str(res));
+            return 0.0;
+        }
+        result.best = elapsed < result.best ? elapsed: result.best;
+        result.total += elapsed;
+    }
+
+    bench_report(context, &result, api == BENCH_PARALLEL ? context->threads: 1);
+    return result.best;
+}
+
+/*
+ *  kNN over a uniform XY grid of cells holding `BENCH_KNN_CELL_POINTS` points on average, each point's neighbours are
+ *  searched in the 3 x 3 cells around it. Points are visited in array order and the cells list array indices, so the
+ *  memory access pattern follows the order of the points.
+ */
+
+typedef struct BenchGrid {
+    float min_x;
+    float min_y;
+    float cell;
+    uint32_t width;
+    uint32_t height;
+    uint32_t* starts;
+    uint32_t* points;
+} BenchGrid;
+
+static uint32_t bench_grid_cell(const BenchGrid* grid, float x, float y) {
+    uint32_t cx = (uint32_t) ((x - grid->min_x) / grid->cell), cy = (uint32_t) ((y - grid->min_y) / grid->cell);
+    cx = cx < grid->width ? cx: grid->width - 1;
+    cy = cy < grid->height ? cy: grid->height - 1;
+    return cy * grid->width + cx;
+}
+
+static int bench_grid_build(BenchGrid* grid, const laserInfo* info, const float* xyz, uint64_t count) {
+    double area = (info->max_x - info->min_x) * (info->max_y - info->min_y);
+    grid->min_x = (float) info->min_x;
+    grid->min_y = (float) info->min_y;
+    grid->cell = (float) sqrt(area * BENCH_KNN_CELL_POINTS / (double) count);
+    grid->cell = grid->cell > 0.0f ? grid->cell: 1.0f;
+    grid->width = (uint32_t) ((info->max_x - info->min_x) / grid->cell) + 1;
+    grid->height = (uint32_t) ((info->max_y - info->min_y) / grid->cell) + 1;
+    uint64_t cell_count = (uint64_t) grid->width * grid->height;
+    grid->starts = (uint32_t*) calloc(cell_count + 1, sizeof(uint32_t));
+    grid->points = (uint32_t*) malloc(count * sizeof(uint32_t));
+    if(!grid->starts || !grid->points) {
+        return 0;
+    }
+
+    for(uint64_t i = 0; i < count; i++) {
+        grid->starts[bench_grid_cell(grid, xyz[3 * i], xyz[3 * i + 1]) + 1]++;
+    }
+    for(uint64_t i = 0; i < cell_count; i++) {
+        grid->starts[i + 1] += grid->starts[i];
+    }
+    for(uint64_t i = 0; i < count; i++) {
+        grid->points[grid->starts[bench_grid_cell(grid, xyz[3 * i], xyz[3 * i + 1])]++] = (uint32_t) i;
+    }
+    for(uint64_t i = cell_count; i > 0; i--) {
+        grid->starts[i] = grid->starts[i - 1];
+    }
+    grid->starts[0] = 0;
+    return 1;
+}
+
+/* Returns the sum of the squared distances to the k-th neighbour, so the search can't be optimized away. */
+static double bench_knn(const BenchGrid* grid, const float* xyz, uint64_t count) {
+    double sum = 0.0;
+    for(uint64_t i = 0; i < count; i++) {
+        const float* point = xyz + 3 * i;
+        float nearest[BENCH_KNN_K];
+        for(uint32_t k = 0; k < BENCH_KNN_K; k++) {
+            nearest[k] = 3.402823466e+38f;
+        }
+
+        uint32_t cell = bench_grid_cell(grid, point[0], point[1]);
+        int64_t cx = cell % grid->width, cy = cell / grid->width;
+        for(int64_t y = cy - 1; y <= cy + 1; y++) {
+            for(int64_t x = cx - 1; x <= cx + 1; x++) {
+                if(x < 0 || y < 0 || x >= grid->width || y >= grid->height) {
+                    continue;
+                }
+                uint64_t neighbour_cell = (uint64_t) y * grid->width + (uint64_t) x;
+                for(uint32_t j = grid->starts[neighbour_cell]; j < grid->starts[neighbour_cell + 1]; j++) {
+                    const float* other = xyz + 3 * (uint64_t) grid->points[j];
+                    float dx = other[0] - point[0], dy = other[1] - point[1], dz = other[2] - point[2];
+                    float distance = dx * dx + dy * dy + dz * dz;
+                    uint32_t k = BENCH_KNN_K;
+                    for(; k > 0 && distance < nearest[k - 1]; k--) {
+                        if(k < BENCH_KNN_K) {
+                            nearest[k] = nearest[k - 1];
+                        }
+                    }
+                    if(k < BENCH_KNN_K) {
+                        nearest[k] = distance;
+                    }
+                }
+            }
+        }
+        sum += nearest[BENCH_KNN_K - 1] < 3.402823466e+38f ? nearest[BENCH_KNN_K - 1]: 0.0f;
+    }
+    return sum;
+}
+
+static void bench_knn_cases(BenchContext* context) {
+    static const char* names[][2] = { { "knn_file_order", 0 }, { "knn_random_order", 0 }, { "knn_morton", "sort_morton" }, { "knn_hilbert", "sort_hilbert" } };
+    static const laserCurve curves[] = { LASER_CURVE_MORTON, LASER_CURVE_MORTON, LASER_CURVE_MORTON, LASER_CURVE_HILBERT };
+    uint64_t count = context->info.point_count;
+    uint64_t scratch_size = laser_sort_scratch_size(count, 0);
+    float* xyz = (float*) malloc(count * 3 * sizeof(float));
+    uint64_t* keys = (uint64_t*) malloc(count * sizeof(uint64_t));
+    uint64_t* indices = (uint64_t*) malloc(count * sizeof(uint64_t));
+    void* scratch = malloc(scratch_size);
+    laserFile file;
+    laserPlan plan;
+    laserAttrib attribs[] = { { LASER_ATTRIB_TYPE_X, 0 }, { LASER_ATTRIB_TYPE_Y, 4 }, { LASER_ATTRIB_TYPE_Z, 8 }, LASER_ATTRIB_END };
+    laserResult res = LASER_ERROR_BUFFER_TOO_SMALL;
+    if(xyz && keys && indices && scratch && (res = laser_open_from_mem(&file, context->source.data, context->source.size)) == LASER_SUCCESS) {
+        laser_plan_attribs(&plan, &file, attribs, 12);
+    }
+
+    for(uint32_t order = 0; res == LASER_SUCCESS && order < 4; order++) {
+        BenchCase sort, knn;
+        memset(&sort, 0, sizeof(sort));
+        sort.api = names[order][1];
+        knn.api = names[order][0];
+        sort.source = knn.source = "mem";
+        sort.attribs = knn.attribs = "xyz";
+        sort.stride = knn.stride = 12;
+        sort.best = knn.best = 1e30;
+        sort.total = knn.total = 0.0;
+
+        BenchGrid grid;
+        memset(&grid, 0, sizeof(grid));
+        for(int run = 0; res == LASER_SUCCESS && run < context->repeats; run++) {
+            double start = bench_now();
+            if(order == 0) {
+                res = laser_file_read_range(&file, &plan, xyz, 0, count);
+            } else if(order == 1) {
+                uint64_t rng = 0x9E3779B97F4A7C15ull;
+                for(uint64_t i = 0; i < count; i++) {
+                    indices[i] = i;
+                }
+                for(uint64_t i = count; i > 1; i--) {
+                    uint64_t j = bench_random(&rng) % i, swap = indices[i - 1];
+                    indices[i - 1] = indices[j];
+                    indices[j] = swap;
+                }
+                res = laser_file_read_indices(&file, &plan, xyz, indices, count);
+            } else if((res = laser_file_curve_keys(&file, curves[order], 0, count, keys, indices)) == LASER_SUCCESS &&
+                    (res = laser_sort_keys(keys, indices, count, scratch, scratch_size, 0)) == LASER_SUCCESS) {
+                res = laser_file_read_indices(&file, &plan, xyz, indices, count);
+            }
+            double elapsed = bench_now() - start;
+            sort.best = elapsed < sort.best ? elapsed: sort.best;
+            sort.total += elapsed;
+        }
+        if(res != LASER_SUCCESS || !bench_grid_build(&grid, &context->info, xyz, count)) {
+            fprintf(stderr, "  %s failed: %s\n", knn.api, laser_result_str(res));
+            res = res == LASER_SUCCESS ? LASER_ERROR_BUFFER_TOO_SMALL: res;
+        }
+
+        double checksum = 0.0;
+        for(int run = 0; res == LASER_SUCCESS && run < context->repeats; run++) {
+            double start = bench_now();
+            checksum += bench_knn(&grid, xyz, count);
+            double elapsed = bench_now() - start;
+            knn.best = elapsed < knn.best ? elapsed: knn.best;
+            knn.total += elapsed;
+        }
+        if(res == LASER_SUCCESS) {
+            fprintf(stderr, "  %s: mean squared 8th neighbour distance %.4f\n", knn.api, checksum / (double) context->repeats / (double) count);
+            if(sort.api) {
+                bench_report(context, &sort, 1);
+            }
+            bench_report(context, &knn, 1);
+        }
+        free(grid.starts);
+        free(grid.points);
+    }
+
+    free(xyz);
+    free(keys);
+    free(indices);
+    free(scratch);
+}
+
+static const BenchSubset BENCH_SUBSETS[] = {
+    { "xyz", { LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_NONE } },
+    { "xyz_intensity", { LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_INTENSITY, LASER_ATTRIB_TYPE_NONE } },
+    { "common", { LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_INTENSITY, LASER_ATTRIB_TYPE_FLAGS,
+        LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_ATTRIB_TYPE_SCAN_ANGLE, LASER_ATTRIB_TYPE_USR, LASER_ATTRIB_TYPE_POINT_ID, LASER_ATTRIB_TYPE_NONE } },
+    { "classification", { LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_ATTRIB_TYPE_NONE } },
+};
+
+static void bench_format(BenchContext* context) {
+    laserAttrib attribs[BENCH_MAX_ATTRIBS + 1];
+    uint32_t format = context->info.point_format;
+    for(int io = 0; io < 2; io++) {
+        if(!io && !context->source.data) {
+            continue;
+        }
+
+        bench_run(context, BENCH_SIMPLE, io, "common", 0, 0, sizeof(laserPoint));
+        bench_run(context, BENCH_SIMPLE, io, "common", 0, 0, 64);
+
+        for(uint32_t i = 0; i <= sizeof(BENCH_SUBSETS) / sizeof(BENCH_SUBSETS[0]); i++) {
+            const BenchSubset* subset = i < sizeof(BENCH_SUBSETS) / sizeof(BENCH_SUBSETS[0]) ? &BENCH_SUBSETS[i]: 0;
+            const char* name = subset ? subset->name: "all";
+            uint64_t packed = bench_attribs(attribs, subset, format);
+            bench_run(context, BENCH_GRANULAR, io, name, attribs, packed, packed);
+            if(packed < 64) {
+                bench_run(context, BENCH_GRANULAR, io, name, attribs, packed, 64);
+            }
+            if(i == 0 || !subset) {
+                bench_run(context, BENCH_COLUMNS, io, name, attribs, packed, packed);
+                bench_run(context, BENCH_FILE, io, name, attribs, packed, packed);
+            }
+            if(!io && (i == 0 || i == 2)) {
+                double flags = bench_run(context, BENCH_FILE_FLAGS, io, name, attribs, packed, packed);
+                double generic = bench_run(context, BENCH_FILE_GENERIC, io, name, attribs, packed, packed);
+                if(flags > 0.0 && generic > 0.0) {
+                    fprintf(stderr, "  format %u %s: fused kernel %.2fx the flag loop\n", format, name, flags / generic);
+                }
+            }
+            if(!io && (i == 0 || !subset)) {
+                bench_run(context, BENCH_WRITER, io, name, attribs, packed, packed);
+                bench_run(context, BENCH_WRITER_COLUMNS, io, name, attribs, packed, packed);
+            }
+        }
+    }
+
+#if defined(LASER_PTHREADS)
+    /* Thread scaling over 1, 2, 4, ... and `max_threads`, the pool is created once per thread count. */
+    uint32_t threads = context->source.data && context->max_threads ? 1: 0;
+    while(threads) {
+        laserThreads pool;
+        laser_threads_scheduler(&context->scheduler, &pool, threads);
+        context->threads = threads;
+        for(uint32_t i = 0; i < 2; i++) {
+            uint64_t packed = bench_attribs(attribs, i ? 0: &BENCH_SUBSETS[0], format);
+            bench_run(context, BENCH_PARALLEL, BENCH_MEM, i ? "all": "xyz", attribs, packed, packed);
+        }
+        laser_threads_close(&pool);
+        threads = threads == context->max_threads ? 0: (threads * 2 < context->max_threads ? threads * 2: context->max_threads);
+    }
+#endif
+
+    if(context->knn && context->source.data) {
+        bench_knn_cases(context);
+        context->knn = 0;
+    }
+
+    if(context->source.bandwidth > 0.0) {
+        uint64_t packed = bench_attribs(attribs, &BENCH_SUBSETS[0], format);
+        bench_run(context, BENCH_CURSOR, BENCH_IO_SLOW, "xyz", attribs, packed, packed);
+#if defined(LASER_PTHREADS)
+        bench_run(context, BENCH_CURSOR_PIPELINED, BENCH_IO_SLOW, "xyz", attribs, packed, packed);
+#endif
+    }
+}
+
+static uint64_t bench_parse_count(const char* text) {
+    char* end = 0;
+    double value = strtod(text, &end);
+    switch(end ? *end: 0) {
+        case 'k': case 'K': value *= 1e3; break;
+        case 'm': case 'M': value *= 1e6; break;
+        case 'g': case 'G': value *= 1e9; break;
+        default: break;
+    }
+    return (uint64_t) value;
+}
+
+static uint32_t bench_parse_formats(const char* text) {
+    uint32_t mask = 0;
+    while(*text) {
+        char* end = 0;
+        long first = strtol(text, &end, 10), last = first;
+        if(end == text) {
+            return 0;
+        } else if(*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+        }
+        for(long format = first; format <= last && format >= 0 && format <= 5; format++) {
+            mask |= 1u << format;
+        }
+        text = *end == ',' ? end + 1: end;
+    }
+    return mask;
+}
+
+static int bench_open_source(BenchSource* source, const char* path) {
+#if defined(_WIN32)
+    source->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    LARGE_INTEGER size;
+    if(source->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(source->file, &size)) {
+        return 0;
+    }
+    source->size = (uint64_t) size.QuadPart;
+#else
+    source->file = open(path, O_RDONLY);
+    off_t size = source->file >= 0 ? lseek(source->file, 0, SEEK_END): -1;
+    if(size < 0) {
+        return 0;
+    }
+    source->size = (uint64_t) size;
+#endif
+    return 1;
+}
+
+static void bench_close_source(BenchSource* source) {
+#if defined(_WIN32)
+    CloseHandle(source->file);
+#else
+    close(source->file);
+#endif
+}
+
+int main(int argc, const char** argv) {
+    uint64_t point_count = 2000000, window = 1 << 20, seed = 1, memory_limit = 2048, bandwidth = 1000, max_threads = 1;
+#if defined(LASER_PTHREADS)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    max_threads = cpus > 0 ? (uint64_t) cpus: 1;
+#endif
+    uint32_t formats = 0x3F;
+    int repeats = 5;
+    const char* directory = 0;
+    for(int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1]: 0;
+        if(!value || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+            fprintf(stderr, "%s [-n POINTS] [-f FORMATS] [-r REPEATS] [-w WINDOW] [-o DIR] [-m MIB] [-b MBPS] [-t THREADS] [-s SEED]\n", argv[0]);
+            return -1;
+        }
+        switch(argv[i][1]) {
+            case 'n': point_count = bench_parse_count(value); break;
+            case 'f': formats = bench_parse_formats(value); break;
+            case 'r': repeats = atoi(value); break;
+            case 'w': window = bench_parse_count(value); break;
+            case 'o': directory = value; break;
+            case 'm': memory_limit = bench_parse_count(value); break;
+            case 'b': bandwidth = bench_parse_count(value); break;
+            case 't': max_threads = bench_parse_count(value); break;
+            case 's': seed = bench_parse_count(value); break;
+            default:
+                fprintf(stderr, "unknown option %s\n", argv[i]);
+                return -1;
+        }
+        i++;
+    }
+    if(!point_count || !window || !formats || repeats < 1) {
+        fprintf(stderr, "invalid arguments\n");
+        return -1;
+    } else if(point_count > 0xFFFFFFFFull) {
+        fprintf(stderr, "LAS 1.0 - 1.3 count points in 32 bits, at most 4294967295 points\n");
+        return -1;
+    }
+
+    BenchContext context;
+    memset(&context, 0, sizeof(context));
+    context.window = window;
+    context.repeats = repeats;
+    context.knn = 1;
+    context.max_threads = max_threads > LASER_MAX_TASKS ? LASER_MAX_TASKS: (uint32_t) max_threads;
+    context.output_size = window * 64;
+    context.output = (uint8_t*) malloc(context.output_size);
+    context.writer_buffer_size = 4 << 20;
+    context.writer_buffer = (uint8_t*) malloc(context.writer_buffer_size);
+    context.scratch_size = 8 << 20;
+    context.scratch = (uint8_t*) malloc(context.scratch_size);
+    if(!context.output || !context.writer_buffer || !context.scratch) {
+        fprintf(stderr, "out of memory for a window of %llu points\n", (unsigned long long) window);
+        return -1;
+    }
+
+    printf("format,version,points,point_size,api,source,attribs,stride,threads,best_s,mean_s,mpoints_per_s,gb_per_s\n");
+    for(uint32_t format = 0; format <= 5; format++) {
+        if(!(formats & (1u << format))) {
+            continue;
+        }
+
+        BenchSink sink;
+        memset(&sink, 0, sizeof(sink));
+        BenchSource* source = &context.source;
+        memset(source, 0, sizeof(BenchSource));
+        source->bandwidth = (double) bandwidth * 1e6;
+        uint64_t header_size = BENCH_VERSIONS[format] == 3 ? 235: 227;
+        uint64_t file_size = header_size + point_count * BENCH_POINT_SIZES[format];
+        laserResult res = LASER_SUCCESS;
+        if(directory) {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/bench_%u_%llu_%llu.las", directory, format, (unsigned long long) point_count, (unsigned long long) seed);
+            source->on_disk = 1;
+            if(!bench_open_source(source, path) || source->size != file_size) {
+                if(source->size) {
+                    bench_close_source(source);
+                }
+                fprintf(stderr, "generating %s\n", path);
+                if(!(sink.file = fopen(path, "wb"))) {
+                    fprintf(stderr, "can't create %s\n", path);
+                    return -1;
+                }
+                res = bench_generate(&sink, format, point_count, seed);
+                fclose(sink.file);
+                if(res != LASER_SUCCESS || !bench_open_source(source, path)) {
+                    fprintf(stderr, "generating %s failed: %s\n", path, laser_result_str(res));
+                    return -1;
+                }
+            }
+            if(source->size <= memory_limit << 20 && (source->data = (uint8_t*) malloc(source->size))) {
+                if(bench_read_file(source, source->data, source->size, 0) != source->size) {
+                    free(source->data);
+                    source->data = 0;
+                }
+            }
+            if(!source->data) {
+                fprintf(stderr, "format %u: %llu bytes exceed -m, skipping the memory cases\n", format, (unsigned long long) source->size);
+            }
+        } else {
+            fprintf(stderr, "generating format %u in memory\n", format);
+            if(!(sink.data = source->data = (uint8_t*) malloc(file_size))) {
+                fprintf(stderr, "out of memory for %llu bytes, use -o\n", (unsigned long long) file_size);
+                return -1;
+            }
+            source->size = file_size;
+            if((res = bench_generate(&sink, format, point_count, seed)) != LASER_SUCCESS) {
+                fprintf(stderr, "generating format %u failed: %s\n", format, laser_result_str(res));
+                return -1;
+            }
+        }
+
+        res = source->data ? laser_info_from_mem(&context.info, source->data, source->size):
+            laser_info_from_io(&context.info, bench_read_file, source);
+        if(res != LASER_SUCCESS) {
+            fprintf(stderr, "format %u: %s\n", format, laser_result_str(res));
+            return -1;
+        }
+
+        fprintf(stderr, "format %u: %llu points, %.2f GB\n", format, (unsigned long long) context.info.point_count, (double) source->size * 1e-9);
+        bench_format(&context);
+        if(directory) {
+            bench_close_source(source);
+        }
+        free(source->data);
+    }
+    free(context.output);
+    free(context.writer_buffer);
+    free(context.scratch);
+    return 0;
+}
@@ -7,6 +7,19 @@
  *
  *      Configuration Options:
  *          #define LASER_ASSERT - Provide a custom `assert`, otherwise defaults to `assert` from <assert.h>.
+ *          #define LASER_DECODE_BLOCK_SIZE - Number of points decoded per attribute pass, defaults to 256, at most 65536.
+ *          #define LASER_NO_SIMD - Disable the SSE2 decode kernels, used by default wherever SSE2 is available.
+ *          #define LASER_IO_BUFFER_SIZE - Size of the stack buffer used by the `_from_io` range reads, defaults to 16384.
+ *          #define LASER_MAX_TASKS - Maximum number of chunks a parallel read is split into, defaults to 64.
+ *          #define LASER_PTHREADS - Provide `laser_threads_*`, a pthread pool scheduler for the parallel API.
+ *          #define LASER_CATALOG_SCAN - Provide `laser_catalog_scan`, directory scanning for catalogs (POSIX, the implementation needs `_DEFAULT_SOURCE`).
+ *          #define LASER_IO_URING - Provide `laser_uring_*`, an io_uring based file backend (Linux only, the implementation needs `_GNU_SOURCE`).
+ *          #define LASER_MMAP - Provide `laser_map_*`, memory mapped file access with access pattern hints (POSIX, the implementation needs `_DEFAULT_SOURCE`).
+ *          #define LASER_URING_SEGMENT_SIZE - Size of a single read submitted to io_uring, defaults to 1 MiB.
+ *          #define LASER_URING_MAX_DEPTH - Maximum number of reads in flight, defaults to 32.
+ *          #define LASER_URING_ALIGNMENT - Alignment required by `O_DIRECT`, defaults to 4096.
+ *          #define LASER_TRACE - Provide `laser_trace_*`, counters, timers and hooks on the header, IO and decode paths.
+ *          #define LASER_TRACE_CLOCK - Provide a nanosecond clock (`uint64_t LASER_TRACE_CLOCK()`) for `LASER_TRACE`.
  *
  *  LICENSE:
  *      See end of file for license information.
@@ -15,9 +28,10 @@
  *      See `example/example.c` for a working example.
  *
  *  API:
- *      `laser` consists of two APIs:
+ *      `laser` consists of three APIs:
  *          - Simple.
  *          - Granular.
+ *          - Columnar.
  */
 
 #if !defined(LASER_H)
@@ -27,6 +41,10 @@
 #define LASER_VERSION_MINOR 7
 #define LASER_VERSION_PATCH 2
 
+#if defined(LASER_PTHREADS)
+#include <pthread.h>
+#endif
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -76,7 +94,10 @@ typedef enum laserResult {
     LASER_ERROR_INVALID_RANGE = -2,
     LASER_ERROR_VERSION_UNSUPPORTED = -3,
     LASER_ERROR_FORMAT_UNSUPPORTED = -4,
-    LASER_ERROR_IO_READ = -5
+    LASER_ERROR_IO_READ = -5,
+    LASER_ERROR_BUFFER_TOO_SMALL = -6,
+    LASER_ERROR_IO_WRITE = -7,
+    LASER_ERROR_FILTERED_PLAN = -8
 } laserResult;
 
 LASER_API const char* laser_result_str(laserResult res);
@@ -134,6 +155,7 @@ typedef struct laserInfo {
     float max_x;
     float max_y;
     float max_z;
+    uint32_t compressed;
 } laserInfo;
 
 typedef struct laserPoint {
@@ -160,7 +182,8 @@ typedef struct laserPoint {
 typedef uint64_t (*laserIoReadFn)(void* usr, void* data, uint64_t size, uint64_t offset);
 
 /*
- *  Simple API - Supports reading the common subset of attributes shared between points formats: 0 - 5.
+ *  Simple API - Supports reading the common subset of attributes shared between points formats: 0 - 10.
+ *  Formats 6 - 10 (LAS 1.4) are converted to the 0 - 5 layout of `laserPoint`, e.g. return numbers saturate at 7.
  *
  *  `laser_*_from_mem` - Requires the entire LAS file to be in memory.
  *  `laser_*_from_io` - Supports reading data on demand from the `io` callbacks.
@@ -192,21 +215,26 @@ typedef enum laserAttribType {
     LASER_ATTRIB_TYPE_SCAN_ANGLE,                       /* int8_t   */
     LASER_ATTRIB_TYPE_USR,                              /* uint8_t  */
     LASER_ATTRIB_TYPE_POINT_ID,                         /* uint16_t */
-    /*
-     * Unsupported:
-     * LASER_ATTRIB_TYPE_GPS_TIME,
-     * LASER_ATTRIB_TYPE_RED,
-     * LASER_ATTRIB_TYPE_GREEN,
-     * LASER_ATTRIB_TYPE_BLUE,
-     * LASER_ATTRIB_TYPE_WAVEFORM_ID,
-     * LASER_ATTRIB_TYPE_WAVEFORM_OFFSET,
-     * LASER_ATTRIB_TYPE_WAVEFORM_SIZE,
-     * LASER_ATTRIB_TYPE_WAVEFORM_LOCATION,
-     * LASER_ATTRIB_TYPE_X_TIME,
-     * LASER_ATTRIB_TYPE_Y_TIME,
-     * LASER_ATTRIB_TYPE_Z_TIME,
-     */
-     LASER_ATTRIB_TYPE_COUNT
+    LASER_ATTRIB_TYPE_GPS_TIME,                         /* double   */
+    LASER_ATTRIB_TYPE_RED,                              /* uint16_t */
+    LASER_ATTRIB_TYPE_GREEN,                            /* uint16_t */
+    LASER_ATTRIB_TYPE_BLUE,                             /* uint16_t */
+    LASER_ATTRIB_TYPE_WAVEFORM_ID,                      /* uint8_t  */
+    LASER_ATTRIB_TYPE_WAVEFORM_OFFSET,                  /* uint64_t */
+    LASER_ATTRIB_TYPE_WAVEFORM_SIZE,                    /* uint32_t */
+    LASER_ATTRIB_TYPE_WAVEFORM_LOCATION,                /* float    */
+    LASER_ATTRIB_TYPE_X_TIME,                           /* float    */
+    LASER_ATTRIB_TYPE_Y_TIME,                           /* float    */
+    LASER_ATTRIB_TYPE_Z_TIME,                           /* float    */
+    LASER_ATTRIB_TYPE_NIR,                              /* uint16_t */
+    LASER_ATTRIB_TYPE_EXTENDED_RETURNS,                 /* uint8_t, return number in bits 0 - 3, number of returns in bits 4 - 7 */
+    LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION,          /* uint8_t, classes 0 - 255 without flag bits */
+    LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS,             /* uint8_t, synthetic, key-point, withheld and overlap in bits 0 - 3 */
+    LASER_ATTRIB_TYPE_SCANNER_CHANNEL,                  /* uint8_t  */
+    LASER_ATTRIB_TYPE_SCAN_ANGLE_DEGREES,               /* float    */
+    LASER_ATTRIB_TYPE_GPS_TIME_RELATIVE,                /* float, GPS time minus the plan's time base */
+    LASER_ATTRIB_TYPE_RGB8,                             /* uint32_t, 8-bit red, green, blue and 255 alpha, from low to high byte */
+    LASER_ATTRIB_TYPE_COUNT
 } laserAttribType;
 
 typedef struct laserAttrib {
@@ -222,6 +250,10 @@ typedef struct laserAttrib {
  *  `laser_*_from_mem_with_attribs` - Requires the entire LAS file to be in memory, reads specified attributes into their corresponding offset.
  *  `laser_*_from_io_with_attribs` - Supports reading data on demand from the `io` callbacks, reads specified attributes into their corresponding offset.
  *
+ *  Attributes the point format doesn't store decode as zeros. The extended attributes read the LAS 1.4 fields and are
+ *  derived from the legacy fields for formats 0 - 5, `SCAN_ANGLE_DEGREES`, `GPS_TIME_RELATIVE` and `RGB8` are
+ *  converted while decoding, so colours and timestamps come out of the same pass as the coordinates.
+ *
  *  Example:
  *      laserInfo info;
  *      laser_info_from_mem(&info, las_file_data, las_file_size);
@@ -238,300 +270,6390 @@ typedef struct laserAttrib {
 LASER_API laserResult laser_read_range_from_mem_with_attribs(void* points, uint64_t stride, laserAttrib* attribs, void* mem, uint64_t size, uint64_t first, uint64_t count);
 LASER_API laserResult laser_read_range_from_io_with_attribs(void* points, uint64_t stride, laserAttrib* attribs, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count);
 
-#if defined(__cplusplus)
-}
-#endif
+typedef struct laserColumn {
+    laserAttribType type;
+    void* data;
+    uint64_t stride;
+} laserColumn;
 
-#endif
+#define LASER_COLUMN_END { LASER_ATTRIB_TYPE_NONE, 0, 0 }
 
-#if defined(LASER_IMPL)
+/*
+ *  Columnar API - Supports reading any set of attributes into separate arrays, one per attribute.
+ *
+ *  `laser_*_from_mem_columns` - Requires the entire LAS file to be in memory, reads specified attributes into their corresponding column.
+ *  `laser_*_from_io_columns` - Supports reading data on demand from the `io` callbacks, reads specified attributes into their corresponding column.
+ *
+ *  A column `stride` is the distance in bytes between consecutive elements, `LASER_DEFAULT_STRIDE` packs them tightly.
+ *
+ *  Example:
+ *      laserInfo info;
+ *      laser_info_from_mem(&info, las_file_data, las_file_size);
+ *      float* x = (float*) malloc(sizeof(float) * info.point_count);
+ *      float* y = (float*) malloc(sizeof(float) * info.point_count);
+ *      uint8_t* classification = (uint8_t*) malloc(sizeof(uint8_t) * info.point_count);
+ *      laserColumn columns[] = {
+ *          {  LASER_ATTRIB_TYPE_X, x, LASER_DEFAULT_STRIDE },
+ *          {  LASER_ATTRIB_TYPE_Y, y, LASER_DEFAULT_STRIDE },
+ *          {  LASER_ATTRIB_TYPE_CLASSIFICATION, classification, LASER_DEFAULT_STRIDE },
+ *          LASER_COLUMN_END
+ *      };
+ *      laserResult result = laser_read_range_from_mem_columns(columns, las_file_data, las_file_size, 0, LASER_ALL_POINTS);
+ */
 
-#if !defined(LASER_ASSERT)
-#include <assert.h>
-#define LASER_ASSERT(x) assert(x)
-#endif
+LASER_API laserResult laser_read_range_from_mem_columns(laserColumn* columns, void* mem, uint64_t size, uint64_t first, uint64_t count);
+LASER_API laserResult laser_read_range_from_io_columns(laserColumn* columns, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count);
 
-#define LASER_OFFSET_OF(s, m) ((uint64_t) (&(((s*) 0)->m)))
+#define LASER_LAZ_MAX_ITEMS 8
 
-static const uint8_t _LASER_MAGIC[4] = { 'L', 'A', 'S', 'F' };
+typedef struct laserLazItem {
+    uint16_t type;
+    uint16_t size;
+    uint16_t version;
+} laserLazItem;
 
-#pragma pack(push, 1)
-typedef struct laserPublicHeaderBlock {
-    uint32_t magic;
-    uint16_t file_source_id;
-    struct {
-        uint16_t gps_type: 1;
-        uint16_t waveform_internal: 1;
-        uint16_t waveform_external: 1;
-        uint16_t synthetic_return_count: 1;
-        uint16_t wkt: 1;
-        uint16_t _: 11;
-    } global_encoding;
-    uint32_t guid_1;
-    uint16_t guid_2;
-    uint16_t guid_3;
-    uint64_t guid_4;
-    uint8_t version_major;
-    uint8_t version_minor;
-    char system_id[32];
-    char software[32];
-    uint16_t ddd;
-    uint16_t yyyy;
-    uint16_t phb_size;
-    uint32_t point_offset;
+typedef struct laserLaz {
+    uint32_t compressor;
+    uint32_t coder;
+    uint32_t chunk_size;
+    uint32_t item_count;
+    laserLazItem items[LASER_LAZ_MAX_ITEMS];
+    uint64_t chunk_count;
+    uint64_t* chunk_points;
+    uint64_t* chunk_offsets;
+    uint8_t* decoders;
+    uint64_t decoder_size;
+    uint32_t decoder_count;
+} laserLaz;
+
+typedef struct laserFile {
+    laserInfo info;
+    uint32_t header_size;
     uint32_t vlr_count;
-    uint8_t format_id;
-    uint16_t point_size;
-    uint32_t point_count;
-    uint32_t point_count_per_return[5];
-    double x_scale;
-    double y_scale;
-    double z_scale;
-    double x_offset;
-    double y_offset;
-    double z_offset;
-    double x_max;
-    double x_min;
-    double y_max;
-    double y_min;
-    double z_max;
-    double z_min;
-} laserPublicHeaderBlock;
-#pragma pack(pop)
+    void* mem;
+    uint64_t size;
+    laserIoReadFn fn;
+    void* usr;
+    laserLaz laz;
+} laserFile;
 
-static const uint64_t _LASER_ATTRIB_OFFSET_TABLE[6][20] = {
-    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 0, 20, 22, 24, 0, 0, 0, 0, 0, 0, 0 },
-    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 28, 30, 32, 0, 0, 0, 0, 0, 0, 0 },
-    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 0, 0, 0, 28, 29, 37, 41, 45, 49, 53 },
-    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 28, 30, 32, 34, 35, 43, 47, 51, 55, 59 },
-};
+typedef struct laserPlan laserPlan;
+typedef struct laserStats laserStats;
+typedef struct laserVoxels laserVoxels;
+
+typedef void (*laserAttribDecodeFn)(uint8_t* point, uint64_t stride, const uint8_t* raw_point, uint64_t point_size, uint64_t count, const laserPlan* plan);
+typedef void (*laserBlockDecodeFn)(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count);
 
-static const uint32_t _LASER_VALID_ATTRIB_TABLE[6] = {
-    0x1FF, 0x3FF, 0x1DFF, 0x1FFF, 0xFE3FF, 0xFFFFF,
+typedef struct laserPlanEntry {
+    laserAttribDecodeFn decode;
+    uint64_t offset;
+    uint64_t stride;
+} laserPlanEntry;
+
+struct laserPlan {
+    laserBlockDecodeFn decode;
+    laserPlanEntry entries[LASER_ATTRIB_TYPE_COUNT];
+    uint64_t offsets[LASER_ATTRIB_TYPE_COUNT];
+    uint32_t entry_count;
+    uint32_t flags;
+    uint64_t stride;
+    uint64_t point_size;
+    uint32_t point_format;
+    uint32_t classification_offset;
+    uint32_t classification_mask;
+    uint32_t withheld_mask;
+    uint32_t return_mask;
+    float scale_x;
+    float scale_y;
+    float scale_z;
+    float offset_x;
+    float offset_y;
+    float offset_z;
+    double time_base;
+    uint32_t filter;
+    int32_t filter_min[3];
+    int32_t filter_max[3];
+    uint32_t filter_classifications[8];
+    uint32_t filter_returns;
+    uint32_t filter_withheld;
+    uint32_t sample;
+    uint64_t sample_every;
+    uint64_t sample_threshold;
+    uint64_t sample_seed;
+    int32_t sample_min[3];
+    double sample_scale[3];
+    laserVoxels* voxels;
+    laserStats* stats;
+    uint32_t stats_count;
 };
 
-static laserAttrib _LASER_DEFAULT_ATTRIBS[] = {
-    { LASER_ATTRIB_TYPE_X, LASER_OFFSET_OF(laserPoint, x) },
-    { LASER_ATTRIB_TYPE_Y, LASER_OFFSET_OF(laserPoint, y) },
-    { LASER_ATTRIB_TYPE_Z, LASER_OFFSET_OF(laserPoint, z) },
-    { LASER_ATTRIB_TYPE_INTENSITY, LASER_OFFSET_OF(laserPoint, intensity) },
-    { LASER_ATTRIB_TYPE_FLAGS, LASER_OFFSET_OF(laserPoint, flags) },
-    { LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_OFFSET_OF(laserPoint, classification) },
-    { LASER_ATTRIB_TYPE_SCAN_ANGLE, LASER_OFFSET_OF(laserPoint, scan_angle) },
-    { LASER_ATTRIB_TYPE_USR, LASER_OFFSET_OF(laserPoint, usr) },
-    { LASER_ATTRIB_TYPE_POINT_ID, LASER_OFFSET_OF(laserPoint, point_id) },
-    LASER_ATTRIB_END
+/*
+ *  File API - Parses the header once and reuses it, together with precompiled read plans, for any number of reads.
+ *
+ *  `laser_open_from_mem` - Requires the entire LAS file to be in memory, files whose point data runs past `size` fail with `LASER_ERROR_INVALID_FILE`.
+ *  `laser_open_from_io` - Supports reading data on demand from the `io` callbacks, only the header is read up front.
+ *  `laser_plan_attribs` / `laser_plan_columns` - Compile a set of attributes into a plan, valid for files sharing the same point format, size and scale/offset.
+ *  `laser_file_read_range` - Reads a range through a plan, `points` is the interleaved output and ignored for column plans.
+ *  `laser_plan_time_base` - Sets the time subtracted by `LASER_ATTRIB_TYPE_GPS_TIME_RELATIVE`, `0` by default, e.g. the first timestamp of a flight line.
+ *
+ *  `laserFile` and `laserPlan` are caller-allocated, their members are not part of the API.
+ *
+ *  Example:
+ *      laserFile file;
+ *      laser_open_from_io(&file, las_read, las_file);
+ *      laserPlan plan;
+ *      laser_plan_attribs(&plan, &file, attribs, 12);
+ *      for(uint64_t i = 0; i < tile_count; i++) {
+ *          laser_file_read_range(&file, &plan, points, tiles[i].first, tiles[i].count);
+ *      }
+ */
+
+LASER_API laserResult laser_open_from_mem(laserFile* file, void* mem, uint64_t size);
+LASER_API laserResult laser_open_from_io(laserFile* file, laserIoReadFn fn, void* usr);
+LASER_API void laser_plan_attribs(laserPlan* plan, const laserFile* file, const laserAttrib* attribs, uint64_t stride);
+LASER_API void laser_plan_columns(laserPlan* plan, const laserFile* file, const laserColumn* columns);
+LASER_API laserResult laser_file_read_range(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count);
+LASER_API void laser_plan_time_base(laserPlan* plan, double time_base);
+
+enum {
+    LASER_FILTER_BOUNDS = (1 << 0),
+    LASER_FILTER_CLASSIFICATION = (1 << 1),
+    LASER_FILTER_RETURN_NUMBER = (1 << 2),
+    LASER_FILTER_WITHHELD = (1 << 3)
 };
 
-static laserResult _laser_check_magic(uint8_t* magic) {
-    return
-        magic[0] != _LASER_MAGIC[0] ||
-        magic[1] != _LASER_MAGIC[1] ||
-        magic[2] != _LASER_MAGIC[2] ||
-        magic[3] != _LASER_MAGIC[3] ? LASER_ERROR_INVALID_FILE: LASER_SUCCESS;
-}
+typedef struct laserFilter {
+    uint32_t flags;
+    double min_x;
+    double min_y;
+    double min_z;
+    double max_x;
+    double max_y;
+    double max_z;
+    uint32_t classifications;                           /* Bit `n` keeps classification `n`. */
+    uint32_t returns;                                   /* Bit `n` keeps return number `n`. */
+} laserFilter;
 
-laserResult laser_info_from_mem(laserInfo* info, void* mem, uint64_t size) {
-    (void) size;
+/*
+ *  Filter API - Tests points on the raw record, before dequantizing, and only decodes the matches.
+ *
+ *  `laser_plan_filter` - Attaches a filter to a plan, the bounds are converted into the integer space of `file` once. Passing `0` removes the filter.
+ *  `LASER_FILTER_WITHHELD` drops points with the withheld bit set, the other flags enable the matching `laserFilter` members.
+ *  `laser_file_read_filtered` - Reads the matches of a range compacted to the start of `points`, their number is returned in `matched`.
+ *  `laser_file_count_filtered` - Only counts the matches, for sizing the output.
+ *
+ *  Only these reads (and the raster API) apply filters. Reads returning every point of a range or a list of indices
+ *  (`laser_file_read_range`, `laser_file_read_range_parallel`, `laser_file_read_indices`, `laser_map_read_range` and
+ *  cursors) fail with `LASER_ERROR_FILTERED_PLAN` on a plan with a filter or sample attached instead of ignoring it.
+ *
+ *  Example:
+ *      laserFilter filter = { LASER_FILTER_CLASSIFICATION | LASER_FILTER_WITHHELD };
+ *      filter.classifications = 1 << LASER_CLASSIFICATION_GROUND;
+ *      laser_plan_filter(&plan, &file, &filter);
+ *      laser_file_count_filtered(&file, &plan, 0, LASER_ALL_POINTS, &count);
+ *      laser_file_read_filtered(&file, &plan, points, 0, LASER_ALL_POINTS, &count);
+ */
 
-    laserResult res = LASER_SUCCESS;
-    if((res = _laser_check_magic((uint8_t*) mem)) != LASER_SUCCESS) {
-        return res;
-    }
+LASER_API void laser_plan_filter(laserPlan* plan, const laserFile* file, const laserFilter* filter);
+LASER_API laserResult laser_file_read_filtered(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count, uint64_t* matched);
+LASER_API laserResult laser_file_count_filtered(const laserFile* file, const laserPlan* plan, uint64_t first, uint64_t count, uint64_t* matched);
 
-    laserPublicHeaderBlock* public_header_block = (laserPublicHeaderBlock*) mem;
-    if(public_header_block->version_major > 1 || (public_header_block->version_major == 1 && public_header_block->version_minor > 3)) {
-        return LASER_ERROR_VERSION_UNSUPPORTED;
-    } else if(public_header_block->format_id > 5) {
-        return LASER_ERROR_FORMAT_UNSUPPORTED;
-    }
+typedef enum laserSampleMode {
+    LASER_SAMPLE_NONE,
+    LASER_SAMPLE_EVERY,                                 /* Every `every`th point of the file. */
+    LASER_SAMPLE_FRACTION,                              /* A `fraction` of the points, picked by hashing their index with `seed`. */
+    LASER_SAMPLE_VOXEL                                  /* The first point of every `voxel_size` cube. */
+} laserSampleMode;
 
-    info->version_major = public_header_block->version_major;
-    info->version_minor = public_header_block->version_minor;
-    info->point_format = public_header_block->format_id;
-    info->point_size = public_header_block->point_size;
-    info->point_count = public_header_block->point_count;
-    info->point_offset = public_header_block->point_offset;
-    info->scale_x = (float) public_header_block->x_scale;
-    info->scale_y = (float) public_header_block->y_scale;
-    info->scale_z = (float) public_header_block->z_scale;
-    info->offset_x = (float) public_header_block->x_offset;
-    info->offset_y = (float) public_header_block->y_offset;
-    info->offset_z = (float) public_header_block->z_offset;
-    info->min_x = (float) public_header_block->x_min;
-    info->max_x = (float) public_header_block->x_max;
-    info->min_y = (float) public_header_block->y_min;
-    info->max_y = (float) public_header_block->y_max;
-    info->min_z = (float) public_header_block->z_min;
-    info->max_z = (float) public_header_block->z_max;
-    return LASER_SUCCESS;
-}
+struct laserVoxels {
+    uint64_t* slots;
+    uint64_t capacity;
+    uint64_t count;
+};
 
-laserResult laser_read_from_mem(laserPoint* points, uint64_t stride, void* mem, uint64_t size) {
-    return laser_read_range_from_mem(points, stride, mem, size, 0, LASER_ALL_POINTS);
-}
+typedef struct laserSample {
+    laserSampleMode mode;
+    uint64_t every;
+    double fraction;
+    uint64_t seed;
+    double voxel_size;
+    laserVoxels* voxels;
+} laserSample;
 
-laserResult laser_read_range_from_mem(laserPoint* points, uint64_t stride, void* mem, uint64_t size, uint64_t first, uint64_t count) {
-    return laser_read_range_from_mem_with_attribs(points, stride == LASER_DEFAULT_STRIDE ? sizeof(laserPoint): stride, _LASER_DEFAULT_ATTRIBS, mem, size, first, count);
-}
+/*
+ *  Sampling API - Thins points inside the filtered decode loop, only the sampled points are decoded.
+ *
+ *  `laser_plan_sample` - Attaches a sampling mode to a plan, applied after its filter by `laser_file_read_filtered`, `laser_file_count_filtered` and the raster API.
+ *  Passing `0` removes it. `EVERY` and `FRACTION` only depend on the point index, any split of the file into ranges or tasks samples the same points.
+ *  Like filters, samples make the unfiltered reads fail with `LASER_ERROR_FILTERED_PLAN`.
+ *  `laser_voxels_init` - Binds a caller-provided hash table of voxel keys for `LASER_SAMPLE_VOXEL`, 8 bytes per slot.
+ *  `laser_voxels_reset` - Forgets the visited voxels, e.g. before reading the same file again.
+ *
+ *  Voxels span the header bounds with at most 2^21 voxels per axis. The table is mutated by reads, so voxel sampled reads are serial.
+ *  Reads fail with `LASER_ERROR_BUFFER_TOO_SMALL` once the table is three quarters full.
+ *
+ *  Example:
+ *      laserVoxels voxels;
+ *      laser_voxels_init(&voxels, mem, size);
+ *      laserSample sample = { LASER_SAMPLE_VOXEL };
+ *      sample.voxel_size = 0.5;
+ *      sample.voxels = &voxels;
+ *      laser_plan_sample(&plan, &file, &sample);
+ *      laser_file_read_filtered(&file, &plan, points, 0, LASER_ALL_POINTS, &count);
+ */
 
-laserResult laser_info_from_io(laserInfo* info, laserIoReadFn fn, void* usr) {
-    laserPublicHeaderBlock public_header_block;
-    uint32_t read = fn(usr, (void*) &public_header_block, sizeof(laserPublicHeaderBlock), 0);
-    if(read == sizeof(laserPublicHeaderBlock)) {
-        return laser_info_from_mem(info, (void*) &public_header_block, read);
-    }
-    return LASER_ERROR_IO_READ;
-}
+LASER_API void laser_plan_sample(laserPlan* plan, const laserFile* file, const laserSample* sample);
+LASER_API laserResult laser_voxels_init(laserVoxels* voxels, void* mem, uint64_t size);
+LASER_API void laser_voxels_reset(laserVoxels* voxels);
 
-laserResult laser_read_from_io(laserPoint* points, uint64_t stride, laserIoReadFn fn, void* usr) {
-    return laser_read_range_from_io(points, stride, fn, usr, 0, LASER_ALL_POINTS);
-}
+typedef struct laserSpan {
+    uint64_t first;
+    uint64_t count;
+} laserSpan;
 
-laserResult laser_read_range_from_io(laserPoint* points, uint64_t stride, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count) {
-    return laser_read_range_from_io_with_attribs(points, stride == LASER_DEFAULT_STRIDE ? sizeof(laserPoint): stride, _LASER_DEFAULT_ATTRIBS, fn, usr, first, count);
-}
+typedef struct laserIndex {
+    char magic[4];
+    uint32_t version;
+    uint32_t cells_x;
+    uint32_t cells_y;
+    int32_t min_x;
+    int32_t min_y;
+    uint64_t cell_size_x;
+    uint64_t cell_size_y;
+    uint64_t point_count;
+    uint64_t span_count;
+    /*
+     * Followed by:
+     * uint64_t offsets[cells_x * cells_y + 1];         First span of each cell.
+     * laserSpan spans[span_count];                     Runs of consecutive points per cell, in file order.
+     */
+} laserIndex;
 
-enum {
-    LASER_ATTRIB_FLAG_X = (1 << 0),
-    LASER_ATTRIB_FLAG_Y = (1 << 1),
-    LASER_ATTRIB_FLAG_Z = (1 << 2),
-    LASER_ATTRIB_FLAG_INTENSITY = (1 << 3),
-    LASER_ATTRIB_FLAG_FLAGS = (1 << 4),
-    LASER_ATTRIB_FLAG_CLASSIFICATION = (1 << 5),
-    LASER_ATTRIB_FLAG_SCAN_ANGLE = (1 << 6),
-    LASER_ATTRIB_FLAG_USR = (1 << 7),
-    LASER_ATTRIB_FLAG_POINT_ID = (1 << 8),
-    LASER_ATTRIB_FLAG_GPS_TIME = (1 << 9),
-    LASER_ATTRIB_FLAG_RED = (1 << 10),
-    LASER_ATTRIB_FLAG_GREEN = (1 << 11),
-    LASER_ATTRIB_FLAG_BLUE = (1 << 12),
-    LASER_ATTRIB_FLAG_WAVEFORM_ID = (1 << 13),
-    LASER_ATTRIB_FLAG_WAVEFORM_OFFSET = (1 << 14),
-    LASER_ATTRIB_FLAG_WAVEFORM_SIZE = (1 << 15),
-    LASER_ATTRIB_FLAG_WAVEFORM_LOCATION = (1 << 16),
-    LASER_ATTRIB_FLAG_X_TIME = (1 << 17),
-    LASER_ATTRIB_FLAG_Y_TIME = (1 << 18),
-    LASER_ATTRIB_FLAG_Z_TIME = (1 << 19)
+/*
+ *  Spatial Index API - A regular XY grid over the integer coordinates, each cell lists the runs of consecutive points falling into it.
+ *  The index is a single caller-allocated blob without pointers, it can be written as-is to a sidecar file and used straight from memory.
+ *
+ *  `laser_index_build` - Builds the index of `file` in two passes over the raw records, `required` receives the size of the index.
+ *  Fails with `LASER_ERROR_BUFFER_TOO_SMALL` after the first pass if `size` is too small, pass `0` to only query the size.
+ *  `laser_index_check` - Validates an index loaded from a sidecar against its file.
+ *  `laser_index_query` - Turns the bounds of `filter` into the sorted spans of the overlapping cells, spans less than `gap` points apart are coalesced.
+ *  The spans are a superset of the matches, read them with the same filter attached to the plan for exact results.
+ *
+ *  Example:
+ *      laser_index_build(0, 0, &file, 256, 256, &size);
+ *      laserIndex* index = (laserIndex*) malloc(size);
+ *      laser_index_build(index, size, &file, 256, 256, &size);
+ *      ...
+ *      laser_index_query(index, &file, &filter, 64, spans, capacity, &span_count);
+ *      for(uint64_t i = 0; i < span_count; i++) {
+ *          laser_file_read_filtered(&file, &plan, points + point_count, spans[i].first, spans[i].count, &matched);
+ *          point_count += matched;
+ *      }
+ */
+
+LASER_API laserResult laser_index_build(laserIndex* index, uint64_t size, const laserFile* file, uint32_t cells_x, uint32_t cells_y, uint64_t* required);
+LASER_API laserResult laser_index_check(const laserIndex* index, uint64_t size, const laserFile* file);
+LASER_API laserResult laser_index_query(const laserIndex* index, const laserFile* file, const laserFilter* filter, uint64_t gap, laserSpan* spans, uint64_t capacity, uint64_t* span_count);
+
+struct laserStats {
+    uint64_t point_count;
+    int32_t min_x;
+    int32_t min_y;
+    int32_t min_z;
+    int32_t max_x;
+    int32_t max_y;
+    int32_t max_z;
+    uint64_t return_counts[16];                         /* Indexed by return number. */
+    uint64_t classification_counts[256];
+    uint32_t intensity_min;
+    uint32_t intensity_max;
+    uint64_t intensity_sum;                             /* Mean is `intensity_sum / point_count`. */
 };
 
-static laserResult _laser_read_attribs_from_mem(void* points, uint64_t stride, uint32_t flags, uint64_t* offsets, laserInfo* info, void* raw_points, uint64_t size, uint64_t first, uint64_t count) {
-    (void) size;
+/*
+ *  Stats API - Accumulates statistics of the decoded points in the same pass as the decode, on the raw records while they are hot.
+ *
+ *  `laser_plan_stats` - Attaches `stats_count` accumulators to a plan, every read through the plan adds to `stats[0]`.
+ *  Parallel reads use up to `stats_count` tasks, each accumulating into its own entry, and merge them into `stats[0]` when done.
+ *  Filtered reads only accumulate the matches.
+ *  `laser_stats_init` - Resets an accumulator.
+ *  `laser_stats_merge` - Adds `other` into `stats`.
+ *  `laser_stats_apply` - Replaces the header bounds of `info` with the accumulated ones, exact in integer space. The point
+ *  count is left alone, compare it with `stats->point_count` instead. Apply to a copy, the bounds of a `laserFile`'s own
+ *  info place its index cells and curve keys.
+ *
+ *  The accumulators are written through the `const laserPlan*` of every read. A plan with stats attached is therefore
+ *  not thread-safe: two reads through it at the same time (e.g. from different threads or catalog tasks) race on
+ *  `stats[0]`. Give every thread its own plan and accumulators and merge them afterwards, a single parallel read is fine.
+ *
+ *  Example:
+ *      laserStats stats[8];
+ *      laser_stats_init(&stats[0]);
+ *      laser_plan_stats(&plan, stats, 8);
+ *      laser_file_read_range_parallel(&file, &plan, points, 0, LASER_ALL_POINTS, &scheduler);
+ *      laserInfo info = file.info;
+ *      laser_stats_apply(&stats[0], &info);
+ */
 
-    count = count == LASER_ALL_POINTS ? info->point_count: count;
-    if((first + count) > info->point_count) {
-        return LASER_ERROR_INVALID_RANGE;
-    }
+LASER_API void laser_plan_stats(laserPlan* plan, laserStats* stats, uint32_t stats_count);
+LASER_API void laser_stats_init(laserStats* stats);
+LASER_API void laser_stats_merge(laserStats* stats, const laserStats* other);
+LASER_API void laser_stats_apply(const laserStats* stats, laserInfo* info);
 
-    uint8_t* raw_point = ((uint8_t*) raw_points) + (first * info->point_size);
-    uint8_t* point = (uint8_t*) points;
-    uint64_t point_size = info->point_size;
-    uint32_t point_format = info->point_format;
-    float scale_x = info->scale_x;
-    float scale_y = info->scale_y;
-    float scale_z = info->scale_z;
-    float offset_x = info->offset_x;
-    float offset_y = info->offset_y;
-    float offset_z = info->offset_z;
-    const uint64_t* offset_table = _LASER_ATTRIB_OFFSET_TABLE[point_format];
-    for(uint64_t i = 0; i < count; i++) {
-        if(flags & LASER_ATTRIB_FLAG_X) {
-            *((float*) (point + offsets[LASER_ATTRIB_TYPE_X])) = *((int32_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_X])) * scale_x + offset_x;
-        }
-        if(flags & LASER_ATTRIB_FLAG_Y) {
-            *((float*) (point + offsets[LASER_ATTRIB_TYPE_Y])) = *((int32_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_Y])) * scale_y + offset_y;
-        }
-        if(flags & LASER_ATTRIB_FLAG_Z) {
-            *((float*) (point + offsets[LASER_ATTRIB_TYPE_Z])) = *((int32_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_Z])) * scale_z + offset_z;
-        }
-        if(flags & LASER_ATTRIB_FLAG_INTENSITY) {
-            *((uint16_t*) (point + offsets[LASER_ATTRIB_TYPE_INTENSITY])) = *((uint16_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_INTENSITY]));
-        }
-        if(flags & LASER_ATTRIB_FLAG_FLAGS) {
-            *((uint8_t*) (point + offsets[LASER_ATTRIB_TYPE_FLAGS])) = *((uint8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_FLAGS]));
-        }
-        if(flags & LASER_ATTRIB_FLAG_CLASSIFICATION) {
-            *((uint8_t*) (point + offsets[LASER_ATTRIB_TYPE_CLASSIFICATION])) = *((uint8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_CLASSIFICATION]));
-        }
-        if(flags & LASER_ATTRIB_FLAG_SCAN_ANGLE) {
-            *((int8_t*) (point + offsets[LASER_ATTRIB_TYPE_SCAN_ANGLE])) = *((int8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_SCAN_ANGLE]));
-        }
-        if(flags & LASER_ATTRIB_FLAG_USR) {
-            *((uint8_t*) (point + offsets[LASER_ATTRIB_TYPE_USR])) = *((uint8_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_USR]));
-        }
-        if(flags & LASER_ATTRIB_FLAG_POINT_ID) {
-            *((uint16_t*) (point + offsets[LASER_ATTRIB_TYPE_POINT_ID])) = *((uint16_t*) (raw_point + offset_table[LASER_ATTRIB_TYPE_POINT_ID]));
-        }
-        point += stride;
-        raw_point += point_size;
-    }
-    return LASER_SUCCESS;
-}
+typedef struct laserScheduler laserScheduler;
 
-laserResult laser_read_range_from_mem_with_attribs(void* points, uint64_t stride, laserAttrib* attribs, void* mem, uint64_t size, uint64_t first, uint64_t count) {
-    laserInfo info;
-    laserResult res = LASER_SUCCESS;
-    if((res = laser_info_from_mem(&info, mem, size)) != LASER_SUCCESS) {
-        return res;
-    }
+typedef struct laserCursor {
+    const laserFile* file;
+    const laserPlan* plan;
+    uint8_t* scratch;
+    uint64_t scratch_size;
+    uint64_t next;
+    uint64_t end;
+    laserScheduler* scheduler;
+    uint8_t* buffers[2];
+    uint8_t* ready_data;
+    uint64_t ready_count;
+    uint8_t* fetch_buffer;
+    uint64_t fetch_first;
+    uint64_t fetch_count;
+    uint64_t fetch_end;
+    uint64_t fetch_read;
+    laserResult result;
+} laserCursor;
 
-    uint64_t offsets[LASER_ATTRIB_TYPE_COUNT];
-    uint32_t flags = 0;
-    for(uint64_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && attribs[i].type != LASER_ATTRIB_TYPE_NONE; i++) {
-        offsets[attribs[i].type] = attribs[i].offset;
-        flags |= 1 << attribs[i].type;
-    }
-    return _laser_read_attribs_from_mem(points, stride, flags, offsets, &info, ((uint8_t*) mem) + info.point_offset, size, first, count);
-}
+/*
+ *  Streaming API - Decodes a range in batches, each `laserIoReadFn` call fills as much of the caller's scratch buffer as possible.
+ *
+ *  `laser_cursor_init` - Prepares to read `[first, first + count)`, `LASER_ALL_POINTS` reads to the end of the file. `scratch` is unused for files opened from memory and LAZ files.
+ *  `laser_cursor_next` - Decodes the next batch of at most `capacity` points to the start of `points` (or the plan's columns), `*decoded` is 0 once the range is exhausted.
+ *  Errors are sticky, once a batch failed every later call returns the same error.
+ *
+ *  `laser_cursor_init_pipelined` - Same as above but splits `scratch` in two, the next read is submitted to `scheduler` while the current batch is decoded.
+ *  `laser_cursor_close` - Waits for an outstanding prefetch, required before releasing `scratch` when a pipelined cursor is abandoned early.
+ *
+ *  A batch holds at most `scratch_size / point_size` points (half that when pipelined), a few MiB of scratch keeps the callback overhead negligible.
+ *
+ *  Example:
+ *      laserCursor cursor;
+ *      laser_cursor_init(&cursor, &file, &plan, scratch, 16 << 20, 0, LASER_ALL_POINTS);
+ *      uint64_t decoded = 0;
+ *      while(laser_cursor_next(&cursor, points, capacity, &decoded) == LASER_SUCCESS && decoded) {
+ *          consume(points, decoded);
+ *      }
+ */
 
-laserResult laser_read_range_from_io_with_attribs(void* points, uint64_t stride, laserAttrib* attribs, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count) {
-    laserInfo info;
-    laserResult res = LASER_SUCCESS;
-    if((res != laser_info_from_io(&info, fn, usr)) != LASER_SUCCESS) {
-        return res;
-    }
-    uint64_t offsets[LASER_ATTRIB_TYPE_COUNT];
-    uint32_t flags = 0;
-    for(uint64_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && attribs[i].type != LASER_ATTRIB_TYPE_NONE; i++) {
-        offsets[attribs[i].type] = attribs[i].offset;
-        flags |= 1 << attribs[i].type;
-    }
+LASER_API laserResult laser_cursor_init(laserCursor* cursor, const laserFile* file, const laserPlan* plan, void* scratch, uint64_t scratch_size, uint64_t first, uint64_t count);
+LASER_API laserResult laser_cursor_init_pipelined(laserCursor* cursor, const laserFile* file, const laserPlan* plan, void* scratch, uint64_t scratch_size, uint64_t first, uint64_t count, laserScheduler* scheduler);
+LASER_API laserResult laser_cursor_next(laserCursor* cursor, void* points, uint64_t capacity, uint64_t* decoded);
+LASER_API void laser_cursor_close(laserCursor* cursor);
 
-    uint8_t point_buffer[2048];
+#if !defined(LASER_MAX_TASKS)
+#define LASER_MAX_TASKS 64
+#endif
 
-    count = count == LASER_ALL_POINTS ? info.point_count: count;
-    uint64_t max_point_count = sizeof(point_buffer) / info.point_size;
-    uint64_t point_count = count > max_point_count ? max_point_count: count;
+typedef void (*laserTaskFn)(void* arg);
 
-    uint64_t read_count = count / max_point_count;
-    read_count = !read_count ? 1: read_count;
+struct laserScheduler {
+    void (*submit)(void* usr, laserTaskFn fn, void* arg);
+    void (*wait)(void* usr);
+    void* usr;
+    uint32_t task_count;
+};
 
-    uint64_t expected = info.point_size * point_count;
-    for(uint64_t i = 0; i < read_count; i++) {
-        uint64_t offset = info.point_offset + ((i + first) * info.point_size * point_count);
-        uint64_t read = fn(usr, (void*) point_buffer, expected, offset);
-        if(read == expected) {
-            res = _laser_read_attribs_from_mem(((uint8_t*) points) + (i * point_count), stride, flags, offsets, &info, (void*) point_buffer, read, 0, point_count);
-            if(res != LASER_SUCCESS) {
-                return res;
-            }
-        } else {
-            return LASER_ERROR_IO_READ;
-        }
-    }
-    return LASER_SUCCESS;
+/*
+ *  Parallel API - Splits a range into `task_count` chunks and decodes them concurrently, the output is identical to the serial API.
+ *
+ *  `laser_*_parallel` - Requires the entire LAS file to be in memory, every chunk is passed to `scheduler->submit` and joined with `scheduler->wait`.
+ *  `laser_file_read_range_parallel` - Same as above through a `laserFile` opened with `laser_open_from_mem`.
+ *
+ *  Chunk descriptors live on the stack, at most `LASER_MAX_TASKS` chunks are used. `submit` may run the task inline.
+ *
+ *  Example:
+ *      laserThreads threads;
+ *      laserScheduler scheduler;
+ *      laser_threads_scheduler(&scheduler, &threads, 8);
+ *      laserResult result = laser_read_range_from_mem_with_attribs_parallel(points, 12, attribs, las_file_data, las_file_size, 0, LASER_ALL_POINTS, &scheduler);
+ *      laser_threads_close(&threads);
+ */
+
+LASER_API laserResult laser_read_range_from_mem_with_attribs_parallel(void* points, uint64_t stride, laserAttrib* attribs, void* mem, uint64_t size, uint64_t first, uint64_t count, laserScheduler* scheduler);
+LASER_API laserResult laser_read_range_from_mem_columns_parallel(laserColumn* columns, void* mem, uint64_t size, uint64_t first, uint64_t count, laserScheduler* scheduler);
+LASER_API laserResult laser_file_read_range_parallel(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count, laserScheduler* scheduler);
+
+typedef struct laserCatalogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t _;
+    uint64_t names_size;
+} laserCatalogHeader;
+
+typedef struct laserCatalogEntry {
+    uint64_t point_count;
+    uint64_t name_offset;
+    uint32_t name_size;
+    uint32_t point_format;
+    uint32_t point_size;
+    uint32_t point_offset;
+    double min_x;
+    double min_y;
+    double min_z;
+    double max_x;
+    double max_y;
+    double max_z;
+} laserCatalogEntry;
+
+typedef struct laserCatalog {
+    uint8_t* mem;
+    uint64_t size;
+    uint32_t capacity;
+    uint32_t entry_count;
+    uint64_t names_size;
+    laserCatalogEntry* entries;
+    char* names;
+} laserCatalog;
+
+typedef void (*laserCatalogFn)(void* usr, const laserCatalog* catalog, uint32_t tile);
+
+/*
+ *  Catalog API - Header-only index over many tiles, stored as one blob: header | entries | names.
+ *
+ *  `laser_catalog_begin` - Starts a catalog of at most `capacity` tiles in caller memory.
+ *  `laser_catalog_add` - Adds a tile, `name` is stored as-is (typically a path relative to the dataset).
+ *  `laser_catalog_finish` - Packs the blob, `size` receives the number of bytes to persist starting at `mem`.
+ *  `laser_catalog_load` - Uses a persisted catalog in place, nothing is copied.
+ *  `laser_catalog_query` - Returns the tiles whose bounds overlap the bounds of `filter`, every tile without `LASER_FILTER_BOUNDS`.
+ *  `laser_catalog_for_each` - Calls `fn` for each of `tiles` (all tiles if `0`), spread over `scheduler` if given.
+ *  `laser_catalog_scan` - Adds every `.las` file in `directory` and reads their headers through `scheduler` (requires `LASER_CATALOG_SCAN`, POSIX).
+ *  Files that fail to open or parse are skipped.
+ *
+ *  Example:
+ *      laser_catalog_begin(&catalog, mem, size, 65536);
+ *      laser_catalog_scan(&catalog, "tiles", &scheduler);
+ *      laser_catalog_finish(&catalog, &size);
+ *      fwrite(mem, 1, size, catalog_file);
+ *      ...
+ *      laser_catalog_load(&catalog, catalog_data, catalog_size);
+ *      laser_catalog_query(&catalog, &filter, tiles, capacity, &tile_count);
+ *      laser_catalog_for_each(&catalog, tiles, tile_count, read_tile, &ctx, &scheduler);
+ */
+
+LASER_API laserResult laser_catalog_begin(laserCatalog* catalog, void* mem, uint64_t size, uint32_t capacity);
+LASER_API laserResult laser_catalog_add(laserCatalog* catalog, const char* name, const laserInfo* info);
+LASER_API laserResult laser_catalog_finish(laserCatalog* catalog, uint64_t* size);
+LASER_API laserResult laser_catalog_load(laserCatalog* catalog, void* mem, uint64_t size);
+LASER_API const char* laser_catalog_name(const laserCatalog* catalog, uint32_t tile);
+LASER_API laserResult laser_catalog_query(const laserCatalog* catalog, const laserFilter* filter, uint32_t* tiles, uint32_t capacity, uint32_t* tile_count);
+LASER_API void laser_catalog_for_each(const laserCatalog* catalog, const uint32_t* tiles, uint32_t tile_count, laserCatalogFn fn, void* usr, laserScheduler* scheduler);
+
+#if defined(LASER_CATALOG_SCAN)
+LASER_API laserResult laser_catalog_scan(laserCatalog* catalog, const char* directory, laserScheduler* scheduler);
+#endif
+
+typedef enum laserCurve {
+    LASER_CURVE_MORTON,                                 /* 21 bits per axis, XYZ */
+    LASER_CURVE_HILBERT,                                /* 21 bits per axis, XYZ */
+    LASER_CURVE_MORTON_XY,                              /* 32 bits per axis, XY  */
+    LASER_CURVE_HILBERT_XY                              /* 32 bits per axis, XY  */
+} laserCurve;
+
+/*
+ *  Spatial Sort API - Reorders points along a space-filling curve for better locality in downstream stages.
+ *
+ *  `laser_file_curve_keys` - Computes a curve key per point from the raw integer coordinates, relative to the header bounds, and the matching point indices.
+ *  `laser_sort_keys` - Parallel LSD radix sort of the keys, carrying the indices along. `scratch` must hold `laser_sort_scratch_size` bytes.
+ *  `laser_file_read_indices` - Decodes the points at `indices`, in that order, through a plan. LAZ files take non-decreasing indices only, so every chunk is decompressed at most once, others fail with `LASER_ERROR_INVALID_RANGE` before anything is read. Read curve orders of LAZ files from a decompressed copy.
+ *  Files opened from IO take one `laserIoReadFn` call per run of ascending indices within `LASER_IO_BUFFER_SIZE` bytes, sorting them pays off there as well.
+ *  `laser_lod_order` - Reorders curve sorted `indices` into `lod` by bit-reversed rank, any prefix of `lod` is spread evenly along the curve.
+ *  Reading the first `k` indices of `lod` gives a spatially uniform level of detail, every further prefix refines it.
+ *
+ *  Example:
+ *      laser_file_curve_keys(&file, LASER_CURVE_HILBERT, 0, LASER_ALL_POINTS, keys, indices);
+ *      laser_sort_keys(keys, indices, point_count, scratch, laser_sort_scratch_size(point_count, &scheduler), &scheduler);
+ *      laser_file_read_indices(&file, &plan, points, indices, point_count);
+ *      ...
+ *      laser_lod_order(indices, keys, point_count);
+ *      laser_file_read_indices(&file, &plan, points, keys, budget);
+ */
+
+LASER_API laserResult laser_file_curve_keys(const laserFile* file, laserCurve curve, uint64_t first, uint64_t count, uint64_t* keys, uint64_t* indices);
+LASER_API uint64_t laser_sort_scratch_size(uint64_t count, const laserScheduler* scheduler);
+LASER_API laserResult laser_sort_keys(uint64_t* keys, uint64_t* indices, uint64_t count, void* scratch, uint64_t scratch_size, laserScheduler* scheduler);
+LASER_API laserResult laser_file_read_indices(const laserFile* file, const laserPlan* plan, void* points, const uint64_t* indices, uint64_t count);
+LASER_API void laser_lod_order(const uint64_t* indices, uint64_t* lod, uint64_t count);
+
+typedef enum laserRasterReduce {
+    LASER_RASTER_MIN,
+    LASER_RASTER_MAX,
+    LASER_RASTER_MEAN,
+    LASER_RASTER_COUNT
+} laserRasterReduce;
+
+typedef enum laserRasterValue {
+    LASER_RASTER_Z,
+    LASER_RASTER_INTENSITY
+} laserRasterValue;
+
+enum {
+    LASER_RASTER_LAST_RETURNS = (1 << 0)
+};
+
+typedef struct laserRaster {
+    double origin_x;                                    /* Lower left corner of cell (0, 0), rows go up in Y. */
+    double origin_y;
+    double cell_size;
+    uint32_t width;
+    uint32_t height;
+    laserRasterReduce reduce;
+    laserRasterValue value;
+    uint32_t flags;
+    float nodata;
+    float* cells;
+    uint32_t* counts;
+    double scale_x;
+    double bias_x;
+    double scale_y;
+    double bias_y;
+    float value_scale;
+    float value_offset;
+    uint32_t return_mask;
+    uint32_t return_count_shift;
+} laserRaster;
+
+/*
+ *  Raster API - Bins raw point records straight into a caller-provided grid, no point array is ever produced.
+ *
+ *  Fill in the grid geometry, `reduce`, `value`, `flags` and `nodata` of a `laserRaster`, then:
+ *  `laser_raster_size` - Returns the bytes of caller memory a raster needs.
+ *  `laser_raster_init` - Binds the raster to `file` and resets it.
+ *  `laser_file_rasterize` - Adds a range of points, only the filter of `plan` is used and `plan` may be `0`.
+ *  `laser_file_rasterize_parallel` - Same for uncompressed memory files, with partial grids carved out of `scratch` and merged at the end.
+ *  `laser_raster_merge` - Merges a raster of the same geometry, e.g. from another tile or thread.
+ *  `laser_raster_finish` - Turns the accumulators into values, empty cells become `nodata`. `COUNT` rasters hold the counts as floats.
+ *
+ *  `LASER_RASTER_LAST_RETURNS` only bins last returns, e.g. a minimum last return grid as a quick DEM.
+ *
+ *  Example:
+ *      laserRaster dem = { origin_x, origin_y, 1.0, 1000, 1000, LASER_RASTER_MIN, LASER_RASTER_Z, 0, -9999.0f };
+ *      void* mem = malloc(laser_raster_size(&dem));
+ *      laser_raster_init(&dem, &file, mem, laser_raster_size(&dem));
+ *      laser_file_rasterize(&file, &plan, &dem, 0, LASER_ALL_POINTS);
+ *      laser_raster_finish(&dem);
+ */
+
+LASER_API uint64_t laser_raster_size(const laserRaster* raster);
+LASER_API laserResult laser_raster_init(laserRaster* raster, const laserFile* file, void* mem, uint64_t size);
+LASER_API laserResult laser_file_rasterize(const laserFile* file, const laserPlan* plan, laserRaster* raster, uint64_t first, uint64_t count);
+LASER_API laserResult laser_file_rasterize_parallel(const laserFile* file, const laserPlan* plan, laserRaster* raster, uint64_t first, uint64_t count, void* scratch, uint64_t scratch_size, laserScheduler* scheduler);
+LASER_API void laser_raster_merge(laserRaster* raster, const laserRaster* other);
+LASER_API void laser_raster_finish(laserRaster* raster);
+
+/*
+ *  LAZ API - Decompresses LAZ (LASzip) files while reading, every other API then treats them like uncompressed files.
+ *
+ *  EXPERIMENTAL: the decoder has not yet been checked against files written by LASzip itself, only against an
+ *  independent encoder. `test/laz.c` compares it with LASzip-produced pairs, none of which ship with the library yet.
+ *
+ *  `laser_open_from_*` recognise LAZ files, `info.compressed` is set and `info.point_format` is the uncompressed format.
+ *  `laser_laz_size` - Sets `*size` to the bytes of caller memory needed for the chunk table and `decoders` decoder states.
+ *  `laser_laz_attach` - Reads the chunk table into `mem` and sets up the decoders, required before reading a LAZ file.
+ *
+ *  Supports chunked LASzip with the version 2 point10, gpstime11, rgb12 and byte items, i.e. point formats 0 - 3 with or
+ *  without extra bytes as written by LASzip 2.0 and later, other layouts fail with `LASER_ERROR_FORMAT_UNSUPPORTED`.
+ *  A read starting in the middle of a chunk decodes and skips the points before it, a read continuing where the last one
+ *  stopped does not. Parallel reads split ranges at chunk boundaries and use one decoder per task, every other read uses
+ *  the first decoder, so reads of the same file must not overlap in time beyond that. Both calls are no-ops on LAS files.
+ *
+ *  Reads without attached decoders fail with `LASER_ERROR_BUFFER_TOO_SMALL`, including the simple, granular and columnar
+ *  calls which open the file internally. A decoder state is about 2 MiB.
+ *
+ *  Example:
+ *      laserFile file;
+ *      laser_open_from_io(&file, laz_read, laz_file);
+ *      uint64_t size = 0;
+ *      laser_laz_size(&file, 8, &size);
+ *      laser_laz_attach(&file, malloc(size), size, 8);
+ *      laser_file_read_range_parallel(&file, &plan, points, 0, LASER_ALL_POINTS, &scheduler);
+ */
+
+LASER_API laserResult laser_laz_size(const laserFile* file, uint32_t decoders, uint64_t* size);
+LASER_API laserResult laser_laz_attach(laserFile* file, void* mem, uint64_t size, uint32_t decoders);
+
+typedef uint64_t (*laserIoWriteFn)(void* usr, const void* data, uint64_t size, uint64_t offset);
+
+enum {
+    LASER_WRITER_DOUBLE_XYZ = (1 << 0)
+};
+
+typedef struct laserWriterInfo {
+    uint32_t version_minor;
+    uint32_t point_format;
+    uint32_t point_size;
+    uint32_t flags;
+    double scale_x;
+    double scale_y;
+    double scale_z;
+    double offset_x;
+    double offset_y;
+    double offset_z;
+    double time_base;
+    const void* vlrs;
+    uint64_t vlr_size;
+    uint32_t vlr_count;
+} laserWriterInfo;
+
+typedef struct laserWriter {
+    laserWriterInfo info;
+    laserIoWriteFn fn;
+    void* usr;
+    uint8_t* buffer;
+    uint64_t buffer_size;
+    uint64_t buffer_used;
+    uint64_t offset;
+    uint32_t header_size;
+    uint32_t point_offset;
+    uint64_t point_count;
+    uint64_t return_counts[16];
+    double quantize_scale[3];
+    double quantize_offset[3];
+    double min[3];
+    double max[3];
+    laserResult result;
+} laserWriter;
+
+/*
+ *  Writer API - Streams points into a LAS file through a write callback, records are assembled in a caller-provided buffer.
+ *
+ *  `laser_writer_begin` - Writes the header and `info.vlrs` (`vlr_count` records, `vlr_size` bytes, copied verbatim).
+ *  `laser_write_attribs` / `laser_write_columns` - Encode `count` points from the same layouts the granular and
+ *  columnar reads produce, attributes the layout leaves out are written as zeros.
+ *  `laser_writer_finish` - Flushes the buffer and patches the point counts, return counts and bounds into the header.
+ *
+ *  `info.version_minor` of `0` picks 1.2 for formats 0 - 3, 1.3 for 4 and 5 and 1.4 for 6 - 10, versions older than
+ *  the one that introduced the format fail with `LASER_ERROR_FORMAT_UNSUPPORTED`. `info.point_size` of `0` picks the size
+ *  of the format and anything larger adds extra bytes (left zero). X, Y and Z are `float` like in the read layouts,
+ *  `LASER_WRITER_DOUBLE_XYZ` reads them as `double` instead. Coordinates are quantized in double precision, rounded to
+ *  nearest (ties to even) and clamped to int32, the header bounds are the exact dequantized extremes. `info.time_base` is
+ *  added back to `LASER_ATTRIB_TYPE_GPS_TIME_RELATIVE`.
+ *
+ *  Attributes are converted the same way the reads convert them, in reverse: the legacy attributes map into the LAS 1.4
+ *  fields for formats 6 - 10 and the extended attributes into the legacy fields for 0 - 5, saturating where the target
+ *  is narrower. Attributes which share a field (e.g. `FLAGS` and `EXTENDED_RETURNS`) are combined, pass only one of them.
+ *
+ *  The buffer is flushed whenever it fills up, so the callback sees writes of `buffer_size` rounded down to whole records
+ *  at increasing offsets, followed by the header rewrite at offset 0. Errors are sticky, every later call returns the
+ *  first error, a callback writing fewer bytes than asked fails with `LASER_ERROR_IO_WRITE`.
+ *
+ *  Example:
+ *      laserWriterInfo info = { 0, 3, 0, 0, 0.01, 0.01, 0.01, 500000.0, 4000000.0, 0.0, 0.0, 0, 0, 0 };
+ *      laserWriter writer;
+ *      laser_writer_begin(&writer, &info, malloc(1 << 22), 1 << 22, las_write, las_file);
+ *      laser_write_attribs(&writer, points, stride, attribs, point_count);
+ *      laser_writer_finish(&writer);
+ */
+
+LASER_API laserResult laser_writer_begin(laserWriter* writer, const laserWriterInfo* info, void* buffer, uint64_t buffer_size, laserIoWriteFn fn, void* usr);
+LASER_API laserResult laser_write_attribs(laserWriter* writer, const void* points, uint64_t stride, const laserAttrib* attribs, uint64_t count);
+LASER_API laserResult laser_write_columns(laserWriter* writer, const laserColumn* columns, uint64_t count);
+LASER_API laserResult laser_writer_finish(laserWriter* writer);
+
+typedef struct laserCacheSlot {
+    uint64_t file;
+    uint64_t block;
+    uint64_t length;
+    uint32_t next;
+    uint32_t pins;
+    uint32_t state;
+    uint32_t referenced;
+} laserCacheSlot;
+
+typedef struct laserCache {
+    uint8_t* data;
+    laserCacheSlot* slots;
+    uint32_t* buckets;
+    uint32_t bucket_mask;
+    uint32_t block_count;
+    uint64_t block_size;
+    uint32_t hand;
+    long lock;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t bytes_saved;
+    uint64_t bytes_read;
+} laserCache;
+
+typedef struct laserCacheFile {
+    laserCache* cache;
+    uint64_t id;
+    laserIoReadFn fn;
+    void* usr;
+} laserCacheFile;
+
+typedef struct laserCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t bytes_saved;
+    uint64_t bytes_read;
+    double hit_rate;
+} laserCacheStats;
+
+/*
+ *  Cache API - A fixed-capacity block cache between the `_from_io` reads and a `laserIoReadFn`, in caller-provided memory.
+ *
+ *  `laser_cache_size` / `laser_cache_init` - Size and set up a cache of `block_count` blocks of `block_size` bytes.
+ *  `laser_cache_file` - Binds a file's `fn` and `usr` to the cache under `id`, blocks are keyed by `id` and block index.
+ *  `laser_cache_read` - The `laserIoReadFn`, pass the `laserCacheFile` as `usr`.
+ *  `laser_cache_stats` - Snapshot of the counters, `bytes_saved` counts bytes served without calling `fn`.
+ *
+ *  Every read goes through the cache, the header included, and misses load whole blocks. Blocks are evicted with
+ *  CLOCK (second chance). Any number of threads may read through one cache: a short spin lock guards the lookup,
+ *  block data is copied outside of it while the block is pinned, so `fn` must be safe to call concurrently (e.g.
+ *  `pread`). A reader that finds a block still being loaded by another thread reads around it through `fn`. Ids must
+ *  be unique per file content, bind a changed file under a new id.
+ *
+ *  Example:
+ *      laserCache cache;
+ *      uint64_t size = laser_cache_size(1 << 16, 4096);
+ *      laser_cache_init(&cache, malloc(size), size, 1 << 16, 4096);
+ *      laserCacheFile cached;
+ *      laser_cache_file(&cached, &cache, tile_id, las_read, las_file);
+ *      laser_read_range_from_io_with_attribs(points, 12, attribs, laser_cache_read, &cached, first, count);
+ */
+
+LASER_API uint64_t laser_cache_size(uint64_t block_size, uint32_t block_count);
+LASER_API laserResult laser_cache_init(laserCache* cache, void* mem, uint64_t size, uint64_t block_size, uint32_t block_count);
+LASER_API void laser_cache_file(laserCacheFile* file, laserCache* cache, uint64_t id, laserIoReadFn fn, void* usr);
+LASER_API uint64_t laser_cache_read(void* usr, void* data, uint64_t size, uint64_t offset);
+LASER_API void laser_cache_stats(laserCache* cache, laserCacheStats* stats);
+
+enum {
+    LASER_COLUMNAR_RAW_XYZ = (1 << 0)
+};
+
+typedef enum laserColumnarEncoding {
+    LASER_COLUMNAR_DECODED,
+    LASER_COLUMNAR_RAW
+} laserColumnarEncoding;
+
+typedef struct laserColumnarSection {
+    laserAttribType type;
+    laserColumnarEncoding encoding;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+} laserColumnarSection;
+
+typedef struct laserColumnar {
+    laserInfo info;
+    double scale[3];
+    double offset[3];
+    const uint8_t* mem;
+    uint64_t size;
+    uint32_t section_count;
+    laserColumnarSection sections[LASER_ATTRIB_TYPE_COUNT];
+} laserColumnar;
+
+/*
+ *  Columnar Cache API - Exports a LAS file into a laser-native columnar file, reloading it is a header parse.
+ *
+ *  `laser_columnar_export` - Decodes `types` (terminated by `LASER_ATTRIB_TYPE_NONE`) of every point in `file` into
+ *  one section per attribute, written through `fn` in batches that fit `scratch`. Any readable file works, LAZ included.
+ *  `laser_columnar_open` - Validates a columnar file in memory (loaded or mapped), the sections are not touched.
+ *  `laser_columnar_column` - Returns the zero-copy column of `type`, `0` if the file doesn't have it.
+ *  `laser_columnar_verify` - Checks the checksum of one section, or of all of them for `LASER_ATTRIB_TYPE_NONE`.
+ *
+ *  The file is a 4096 byte header page followed by the sections, each starting on a 4096 byte boundary, so columns are
+ *  page aligned when the file is mapped. Columns hold the types of the granular read (packed), `LASER_COLUMNAR_RAW_XYZ`
+ *  keeps X, Y and Z as the quantized `int32_t` instead, `columnar.scale` and `columnar.offset` hold the exact (double)
+ *  header values to dequantize them. The header carries its own checksum and is always checked, section checksums
+ *  (Fletcher-style over 32-bit words) only on request since checking reads the whole column.
+ *
+ *  Example:
+ *      laserAttribType types[] = { LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_ATTRIB_TYPE_NONE };
+ *      laser_columnar_export(&file, types, 0, scratch, scratch_size, cache_write, cache_file);
+ *      ...
+ *      laserColumnar columnar;
+ *      laser_columnar_open(&columnar, cache_data, cache_size);
+ *      const float* x = (const float*) laser_columnar_column(&columnar, LASER_ATTRIB_TYPE_X);
+ */
+
+LASER_API laserResult laser_columnar_export(const laserFile* file, const laserAttribType* types, uint32_t flags, void* scratch, uint64_t scratch_size, laserIoWriteFn fn, void* usr);
+LASER_API laserResult laser_columnar_open(laserColumnar* columnar, const void* mem, uint64_t size);
+LASER_API const void* laser_columnar_column(const laserColumnar* columnar, laserAttribType type);
+LASER_API laserResult laser_columnar_verify(const laserColumnar* columnar, laserAttribType type);
+
+#if defined(LASER_PTHREADS)
+typedef struct laserThreadTask {
+    laserTaskFn fn;
+    void* arg;
+} laserThreadTask;
+
+typedef struct laserThreads {
+    pthread_t threads[LASER_MAX_TASKS];
+    laserThreadTask tasks[LASER_MAX_TASKS];             /* Queue of submitted tasks, `queued` of them from `first` on. */
+    pthread_mutex_t mutex;
+    pthread_cond_t submitted;
+    pthread_cond_t finished;
+    uint32_t count;
+    uint32_t first;
+    uint32_t queued;
+    uint32_t running;
+    uint32_t stop;
+} laserThreads;
+
+/*
+ *  Threads API - A pool of worker threads behind a `laserScheduler`, created once and reused by every read.
+ *
+ *  `laser_threads_scheduler` - Starts `task_count` workers (at least one, at most `LASER_MAX_TASKS`) and points `scheduler` at them.
+ *  `submit` queues a task for the next idle worker and `wait` blocks until the queue is empty and every worker is idle.
+ *  `threads` must stay in place until closed. When no worker could be started tasks run inline. Tasks must not wait on
+ *  their own pool, e.g. catalog callbacks need a serial read or a second pool.
+ *  `laser_threads_close` - Lets the workers finish the queued tasks, then joins them.
+ */
+
+LASER_API void laser_threads_scheduler(laserScheduler* scheduler, laserThreads* threads, uint32_t task_count);
+LASER_API void laser_threads_close(laserThreads* threads);
+#endif
+
+#if defined(LASER_IO_URING)
+enum {
+    LASER_URING_DIRECT = (1 << 0),
+    LASER_URING_REGISTER_BUFFERS = (1 << 1)
+};
+
+typedef struct laserUring {
+    int file;
+    int ring;
+    uint32_t flags;
+    uint32_t depth;
+    uint8_t* bounce;
+    uint64_t bounce_size;
+    void* sq_ring;
+    uint64_t sq_ring_size;
+    void* cq_ring;
+    uint64_t cq_ring_size;
+    void* sqes;
+    uint64_t sqes_size;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_mask;
+    uint32_t* sq_array;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t* cq_mask;
+    void* cqes;
+} laserUring;
+
+/*
+ *  io_uring API (Linux) - A native file backend serving the `laserIoReadFn` contract.
+ *
+ *  `laser_uring_open` - Opens `path` and sets up a ring with `depth` entries, every read is split into `LASER_URING_SEGMENT_SIZE` pieces with up to `depth` of them in flight.
+ *  `laser_uring_read` - The `laserIoReadFn`, pass the `laserUring` as `usr`.
+ *  `laser_uring_close` - Tears down the ring and closes the file.
+ *
+ *  `LASER_URING_DIRECT` opens the file with `O_DIRECT` and reads through `bounce`, a caller-provided buffer aligned to `LASER_URING_ALIGNMENT`.
+ *  `LASER_URING_REGISTER_BUFFERS` registers `bounce` with the kernel and uses fixed-buffer reads.
+ *  If io_uring is unavailable (old kernel, seccomp) reads fall back to `pread`.
+ *
+ *  Example:
+ *      laserUring uring;
+ *      laser_uring_open(&uring, "tile.las", 8, 0, 0, 0);
+ *      laserFile file;
+ *      laser_open_from_io(&file, laser_uring_read, &uring);
+ *      ...
+ *      laser_uring_close(&uring);
+ */
+
+LASER_API laserResult laser_uring_open(laserUring* uring, const char* path, uint32_t depth, uint32_t flags, void* bounce, uint64_t bounce_size);
+LASER_API uint64_t laser_uring_read(void* usr, void* data, uint64_t size, uint64_t offset);
+LASER_API void laser_uring_close(laserUring* uring);
+#endif
+
+#if defined(LASER_MMAP)
+enum {
+    LASER_MAP_SEQUENTIAL = (1 << 0),
+    LASER_MAP_RANDOM = (1 << 1),
+    LASER_MAP_WILLNEED = (1 << 2),
+    LASER_MAP_HUGE_PAGES = (1 << 3)
+};
+
+typedef struct laserMap {
+    laserFile file;
+    int fd;
+    uint32_t flags;
+    uint64_t file_size;
+    uint64_t window_size;
+    uint8_t* base;
+    uint64_t length;
+} laserMap;
+
+/*
+ *  Memory Mapping API (POSIX) - Maps a file instead of loading it, the implementation needs `_DEFAULT_SOURCE`.
+ *
+ *  `laser_map_open` - Opens and maps `path`, `flags` are applied with `madvise` to the point data only.
+ *  With a `window_size` of zero the whole file is mapped and `map->file` is a regular memory file usable with every `laser_file_*` function.
+ *  Otherwise `map->file` reads through `pread` and `laser_map_read_range` maps the point data one window at a time.
+ *  `laser_map_read_range` - Decodes a range of points, mapping at most `window_size` bytes at once.
+ *  `laser_map_open_columnar` - Maps a whole columnar cache file and opens it into `columnar`, pages fault in per column as they are read.
+ *  `laser_map_close` - Unmaps and closes the file.
+ *
+ *  `LASER_MAP_HUGE_PAGES` asks for transparent huge pages, which only some file systems honor.
+ *  Files whose point data runs past their end fail with `LASER_ERROR_INVALID_FILE`, checked on open and again before
+ *  every window. A file truncated while fully mapped still raises `SIGBUS`, as with any mapping.
+ *
+ *  Example:
+ *      laserMap map;
+ *      laser_map_open(&map, "tile.las", LASER_MAP_SEQUENTIAL | LASER_MAP_WILLNEED, 0);
+ *      laserPlan plan;
+ *      laser_plan_attribs(&plan, &map.file, attribs, sizeof(v3));
+ *      laser_map_read_range(&map, &plan, xyz, 0, LASER_ALL_POINTS);
+ *      laser_map_close(&map);
+ */
+
+LASER_API laserResult laser_map_open(laserMap* map, const char* path, uint32_t flags, uint64_t window_size);
+LASER_API laserResult laser_map_read_range(laserMap* map, const laserPlan* plan, void* points, uint64_t first, uint64_t count);
+LASER_API laserResult laser_map_open_columnar(laserMap* map, laserColumnar* columnar, const char* path);
+LASER_API void laser_map_close(laserMap* map);
+#endif
+
+#if defined(LASER_TRACE)
+typedef enum laserTraceEvent {
+    LASER_TRACE_INFO,
+    LASER_TRACE_IO,
+    LASER_TRACE_DECODE,
+    LASER_TRACE_DECOMPRESS
+} laserTraceEvent;
+
+/* `begin` gets the requested size (bytes for IO, points otherwise), `end` the size actually done. */
+typedef void (*laserTraceFn)(void* usr, laserTraceEvent event, uint64_t size);
+
+typedef struct laserTraceStats {
+    uint64_t info_calls;
+    uint64_t io_calls;
+    uint64_t io_bytes_requested;
+    uint64_t io_bytes_returned;
+    uint64_t points_decoded[LASER_ATTRIB_TYPE_COUNT];
+    uint64_t points_decompressed;
+    uint64_t info_ns;
+    uint64_t io_ns;
+    uint64_t decode_ns;
+    uint64_t decompress_ns;
+} laserTraceStats;
+
+/*
+ *  Trace API - Counters and timers on the header, IO and decode paths, compiled out unless `LASER_TRACE` is defined.
+ *
+ *  `laser_trace_hooks` - Installs `begin` and `end`, called around every traced event (either may be `0`). Install them
+ *  before reads start, the hooks are not synchronized with reads running on other threads.
+ *  `laser_trace_stats` - Copies the process-wide counters, which are updated atomically and safe to read at any time.
+ *  `laser_trace_reset` - Zeroes the counters.
+ *
+ *  IO counts every `laserIoReadFn` call the library makes (a cache in between is one call, whatever it does below),
+ *  decode counts the points of each attribute of the plan per block. LAZ decompression time includes the reads it
+ *  issues, which are counted as IO too. Timestamps come from `LASER_TRACE_CLOCK`, nanoseconds from `clock_gettime`
+ *  (the implementation needs `_POSIX_C_SOURCE >= 199309L`) or `QueryPerformanceCounter` unless overridden.
+ *
+ *  Example:
+ *      laser_trace_reset();
+ *      laser_read_range_from_io(points, LASER_DEFAULT_STRIDE, read_fn, fp, 0, LASER_ALL_POINTS);
+ *      laserTraceStats stats;
+ *      laser_trace_stats(&stats);
+ *      printf("%llu reads, %llu ns io, %llu ns decode\n", stats.io_calls, stats.io_ns, stats.decode_ns);
+ */
+
+LASER_API void laser_trace_hooks(laserTraceFn begin, laserTraceFn end, void* usr);
+LASER_API void laser_trace_stats(laserTraceStats* stats);
+LASER_API void laser_trace_reset(void);
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+
+#if defined(LASER_IMPL)
+
+#include <string.h>
+
+#if !defined(LASER_ASSERT)
+#include <assert.h>
+#define LASER_ASSERT(x) assert(x)
+#endif
+
+#if !defined(LASER_IO_BUFFER_SIZE)
+#define LASER_IO_BUFFER_SIZE 16384
+#endif
+
+#if !defined(LASER_URING_SEGMENT_SIZE)
+#define LASER_URING_SEGMENT_SIZE (1 << 20)
+#endif
+
+#if !defined(LASER_URING_MAX_DEPTH)
+#define LASER_URING_MAX_DEPTH 32
+#endif
+
+#if !defined(LASER_URING_ALIGNMENT)
+#define LASER_URING_ALIGNMENT 4096
+#endif
+
+#if !defined(LASER_DECODE_BLOCK_SIZE)
+#define LASER_DECODE_BLOCK_SIZE 256
+#endif
+
+/* Filtered reads select points within a block by `uint16_t` index. */
+#if LASER_DECODE_BLOCK_SIZE > 65536
+#error "LASER_DECODE_BLOCK_SIZE must not exceed 65536"
+#endif
+
+#if !defined(LASER_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__))
+#define _LASER_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ *  Every `laserIoReadFn` call goes through `_LASER_IO` and every block decode through `_LASER_DECODE`, without
+ *  `LASER_TRACE` they are the plain calls. Counters are relaxed atomics, the hooks are read without synchronization.
+ */
+#if defined(LASER_TRACE)
+#if !defined(LASER_TRACE_CLOCK)
+#if defined(_WIN32)
+#include <windows.h>
+
+static uint64_t _laser_trace_clock(void) {
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t) ((double) counter.QuadPart * (1e9 / (double) frequency.QuadPart));
+}
+#else
+#include <time.h>
+
+static uint64_t _laser_trace_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+#endif
+#define LASER_TRACE_CLOCK _laser_trace_clock
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define _LASER_TRACE_ADD(counter, value) _InterlockedExchangeAdd64((volatile __int64*) &(counter), (__int64) (value))
+#define _LASER_TRACE_LOAD(counter) ((uint64_t) _InterlockedExchangeAdd64((volatile __int64*) &(counter), 0))
+#define _LASER_TRACE_STORE(counter, value) _InterlockedExchange64((volatile __int64*) &(counter), (__int64) (value))
+#elif defined(__GNUC__)
+#define _LASER_TRACE_ADD(counter, value) __atomic_fetch_add(&(counter), (uint64_t) (value), __ATOMIC_RELAXED)
+#define _LASER_TRACE_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define _LASER_TRACE_STORE(counter, value) __atomic_store_n(&(counter), (uint64_t) (value), __ATOMIC_RELAXED)
+#else
+#define _LASER_TRACE_ADD(counter, value) ((counter) += (value))
+#define _LASER_TRACE_LOAD(counter) (counter)
+#define _LASER_TRACE_STORE(counter, value) ((counter) = (value))
+#endif
+
+#define _LASER_TRACE_COUNTERS (sizeof(laserTraceStats) / sizeof(uint64_t))
+
+static laserTraceStats _laser_trace;
+static laserTraceFn _laser_trace_begin = 0;
+static laserTraceFn _laser_trace_end = 0;
+static void* _laser_trace_usr = 0;
+
+void laser_trace_hooks(laserTraceFn begin, laserTraceFn end, void* usr) {
+    _laser_trace_begin = begin;
+    _laser_trace_end = end;
+    _laser_trace_usr = usr;
+}
+
+void laser_trace_stats(laserTraceStats* stats) {
+    uint64_t* counters = (uint64_t*) &_laser_trace;
+    uint64_t* copy = (uint64_t*) stats;
+    for(uint64_t i = 0; i < _LASER_TRACE_COUNTERS; i++) {
+        copy[i] = _LASER_TRACE_LOAD(counters[i]);
+    }
+}
+
+void laser_trace_reset(void) {
+    uint64_t* counters = (uint64_t*) &_laser_trace;
+    for(uint64_t i = 0; i < _LASER_TRACE_COUNTERS; i++) {
+        _LASER_TRACE_STORE(counters[i], 0);
+    }
+}
+
+static uint64_t _laser_trace_enter(laserTraceEvent event, uint64_t size) {
+    if(_laser_trace_begin) {
+        _laser_trace_begin(_laser_trace_usr, event, size);
+    }
+    return LASER_TRACE_CLOCK();
+}
+
+/* Returns the elapsed time, the end hook runs after the clock is read so it isn't billed to the event. */
+static uint64_t _laser_trace_leave(laserTraceEvent event, uint64_t size, uint64_t start) {
+    uint64_t elapsed = LASER_TRACE_CLOCK() - start;
+    if(_laser_trace_end) {
+        _laser_trace_end(_laser_trace_usr, event, size);
+    }
+    return elapsed;
+}
+
+static uint64_t _laser_trace_io(laserIoReadFn fn, void* usr, void* data, uint64_t size, uint64_t offset) {
+    uint64_t start = _laser_trace_enter(LASER_TRACE_IO, size);
+    uint64_t read = fn(usr, data, size, offset);
+    _LASER_TRACE_ADD(_laser_trace.io_ns, _laser_trace_leave(LASER_TRACE_IO, read, start));
+    _LASER_TRACE_ADD(_laser_trace.io_calls, 1);
+    _LASER_TRACE_ADD(_laser_trace.io_bytes_requested, size);
+    _LASER_TRACE_ADD(_laser_trace.io_bytes_returned, read);
+    return read;
+}
+
+static void _laser_trace_decode(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) {
+    uint64_t start = _laser_trace_enter(LASER_TRACE_DECODE, count);
+    plan->decode(plan, base, index, raw_point, count);
+    _LASER_TRACE_ADD(_laser_trace.decode_ns, _laser_trace_leave(LASER_TRACE_DECODE, count, start));
+    for(uint32_t flags = plan->flags, type = 0; flags; flags >>= 1, type++) {
+        if(flags & 1) {
+            _LASER_TRACE_ADD(_laser_trace.points_decoded[type], count);
+        }
+    }
+}
+
+#define _LASER_IO(fn, usr, data, size, offset) _laser_trace_io((fn), (usr), (data), (size), (offset))
+#define _LASER_DECODE(plan, base, index, raw_point, count) _laser_trace_decode((plan), (base), (index), (raw_point), (count))
+#else
+#define _LASER_IO(fn, usr, data, size, offset) (fn)((usr), (data), (size), (offset))
+#define _LASER_DECODE(plan, base, index, raw_point, count) (plan)->decode((plan), (base), (index), (raw_point), (count))
+#endif
+
+#define LASER_OFFSET_OF(s, m) ((uint64_t) (&(((s*) 0)->m)))
+
+static const uint8_t _LASER_MAGIC[4] = { 'L', 'A', 'S', 'F' };
+
+#pragma pack(push, 1)
+typedef struct laserPublicHeaderBlock {
+    uint32_t magic;
+    uint16_t file_source_id;
+    struct {
+        uint16_t gps_type: 1;
+        uint16_t waveform_internal: 1;
+        uint16_t waveform_external: 1;
+        uint16_t synthetic_return_count: 1;
+        uint16_t wkt: 1;
+        uint16_t _: 11;
+    } global_encoding;
+    uint32_t guid_1;
+    uint16_t guid_2;
+    uint16_t guid_3;
+    uint64_t guid_4;
+    uint8_t version_major;
+    uint8_t version_minor;
+    char system_id[32];
+    char software[32];
+    uint16_t ddd;
+    uint16_t yyyy;
+    uint16_t phb_size;
+    uint32_t point_offset;
+    uint32_t vlr_count;
+    uint8_t format_id;
+    uint16_t point_size;
+    uint32_t point_count;
+    uint32_t point_count_per_return[5];
+    double x_scale;
+    double y_scale;
+    double z_scale;
+    double x_offset;
+    double y_offset;
+    double z_offset;
+    double x_max;
+    double x_min;
+    double y_max;
+    double y_min;
+    double z_max;
+    double z_min;
+} laserPublicHeaderBlock;
+
+typedef struct laserPublicHeaderBlock14 {
+    laserPublicHeaderBlock legacy;
+    uint64_t waveform_offset;
+    uint64_t evlr_offset;
+    uint32_t evlr_count;
+    uint64_t point_count;
+    uint64_t point_count_per_return[15];
+} laserPublicHeaderBlock14;
+#pragma pack(pop)
+
+/*
+ *  Formats 6 - 10 (LAS 1.4) store the return numbers as nibbles in byte 14, the classification flags in byte 15 and
+ *  a full classification byte at 16. Their entries point at the native fields, the legacy attributes are converted.
+ */
+static const uint64_t _LASER_ATTRIB_OFFSET_TABLE[11][LASER_ATTRIB_TYPE_COUNT] = {
+    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 15, 15, 15, 16, 0, 0 },
+    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 15, 15, 15, 16, 20, 0 },
+    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 0, 20, 22, 24, 0, 0, 0, 0, 0, 0, 0, 0, 14, 15, 15, 15, 16, 0, 20 },
+    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 28, 30, 32, 0, 0, 0, 0, 0, 0, 0, 0, 14, 15, 15, 15, 16, 20, 28 },
+    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 0, 0, 0, 28, 29, 37, 41, 45, 49, 53, 0, 14, 15, 15, 15, 16, 20, 0 },
+    { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 28, 30, 32, 34, 35, 43, 47, 51, 55, 59, 0, 14, 15, 15, 15, 16, 20, 28 },
+    { 0, 4, 8, 12, 14, 16, 18, 17, 20, 22, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 16, 15, 15, 18, 22, 0 },
+    { 0, 4, 8, 12, 14, 16, 18, 17, 20, 22, 30, 32, 34, 0, 0, 0, 0, 0, 0, 0, 0, 14, 16, 15, 15, 18, 22, 30 },
+    { 0, 4, 8, 12, 14, 16, 18, 17, 20, 22, 30, 32, 34, 0, 0, 0, 0, 0, 0, 0, 36, 14, 16, 15, 15, 18, 22, 30 },
+    { 0, 4, 8, 12, 14, 16, 18, 17, 20, 22, 0, 0, 0, 30, 31, 39, 43, 47, 51, 55, 0, 14, 16, 15, 15, 18, 22, 0 },
+    { 0, 4, 8, 12, 14, 16, 18, 17, 20, 22, 30, 32, 34, 38, 39, 47, 51, 55, 59, 63, 36, 14, 16, 15, 15, 18, 22, 30 },
+};
+
+static const uint32_t _LASER_VALID_ATTRIB_TABLE[11] = {
+    0x3E001FF, 0x7E003FF, 0xBE01DFF, 0xFE01FFF, 0x7EFE3FF, 0xFEFFFFF,
+    0x7E003FF, 0xFE01FFF, 0xFF01FFF, 0x7EFE3FF, 0xFFFFFFF,
+};
+
+static laserAttrib _LASER_DEFAULT_ATTRIBS[] = {
+    { LASER_ATTRIB_TYPE_X, LASER_OFFSET_OF(laserPoint, x) },
+    { LASER_ATTRIB_TYPE_Y, LASER_OFFSET_OF(laserPoint, y) },
+    { LASER_ATTRIB_TYPE_Z, LASER_OFFSET_OF(laserPoint, z) },
+    { LASER_ATTRIB_TYPE_INTENSITY, LASER_OFFSET_OF(laserPoint, intensity) },
+    { LASER_ATTRIB_TYPE_FLAGS, LASER_OFFSET_OF(laserPoint, flags) },
+    { LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_OFFSET_OF(laserPoint, classification) },
+    { LASER_ATTRIB_TYPE_SCAN_ANGLE, LASER_OFFSET_OF(laserPoint, scan_angle) },
+    { LASER_ATTRIB_TYPE_USR, LASER_OFFSET_OF(laserPoint, usr) },
+    { LASER_ATTRIB_TYPE_POINT_ID, LASER_OFFSET_OF(laserPoint, point_id) },
+    LASER_ATTRIB_END
+};
+
+static laserResult _laser_check_magic(uint8_t* magic) {
+    return
+        magic[0] != _LASER_MAGIC[0] ||
+        magic[1] != _LASER_MAGIC[1] ||
+        magic[2] != _LASER_MAGIC[2] ||
+        magic[3] != _LASER_MAGIC[3] ? LASER_ERROR_INVALID_FILE: LASER_SUCCESS;
+}
+
+static laserResult _laser_parse_info(laserInfo* info, void* mem, uint64_t size) {
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_check_magic((uint8_t*) mem)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    /* LAZ files set bit 7 (and some writers bit 6) of the format, the rest is the uncompressed format. */
+    const laserPublicHeaderBlock* public_header_block = (const laserPublicHeaderBlock*) mem;
+    uint32_t point_format = public_header_block->format_id & 0x3F;
+    if(public_header_block->version_major > 1 || (public_header_block->version_major == 1 && public_header_block->version_minor > 4)) {
+        return LASER_ERROR_VERSION_UNSUPPORTED;
+    } else if(point_format > 10 || (point_format > 5 && public_header_block->version_minor < 4)) {
+        return LASER_ERROR_FORMAT_UNSUPPORTED;
+    }
+
+    /* LAS 1.4 moves the point count to 64 bits, the legacy count is zero for formats 6 - 10 and beyond 2^32 - 1 points. */
+    info->point_count = public_header_block->point_count;
+    if(public_header_block->version_minor >= 4) {
+        if(size < sizeof(laserPublicHeaderBlock14) || public_header_block->phb_size < sizeof(laserPublicHeaderBlock14)) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+
+        const laserPublicHeaderBlock14* public_header_block_14 = (const laserPublicHeaderBlock14*) mem;
+        info->point_count = public_header_block_14->point_count ? public_header_block_14->point_count: info->point_count;
+    }
+
+    info->version_major = public_header_block->version_major;
+    info->version_minor = public_header_block->version_minor;
+    info->point_format = point_format;
+    info->compressed = (public_header_block->format_id & 0x80) != 0;
+    info->point_size = public_header_block->point_size;
+    info->point_offset = public_header_block->point_offset;
+    info->scale_x = (float) public_header_block->x_scale;
+    info->scale_y = (float) public_header_block->y_scale;
+    info->scale_z = (float) public_header_block->z_scale;
+    info->offset_x = (float) public_header_block->x_offset;
+    info->offset_y = (float) public_header_block->y_offset;
+    info->offset_z = (float) public_header_block->z_offset;
+    info->min_x = (float) public_header_block->x_min;
+    info->max_x = (float) public_header_block->x_max;
+    info->min_y = (float) public_header_block->y_min;
+    info->max_y = (float) public_header_block->y_max;
+    info->min_z = (float) public_header_block->z_min;
+    info->max_z = (float) public_header_block->z_max;
+    return LASER_SUCCESS;
+}
+
+laserResult laser_info_from_mem(laserInfo* info, void* mem, uint64_t size) {
+#if defined(LASER_TRACE)
+    uint64_t start = _laser_trace_enter(LASER_TRACE_INFO, size);
+    laserResult res = _laser_parse_info(info, mem, size);
+    _LASER_TRACE_ADD(_laser_trace.info_ns, _laser_trace_leave(LASER_TRACE_INFO, size, start));
+    _LASER_TRACE_ADD(_laser_trace.info_calls, 1);
+    return res;
+#else
+    return _laser_parse_info(info, mem, size);
+#endif
+}
+
+laserResult laser_read_from_mem(laserPoint* points, uint64_t stride, void* mem, uint64_t size) {
+    return laser_read_range_from_mem(points, stride, mem, size, 0, LASER_ALL_POINTS);
+}
+
+laserResult laser_read_range_from_mem(laserPoint* points, uint64_t stride, void* mem, uint64_t size, uint64_t first, uint64_t count) {
+    return laser_read_range_from_mem_with_attribs(points, stride == LASER_DEFAULT_STRIDE ? sizeof(laserPoint): stride, _LASER_DEFAULT_ATTRIBS, mem, size, first, count);
+}
+
+laserResult laser_info_from_io(laserInfo* info, laserIoReadFn fn, void* usr) {
+    laserPublicHeaderBlock14 public_header_block;
+    uint64_t read = _LASER_IO(fn, usr, (void*) &public_header_block, sizeof(laserPublicHeaderBlock14), 0);
+    if(read >= sizeof(laserPublicHeaderBlock)) {
+        return laser_info_from_mem(info, (void*) &public_header_block, read);
+    }
+    return LASER_ERROR_IO_READ;
+}
+
+laserResult laser_read_from_io(laserPoint* points, uint64_t stride, laserIoReadFn fn, void* usr) {
+    return laser_read_range_from_io(points, stride, fn, usr, 0, LASER_ALL_POINTS);
+}
+
+laserResult laser_read_range_from_io(laserPoint* points, uint64_t stride, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count) {
+    return laser_read_range_from_io_with_attribs(points, stride == LASER_DEFAULT_STRIDE ? sizeof(laserPoint): stride, _LASER_DEFAULT_ATTRIBS, fn, usr, first, count);
+}
+
+enum {
+    LASER_ATTRIB_FLAG_X = (1 << 0),
+    LASER_ATTRIB_FLAG_Y = (1 << 1),
+    LASER_ATTRIB_FLAG_Z = (1 << 2),
+    LASER_ATTRIB_FLAG_INTENSITY = (1 << 3),
+    LASER_ATTRIB_FLAG_FLAGS = (1 << 4),
+    LASER_ATTRIB_FLAG_CLASSIFICATION = (1 << 5),
+    LASER_ATTRIB_FLAG_SCAN_ANGLE = (1 << 6),
+    LASER_ATTRIB_FLAG_USR = (1 << 7),
+    LASER_ATTRIB_FLAG_POINT_ID = (1 << 8),
+    LASER_ATTRIB_FLAG_GPS_TIME = (1 << 9),
+    LASER_ATTRIB_FLAG_RED = (1 << 10),
+    LASER_ATTRIB_FLAG_GREEN = (1 << 11),
+    LASER_ATTRIB_FLAG_BLUE = (1 << 12),
+    LASER_ATTRIB_FLAG_WAVEFORM_ID = (1 << 13),
+    LASER_ATTRIB_FLAG_WAVEFORM_OFFSET = (1 << 14),
+    LASER_ATTRIB_FLAG_WAVEFORM_SIZE = (1 << 15),
+    LASER_ATTRIB_FLAG_WAVEFORM_LOCATION = (1 << 16),
+    LASER_ATTRIB_FLAG_X_TIME = (1 << 17),
+    LASER_ATTRIB_FLAG_Y_TIME = (1 << 18),
+    LASER_ATTRIB_FLAG_Z_TIME = (1 << 19),
+    LASER_ATTRIB_FLAG_NIR = (1 << 20),
+    LASER_ATTRIB_FLAG_EXTENDED_RETURNS = (1 << 21),
+    LASER_ATTRIB_FLAG_EXTENDED_CLASSIFICATION = (1 << 22),
+    LASER_ATTRIB_FLAG_CLASSIFICATION_FLAGS = (1 << 23),
+    LASER_ATTRIB_FLAG_SCANNER_CHANNEL = (1 << 24),
+    LASER_ATTRIB_FLAG_SCAN_ANGLE_DEGREES = (1 << 25),
+    LASER_ATTRIB_FLAG_GPS_TIME_RELATIVE = (1 << 26),
+    LASER_ATTRIB_FLAG_RGB8 = (1 << 27),
+
+    LASER_ATTRIB_FLAGS_XYZ = LASER_ATTRIB_FLAG_X | LASER_ATTRIB_FLAG_Y | LASER_ATTRIB_FLAG_Z,
+    LASER_ATTRIB_FLAGS_COMMON = 0x1FF
+};
+
+static const uint64_t _LASER_POINT_SIZE_TABLE[11] = {
+    20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67,
+};
+
+/* Minor version of LAS that introduced each point format. */
+static const uint32_t _LASER_FORMAT_VERSION_TABLE[11] = {
+    0, 0, 2, 2, 3, 3, 4, 4, 4, 4, 4,
+};
+
+static const uint64_t _LASER_ATTRIB_SIZE_TABLE[LASER_ATTRIB_TYPE_COUNT] = {
+    4, 4, 4, 2, 1, 1, 1, 1, 2, 8, 2, 2, 2, 1, 8, 4, 4, 4, 4, 4, 2, 1, 1, 1, 1, 4, 4, 4,
+};
+
+/*
+ *  Decoding is driven by a plan compiled once per call. Every attribute has its own kernel with the source offset
+ *  known at compile time, these run attribute by attribute over blocks of `LASER_DECODE_BLOCK_SIZE` points. The
+ *  most common attribute sets (XYZ and the `laserPoint` subset) instead have fused kernels, one for formats 0 - 5 and
+ *  one for 6 - 10 as the fields sit at the same offsets within each group. Copies per point format with the record
+ *  size known at compile time measured no faster in `bench/bench.c` and were removed.
+ *
+ *  Formats 6 - 10 decode into the same attribute meanings as 0 - 5: return numbers and counts saturate at 7,
+ *  classifications above 31 read as 31 with the synthetic/key-point/withheld bits moved back into the byte, and the
+ *  scan angle is rounded from 0.006 degree steps to whole degrees.
+ */
+
+static uint8_t _laser_legacy_flags(const uint8_t* raw_point) {
+    uint32_t return_number = raw_point[14] & 0xF;
+    uint32_t return_count = raw_point[14] >> 4;
+    return_number = return_number > 7 ? 7: return_number;
+    return_count = return_count > 7 ? 7: return_count;
+    return (uint8_t) (return_number | (return_count << 3) | (raw_point[15] & 0xC0));
+}
+
+static uint8_t _laser_legacy_classification(const uint8_t* raw_point) {
+    uint32_t classification = raw_point[16];
+    classification = classification > 31 ? 31: classification;
+    return (uint8_t) (classification | ((raw_point[15] & 0x7) << 5));
+}
+
+static int8_t _laser_legacy_scan_angle(const uint8_t* raw_point) {
+    int32_t angle = *((const int16_t*) (raw_point + 18));
+    angle = (angle * 3 + (angle < 0 ? -250: 250)) / 500;
+    return (int8_t) (angle < -128 ? -128: (angle > 127 ? 127: angle));
+}
+
+#define _LASER_DEFINE_COORD_DECODE(name, attrib, scale, offset) \
+    static void _laser_decode_##name(uint8_t* point, uint64_t stride, const uint8_t* raw_point, uint64_t point_size, uint64_t count, const laserPlan* plan) { \
+        float s = plan->scale; \
+        float o = plan->offset; \
+        raw_point += _LASER_ATTRIB_OFFSET_TABLE[0][attrib]; \
+        for(uint64_t i = 0; i < count; i++) { \
+            *((float*) point) = *((const int32_t*) raw_point) * s + o; \
+            point += stride; \
+            raw_point += point_size; \
+        } \
+    }
+
+#define _LASER_DEFINE_COPY_DECODE(name, type, format, attrib) \
+    static void _laser_decode_##name(uint8_t* point, uint64_t stride, const uint8_t* raw_point, uint64_t point_size, uint64_t count, const laserPlan* plan) { \
+        (void) plan; \
+        raw_point += _LASER_ATTRIB_OFFSET_TABLE[format][attrib]; \
+        for(uint64_t i = 0; i < count; i++) { \
+            *((type*) point) = *((const type*) raw_point); \
+            point += stride; \
+            raw_point += point_size; \
+        } \
+    }
+
+#define _LASER_DEFINE_LEGACY_DECODE(name, type) \
+    static void _laser_decode_##name##_14(uint8_t* point, uint64_t stride, const uint8_t* raw_point, uint64_t point_size, uint64_t count, const laserPlan* plan) { \
+        (void) plan; \
+        for(uint64_t i = 0; i < count; i++) { \
+            *((type*) point) = _laser_legacy_##name(raw_point); \
+            point += stride; \
+            raw_point += point_size; \
+        } \
+    }
+
+_LASER_DEFINE_COORD_DECODE(x, LASER_ATTRIB_TYPE_X, scale_x, offset_x)
+_LASER_DEFINE_COORD_DECODE(y, LASER_ATTRIB_TYPE_Y, scale_y, offset_y)
+_LASER_DEFINE_COORD_DECODE(z, LASER_ATTRIB_TYPE_Z, scale_z, offset_z)
+_LASER_DEFINE_COPY_DECODE(intensity, uint16_t, 0, LASER_ATTRIB_TYPE_INTENSITY)
+_LASER_DEFINE_COPY_DECODE(flags, uint8_t, 0, LASER_ATTRIB_TYPE_FLAGS)
+_LASER_DEFINE_COPY_DECODE(classification, uint8_t, 0, LASER_ATTRIB_TYPE_CLASSIFICATION)
+_LASER_DEFINE_COPY_DECODE(scan_angle, int8_t, 0, LASER_ATTRIB_TYPE_SCAN_ANGLE)
+_LASER_DEFINE_COPY_DECODE(usr, uint8_t, 0, LASER_ATTRIB_TYPE_USR)
+_LASER_DEFINE_COPY_DECODE(point_id, uint16_t, 0, LASER_ATTRIB_TYPE_POINT_ID)
+_LASER_DEFINE_COPY_DECODE(usr_14, uint8_t, 6, LASER_ATTRIB_TYPE_USR)
+_LASER_DEFINE_COPY_DECODE(point_id_14, uint16_t, 6, LASER_ATTRIB_TYPE_POINT_ID)
+_LASER_DEFINE_LEGACY_DECODE(flags, uint8_t)
+_LASER_DEFINE_LEGACY_DECODE(classification, uint8_t)
+_LASER_DEFINE_LEGACY_DECODE(scan_angle, int8_t)
+
+/*
+ *  The attributes past the common subset move between formats, their kernels look up the field offset once per block.
+ *  `raw` points at the field of the current record.
+ */
+#define _LASER_DEFINE_CONVERT_DECODE(name, type, attrib, expr) \
+    static void _laser_decode_##name(uint8_t* point, uint64_t stride, const uint8_t* raw_point, uint64_t point_size, uint64_t count, const laserPlan* plan) { \
+        const uint8_t* raw = raw_point + _LASER_ATTRIB_OFFSET_TABLE[plan->point_format][attrib]; \
+        for(uint64_t i = 0; i < count; i++) { \
+            *((type*) point) = (expr); \
+            point += stride; \
+            raw += point_size; \
+        } \
+    }
+
+#define _LASER_DEFINE_ZERO_DECODE(name, type) \
+    static void _laser_decode_##name(uint8_t* point, uint64_t stride, const uint8_t* raw_point, uint64_t point_size, uint64_t count, const laserPlan* plan) { \
+        (void) raw_point; \
+        (void) point_size; \
+        (void) plan; \
+        for(uint64_t i = 0; i < count; i++) { \
+            *((type*) point) = 0; \
+            point += stride; \
+        } \
+    }
+
+_LASER_DEFINE_CONVERT_DECODE(gps_time, double, LASER_ATTRIB_TYPE_GPS_TIME, *((const double*) raw))
+_LASER_DEFINE_CONVERT_DECODE(red, uint16_t, LASER_ATTRIB_TYPE_RED, *((const uint16_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(green, uint16_t, LASER_ATTRIB_TYPE_GREEN, *((const uint16_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(blue, uint16_t, LASER_ATTRIB_TYPE_BLUE, *((const uint16_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(waveform_id, uint8_t, LASER_ATTRIB_TYPE_WAVEFORM_ID, *raw)
+_LASER_DEFINE_CONVERT_DECODE(waveform_offset, uint64_t, LASER_ATTRIB_TYPE_WAVEFORM_OFFSET, *((const uint64_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(waveform_size, uint32_t, LASER_ATTRIB_TYPE_WAVEFORM_SIZE, *((const uint32_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(waveform_location, float, LASER_ATTRIB_TYPE_WAVEFORM_LOCATION, *((const float*) raw))
+_LASER_DEFINE_CONVERT_DECODE(x_time, float, LASER_ATTRIB_TYPE_X_TIME, *((const float*) raw))
+_LASER_DEFINE_CONVERT_DECODE(y_time, float, LASER_ATTRIB_TYPE_Y_TIME, *((const float*) raw))
+_LASER_DEFINE_CONVERT_DECODE(z_time, float, LASER_ATTRIB_TYPE_Z_TIME, *((const float*) raw))
+_LASER_DEFINE_CONVERT_DECODE(nir, uint16_t, LASER_ATTRIB_TYPE_NIR, *((const uint16_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(extended_returns, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_RETURNS, (uint8_t) ((*raw & 0x7) | ((*raw & 0x38) << 1)))
+_LASER_DEFINE_CONVERT_DECODE(extended_returns_14, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_RETURNS, *raw)
+_LASER_DEFINE_CONVERT_DECODE(extended_classification, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION, (uint8_t) (*raw & 0x1F))
+_LASER_DEFINE_CONVERT_DECODE(extended_classification_14, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION, *raw)
+_LASER_DEFINE_CONVERT_DECODE(classification_flags, uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS, (uint8_t) (*raw >> 5))
+_LASER_DEFINE_CONVERT_DECODE(classification_flags_14, uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS, (uint8_t) (*raw & 0xF))
+_LASER_DEFINE_CONVERT_DECODE(scanner_channel_14, uint8_t, LASER_ATTRIB_TYPE_SCANNER_CHANNEL, (uint8_t) ((*raw >> 4) & 0x3))
+_LASER_DEFINE_CONVERT_DECODE(scan_angle_degrees, float, LASER_ATTRIB_TYPE_SCAN_ANGLE_DEGREES, (float) *((const int8_t*) raw))
+_LASER_DEFINE_CONVERT_DECODE(scan_angle_degrees_14, float, LASER_ATTRIB_TYPE_SCAN_ANGLE_DEGREES, *((const int16_t*) raw) * 0.006f)
+_LASER_DEFINE_CONVERT_DECODE(gps_time_relative, float, LASER_ATTRIB_TYPE_GPS_TIME_RELATIVE, (float) (*((const double*) raw) - plan->time_base))
+_LASER_DEFINE_CONVERT_DECODE(rgb8, uint32_t, LASER_ATTRIB_TYPE_RGB8, (uint32_t) raw[1] | ((uint32_t) raw[3] << 8) | ((uint32_t) raw[5] << 16) | 0xFF000000u)
+_LASER_DEFINE_ZERO_DECODE(zero_1, uint8_t)
+_LASER_DEFINE_ZERO_DECODE(zero_2, uint16_t)
+_LASER_DEFINE_ZERO_DECODE(zero_4, uint32_t)
+_LASER_DEFINE_ZERO_DECODE(zero_8, uint64_t)
+
+static const laserAttribDecodeFn _LASER_ATTRIB_DECODE_TABLE[2][LASER_ATTRIB_TYPE_COUNT] = {
+    {
+        _laser_decode_x,
+        _laser_decode_y,
+        _laser_decode_z,
+        _laser_decode_intensity,
+        _laser_decode_flags,
+        _laser_decode_classification,
+        _laser_decode_scan_angle,
+        _laser_decode_usr,
+        _laser_decode_point_id,
+        _laser_decode_gps_time,
+        _laser_decode_red,
+        _laser_decode_green,
+        _laser_decode_blue,
+        _laser_decode_waveform_id,
+        _laser_decode_waveform_offset,
+        _laser_decode_waveform_size,
+        _laser_decode_waveform_location,
+        _laser_decode_x_time,
+        _laser_decode_y_time,
+        _laser_decode_z_time,
+        _laser_decode_nir,
+        _laser_decode_extended_returns,
+        _laser_decode_extended_classification,
+        _laser_decode_classification_flags,
+        _laser_decode_zero_1,
+        _laser_decode_scan_angle_degrees,
+        _laser_decode_gps_time_relative,
+        _laser_decode_rgb8,
+    },
+    {
+        _laser_decode_x,
+        _laser_decode_y,
+        _laser_decode_z,
+        _laser_decode_intensity,
+        _laser_decode_flags_14,
+        _laser_decode_classification_14,
+        _laser_decode_scan_angle_14,
+        _laser_decode_usr_14,
+        _laser_decode_point_id_14,
+        _laser_decode_gps_time,
+        _laser_decode_red,
+        _laser_decode_green,
+        _laser_decode_blue,
+        _laser_decode_waveform_id,
+        _laser_decode_waveform_offset,
+        _laser_decode_waveform_size,
+        _laser_decode_waveform_location,
+        _laser_decode_x_time,
+        _laser_decode_y_time,
+        _laser_decode_z_time,
+        _laser_decode_nir,
+        _laser_decode_extended_returns_14,
+        _laser_decode_extended_classification_14,
+        _laser_decode_classification_flags_14,
+        _laser_decode_scanner_channel_14,
+        _laser_decode_scan_angle_degrees_14,
+        _laser_decode_gps_time_relative,
+        _laser_decode_rgb8,
+    },
+};
+
+static const laserAttribDecodeFn _LASER_ZERO_DECODE_TABLE[9] = {
+    0, _laser_decode_zero_1, _laser_decode_zero_2, 0, _laser_decode_zero_4, 0, 0, 0, _laser_decode_zero_8,
+};
+
+#define _LASER_DECODE_FIELD(type, attrib) \
+    *((type*) (point + plan->offsets[attrib])) = *((const type*) (raw_point + _LASER_ATTRIB_OFFSET_TABLE[format][attrib]))
+
+#define _LASER_DECODE_LEGACY_FIELD(type, attrib, name) \
+    *((type*) (point + plan->offsets[attrib])) = format >= 6 ? _laser_legacy_##name(raw_point): *((const type*) (raw_point + _LASER_ATTRIB_OFFSET_TABLE[format][attrib]))
+
+#define _LASER_DECODE_COORD(attrib, scale, offset) \
+    *((float*) (point + plan->offsets[attrib])) = *((const int32_t*) (raw_point + _LASER_ATTRIB_OFFSET_TABLE[format][attrib])) * scale + offset
+
+#define _LASER_DEFINE_FUSED_XYZ_DECODE(name, fmt) \
+    static void _laser_decode_xyz_##name(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) { \
+        const uint32_t format = fmt; \
+        uint8_t* point = base + index * plan->stride; \
+        float scale_x = plan->scale_x, scale_y = plan->scale_y, scale_z = plan->scale_z; \
+        float offset_x = plan->offset_x, offset_y = plan->offset_y, offset_z = plan->offset_z; \
+        uint64_t point_size = plan->point_size; \
+        for(uint64_t i = 0; i < count; i++) { \
+            _LASER_DECODE_COORD(LASER_ATTRIB_TYPE_X, scale_x, offset_x); \
+            _LASER_DECODE_COORD(LASER_ATTRIB_TYPE_Y, scale_y, offset_y); \
+            _LASER_DECODE_COORD(LASER_ATTRIB_TYPE_Z, scale_z, offset_z); \
+            point += plan->stride; \
+            raw_point += point_size; \
+        } \
+    }
+
+#define _LASER_DEFINE_FUSED_COMMON_DECODE(name, fmt) \
+    static void _laser_decode_common_##name(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) { \
+        const uint32_t format = fmt; \
+        uint8_t* point = base + index * plan->stride; \
+        float scale_x = plan->scale_x, scale_y = plan->scale_y, scale_z = plan->scale_z; \
+        float offset_x = plan->offset_x, offset_y = plan->offset_y, offset_z = plan->offset_z; \
+        uint64_t point_size = plan->point_size; \
+        for(uint64_t i = 0; i < count; i++) { \
+            _LASER_DECODE_COORD(LASER_ATTRIB_TYPE_X, scale_x, offset_x); \
+            _LASER_DECODE_COORD(LASER_ATTRIB_TYPE_Y, scale_y, offset_y); \
+            _LASER_DECODE_COORD(LASER_ATTRIB_TYPE_Z, scale_z, offset_z); \
+            _LASER_DECODE_FIELD(uint16_t, LASER_ATTRIB_TYPE_INTENSITY); \
+            _LASER_DECODE_LEGACY_FIELD(uint8_t, LASER_ATTRIB_TYPE_FLAGS, flags); \
+            _LASER_DECODE_LEGACY_FIELD(uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION, classification); \
+            _LASER_DECODE_LEGACY_FIELD(int8_t, LASER_ATTRIB_TYPE_SCAN_ANGLE, scan_angle); \
+            _LASER_DECODE_FIELD(uint8_t, LASER_ATTRIB_TYPE_USR); \
+            _LASER_DECODE_FIELD(uint16_t, LASER_ATTRIB_TYPE_POINT_ID); \
+            point += plan->stride; \
+            raw_point += point_size; \
+        } \
+    }
+
+_LASER_DEFINE_FUSED_XYZ_DECODE(any, 0)
+_LASER_DEFINE_FUSED_COMMON_DECODE(any, 0)
+_LASER_DEFINE_FUSED_COMMON_DECODE(any_14, 6)
+
+static void _laser_decode_xyz_columns(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) {
+    (void) base;
+    float* x = ((float*) (uintptr_t) plan->offsets[LASER_ATTRIB_TYPE_X]) + index;
+    float* y = ((float*) (uintptr_t) plan->offsets[LASER_ATTRIB_TYPE_Y]) + index;
+    float* z = ((float*) (uintptr_t) plan->offsets[LASER_ATTRIB_TYPE_Z]) + index;
+    float scale_x = plan->scale_x, scale_y = plan->scale_y, scale_z = plan->scale_z;
+    float offset_x = plan->offset_x, offset_y = plan->offset_y, offset_z = plan->offset_z;
+    uint64_t point_size = plan->point_size;
+    for(uint64_t i = 0; i < count; i++) {
+        x[i] = *((const int32_t*) (raw_point + 0)) * scale_x + offset_x;
+        y[i] = *((const int32_t*) (raw_point + 4)) * scale_y + offset_y;
+        z[i] = *((const int32_t*) (raw_point + 8)) * scale_z + offset_z;
+        raw_point += point_size;
+    }
+}
+
+#if defined(_LASER_SIMD_SSE2)
+
+/*
+ *  Vectorized XYZ kernels, these load four records, transpose the three int32 fields and dequantize them in bulk.
+ *  The packed `float[3]` layout transposes back into 12 contiguous floats, columns are stored directly. Scaling is a
+ *  separate multiply and add (no FMA) so results are bit-identical to the scalar kernels.
+ */
+
+static void _laser_load_xyz_sse2(const laserPlan* plan, const uint8_t* raw_point, __m128* x, __m128* y, __m128* z) {
+    uint64_t point_size = plan->point_size;
+    __m128i r0 = _mm_loadu_si128((const __m128i*) (raw_point + 0 * point_size));
+    __m128i r1 = _mm_loadu_si128((const __m128i*) (raw_point + 1 * point_size));
+    __m128i r2 = _mm_loadu_si128((const __m128i*) (raw_point + 2 * point_size));
+    __m128i r3 = _mm_loadu_si128((const __m128i*) (raw_point + 3 * point_size));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+    *x = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi64(t0, t1)), _mm_set1_ps(plan->scale_x)), _mm_set1_ps(plan->offset_x));
+    *y = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi64(t0, t1)), _mm_set1_ps(plan->scale_y)), _mm_set1_ps(plan->offset_y));
+    *z = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi64(t2, t3)), _mm_set1_ps(plan->scale_z)), _mm_set1_ps(plan->offset_z));
+}
+
+static void _laser_decode_xyz_sse2(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) {
+    uint8_t* point = base + index * plan->stride;
+    uint64_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        _laser_load_xyz_sse2(plan, raw_point, &x, &y, &z);
+        __m128 xy_lo = _mm_unpacklo_ps(x, y);
+        __m128 xy_hi = _mm_unpackhi_ps(x, y);
+        __m128 z0x1 = _mm_shuffle_ps(z, xy_lo, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 y1z1 = _mm_shuffle_ps(xy_lo, z, _MM_SHUFFLE(1, 1, 3, 3));
+        __m128 z2x3 = _mm_shuffle_ps(z, xy_hi, _MM_SHUFFLE(2, 2, 2, 2));
+        __m128 y3z3 = _mm_shuffle_ps(xy_hi, z, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps((float*) point + 0, _mm_shuffle_ps(xy_lo, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps((float*) point + 4, _mm_shuffle_ps(y1z1, xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+        _mm_storeu_ps((float*) point + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+        point += 4 * plan->stride;
+        raw_point += 4 * plan->point_size;
+    }
+    _laser_decode_xyz_any(plan, base, index + i, raw_point, count - i);
+}
+
+static void _laser_decode_xyz_columns_sse2(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) {
+    float* x = ((float*) (uintptr_t) plan->offsets[LASER_ATTRIB_TYPE_X]) + index;
+    float* y = ((float*) (uintptr_t) plan->offsets[LASER_ATTRIB_TYPE_Y]) + index;
+    float* z = ((float*) (uintptr_t) plan->offsets[LASER_ATTRIB_TYPE_Z]) + index;
+    uint64_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 vx, vy, vz;
+        _laser_load_xyz_sse2(plan, raw_point, &vx, &vy, &vz);
+        _mm_storeu_ps(x + i, vx);
+        _mm_storeu_ps(y + i, vy);
+        _mm_storeu_ps(z + i, vz);
+        raw_point += 4 * plan->point_size;
+    }
+    _laser_decode_xyz_columns(plan, base, index + i, raw_point, count - i);
+}
+
+#endif
+
+static void _laser_decode_attribs(const laserPlan* plan, uint8_t* base, uint64_t index, const uint8_t* raw_point, uint64_t count) {
+    for(uint32_t i = 0; i < plan->entry_count; i++) {
+        const laserPlanEntry* entry = &plan->entries[i];
+        uint8_t* point = (uint8_t*) ((uintptr_t) base + (uintptr_t) (entry->offset + index * entry->stride));
+        entry->decode(point, entry->stride, raw_point, plan->point_size, count, plan);
+    }
+}
+
+static void _laser_plan_init(laserPlan* plan, const laserInfo* info) {
+    plan->decode = _laser_decode_attribs;
+    plan->entry_count = 0;
+    plan->flags = 0;
+    plan->stride = 0;
+    plan->point_size = info->point_size;
+    plan->point_format = info->point_format;
+    plan->classification_offset = (uint32_t) _LASER_ATTRIB_OFFSET_TABLE[info->point_format][LASER_ATTRIB_TYPE_CLASSIFICATION];
+    plan->classification_mask = info->point_format >= 6 ? 0xFF: 0x1F;
+    plan->withheld_mask = info->point_format >= 6 ? 0x04: 0x80;
+    plan->return_mask = info->point_format >= 6 ? 0xF: 0x7;
+    plan->scale_x = info->scale_x;
+    plan->scale_y = info->scale_y;
+    plan->scale_z = info->scale_z;
+    plan->offset_x = info->offset_x;
+    plan->offset_y = info->offset_y;
+    plan->offset_z = info->offset_z;
+    plan->time_base = 0.0;
+    plan->filter = 0;
+    plan->sample = LASER_SAMPLE_NONE;
+    plan->voxels = 0;
+    plan->stats = 0;
+    plan->stats_count = 0;
+}
+
+static void _laser_plan_add(laserPlan* plan, laserAttribType type, uint64_t offset, uint64_t stride) {
+    laserPlanEntry* entry = &plan->entries[plan->entry_count++];
+    uint32_t valid = (_LASER_VALID_ATTRIB_TABLE[plan->point_format] >> type) & 1;
+    entry->decode = valid ? _LASER_ATTRIB_DECODE_TABLE[plan->point_format >= 6][type]: _LASER_ZERO_DECODE_TABLE[_LASER_ATTRIB_SIZE_TABLE[type]];
+    entry->offset = offset;
+    entry->stride = stride;
+    plan->offsets[type] = offset;
+    plan->flags |= 1 << type;
+}
+
+static void _laser_plan_compile(laserPlan* plan, const laserInfo* info, const laserAttrib* attribs, uint64_t stride) {
+    _laser_plan_init(plan, info);
+    plan->stride = stride;
+    for(uint64_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && attribs[i].type != LASER_ATTRIB_TYPE_NONE; i++) {
+        _laser_plan_add(plan, attribs[i].type, attribs[i].offset, stride);
+    }
+
+    if(plan->flags == LASER_ATTRIB_FLAGS_XYZ && plan->entry_count == 3) {
+        plan->decode = _laser_decode_xyz_any;
+#if defined(_LASER_SIMD_SSE2)
+        if(stride == 12 && plan->offsets[LASER_ATTRIB_TYPE_X] == 0 && plan->offsets[LASER_ATTRIB_TYPE_Y] == 4 && plan->offsets[LASER_ATTRIB_TYPE_Z] == 8) {
+            plan->decode = _laser_decode_xyz_sse2;
+        }
+#endif
+    } else if(plan->flags == LASER_ATTRIB_FLAGS_COMMON && plan->entry_count == 9) {
+        plan->decode = info->point_format >= 6 ? _laser_decode_common_any_14: _laser_decode_common_any;
+    }
+}
+
+/*
+ *  Columns are planned against a null base, every entry offset is the address of its column.
+ */
+static void _laser_plan_compile_columns(laserPlan* plan, const laserInfo* info, const laserColumn* columns) {
+    _laser_plan_init(plan, info);
+    uint32_t packed = 1;
+    for(uint64_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && columns[i].type != LASER_ATTRIB_TYPE_NONE; i++) {
+        uint64_t size = _LASER_ATTRIB_SIZE_TABLE[columns[i].type];
+        uint64_t stride = columns[i].stride == LASER_DEFAULT_STRIDE ? size: columns[i].stride;
+        packed &= stride == size;
+        _laser_plan_add(plan, columns[i].type, (uint64_t) (uintptr_t) columns[i].data, stride);
+    }
+
+    if(plan->flags == LASER_ATTRIB_FLAGS_XYZ && plan->entry_count == 3 && packed) {
+#if defined(_LASER_SIMD_SSE2)
+        plan->decode = _laser_decode_xyz_columns_sse2;
+#else
+        plan->decode = _laser_decode_xyz_columns;
+#endif
+    }
+}
+
+static void _laser_stats_block(laserStats* stats, const laserPlan* plan, const uint8_t* raw_point, uint64_t count) {
+    uint64_t point_size = plan->point_size;
+    uint64_t i = 0;
+    stats->point_count += count;
+
+#if defined(_LASER_SIMD_SSE2)
+    if(count >= 4) {
+        __m128i min_x = _mm_set1_epi32(stats->min_x), max_x = _mm_set1_epi32(stats->max_x);
+        __m128i min_y = _mm_set1_epi32(stats->min_y), max_y = _mm_set1_epi32(stats->max_y);
+        __m128i min_z = _mm_set1_epi32(stats->min_z), max_z = _mm_set1_epi32(stats->max_z);
+        for(; i + 4 <= count; i += 4) {
+            const uint8_t* raw = raw_point + i * point_size;
+            __m128i r0 = _mm_loadu_si128((const __m128i*) (raw + 0 * point_size));
+            __m128i r1 = _mm_loadu_si128((const __m128i*) (raw + 1 * point_size));
+            __m128i r2 = _mm_loadu_si128((const __m128i*) (raw + 2 * point_size));
+            __m128i r3 = _mm_loadu_si128((const __m128i*) (raw + 3 * point_size));
+            __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+            __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+            __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+            __m128i x = _mm_unpacklo_epi64(t0, t1);
+            __m128i y = _mm_unpackhi_epi64(t0, t1);
+            __m128i z = _mm_unpacklo_epi64(t2, t3);
+
+            /* SSE2 has no 32-bit integer min/max, select through the compare masks. */
+            __m128i m = _mm_cmpgt_epi32(min_x, x); min_x = _mm_or_si128(_mm_and_si128(m, x), _mm_andnot_si128(m, min_x));
+            m = _mm_cmpgt_epi32(x, max_x); max_x = _mm_or_si128(_mm_and_si128(m, x), _mm_andnot_si128(m, max_x));
+            m = _mm_cmpgt_epi32(min_y, y); min_y = _mm_or_si128(_mm_and_si128(m, y), _mm_andnot_si128(m, min_y));
+            m = _mm_cmpgt_epi32(y, max_y); max_y = _mm_or_si128(_mm_and_si128(m, y), _mm_andnot_si128(m, max_y));
+            m = _mm_cmpgt_epi32(min_z, z); min_z = _mm_or_si128(_mm_and_si128(m, z), _mm_andnot_si128(m, min_z));
+            m = _mm_cmpgt_epi32(z, max_z); max_z = _mm_or_si128(_mm_and_si128(m, z), _mm_andnot_si128(m, max_z));
+        }
+
+        int32_t lanes[6][4];
+        _mm_storeu_si128((__m128i*) lanes[0], min_x);
+        _mm_storeu_si128((__m128i*) lanes[1], min_y);
+        _mm_storeu_si128((__m128i*) lanes[2], min_z);
+        _mm_storeu_si128((__m128i*) lanes[3], max_x);
+        _mm_storeu_si128((__m128i*) lanes[4], max_y);
+        _mm_storeu_si128((__m128i*) lanes[5], max_z);
+        for(uint32_t lane = 0; lane < 4; lane++) {
+            stats->min_x = lanes[0][lane] < stats->min_x ? lanes[0][lane]: stats->min_x;
+            stats->min_y = lanes[1][lane] < stats->min_y ? lanes[1][lane]: stats->min_y;
+            stats->min_z = lanes[2][lane] < stats->min_z ? lanes[2][lane]: stats->min_z;
+            stats->max_x = lanes[3][lane] > stats->max_x ? lanes[3][lane]: stats->max_x;
+            stats->max_y = lanes[4][lane] > stats->max_y ? lanes[4][lane]: stats->max_y;
+            stats->max_z = lanes[5][lane] > stats->max_z ? lanes[5][lane]: stats->max_z;
+        }
+    }
+#endif
+
+    for(; i < count; i++) {
+        const int32_t* xyz = (const int32_t*) (raw_point + i * point_size);
+        stats->min_x = xyz[0] < stats->min_x ? xyz[0]: stats->min_x;
+        stats->min_y = xyz[1] < stats->min_y ? xyz[1]: stats->min_y;
+        stats->min_z = xyz[2] < stats->min_z ? xyz[2]: stats->min_z;
+        stats->max_x = xyz[0] > stats->max_x ? xyz[0]: stats->max_x;
+        stats->max_y = xyz[1] > stats->max_y ? xyz[1]: stats->max_y;
+        stats->max_z = xyz[2] > stats->max_z ? xyz[2]: stats->max_z;
+    }
+
+    uint32_t intensity_min = stats->intensity_min;
+    uint32_t intensity_max = stats->intensity_max;
+    uint64_t intensity_sum = 0;
+    for(i = 0; i < count; i++) {
+        const uint8_t* raw = raw_point + i * point_size;
+        uint32_t intensity = *((const uint16_t*) (raw + _LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_INTENSITY]));
+        intensity_min = intensity < intensity_min ? intensity: intensity_min;
+        intensity_max = intensity > intensity_max ? intensity: intensity_max;
+        intensity_sum += intensity;
+        stats->return_counts[raw[_LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_FLAGS]] & plan->return_mask]++;
+        stats->classification_counts[raw[plan->classification_offset] & plan->classification_mask]++;
+    }
+    stats->intensity_min = intensity_min;
+    stats->intensity_max = intensity_max;
+    stats->intensity_sum += intensity_sum;
+}
+
+static void _laser_decode_range(void* points, uint64_t index, const laserPlan* plan, const uint8_t* raw_point, uint64_t count, laserStats* stats) {
+    while(count > 0) {
+        uint64_t block = count < LASER_DECODE_BLOCK_SIZE ? count: LASER_DECODE_BLOCK_SIZE;
+        _LASER_DECODE(plan, (uint8_t*) points, index, raw_point, block);
+        if(stats) {
+            _laser_stats_block(stats, plan, raw_point, block);
+        }
+        index += block;
+        raw_point += block * plan->point_size;
+        count -= block;
+    }
+}
+
+/* Whether the uncompressed point data starting `point_offset` bytes into `size` bytes is all there. */
+static int _laser_points_fit(const laserInfo* info, uint64_t size) {
+    if(info->compressed || !info->point_count) {
+        return 1;
+    }
+    return info->point_offset <= size && info->point_size && info->point_count <= (size - info->point_offset) / info->point_size;
+}
+
+static uint64_t _laser_points_size(const laserFile* file) {
+    return file->size > file->info.point_offset ? file->size - file->info.point_offset: 0;
+}
+
+/* `size` is the number of bytes available at `raw_points`, which holds the records from point 0 of `first`. */
+static laserResult _laser_read_attribs_from_mem(void* points, uint64_t index, const laserPlan* plan, const laserInfo* info, void* raw_points, uint64_t size, uint64_t first, uint64_t count) {
+    count = count == LASER_ALL_POINTS ? info->point_count: count;
+    if(first > info->point_count || count > info->point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    } else if(count && (!plan->point_size || first > size / plan->point_size || count > size / plan->point_size - first)) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    _laser_decode_range(points, index, plan, ((const uint8_t*) raw_points) + (first * plan->point_size), count, plan->stats);
+    return LASER_SUCCESS;
+}
+
+typedef void (*_laserScanFn)(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count);
+
+/*
+ *  LAZ decoding follows LASzip: an adaptive arithmetic decoder (after Amir Said's FastAC) drives symbol and bit models,
+ *  integers are coded as corrections to a prediction by picking the bit length `k` of the correction first. Every chunk
+ *  stores its first record raw and restarts all models, so a chunk is the unit of random access. Decoders decompress
+ *  into regular records of the uncompressed format, which then run through the same plans, filters and scans as LAS.
+ *
+ *  Model tables are carved out of the decoder's arena, sized for the worst case of the file's items and reset per chunk.
+ */
+
+#define _LASER_LAZ_MIN_LENGTH 0x01000000u
+#define _LASER_LAZ_BIT_SHIFT 13
+#define _LASER_LAZ_BIT_MAX_COUNT (1u << 13)
+#define _LASER_LAZ_SYMBOL_SHIFT 15
+#define _LASER_LAZ_SYMBOL_MAX_COUNT (1u << 15)
+#define _LASER_LAZ_MAX_CONTEXTS 22
+
+#define _LASER_LAZ_GPSTIME_MULTI 500
+#define _LASER_LAZ_GPSTIME_MULTI_MINUS -10
+#define _LASER_LAZ_GPSTIME_MULTI_UNCHANGED (_LASER_LAZ_GPSTIME_MULTI - _LASER_LAZ_GPSTIME_MULTI_MINUS + 1)
+#define _LASER_LAZ_GPSTIME_MULTI_CODE_FULL (_LASER_LAZ_GPSTIME_MULTI - _LASER_LAZ_GPSTIME_MULTI_MINUS + 2)
+#define _LASER_LAZ_GPSTIME_MULTI_TOTAL (_LASER_LAZ_GPSTIME_MULTI - _LASER_LAZ_GPSTIME_MULTI_MINUS + 6)
+
+enum {
+    _LASER_LAZ_ITEM_BYTE = 0,
+    _LASER_LAZ_ITEM_POINT10 = 6,
+    _LASER_LAZ_ITEM_GPSTIME11 = 7,
+    _LASER_LAZ_ITEM_RGB12 = 8
+};
+
+static const uint8_t _LASER_LAZ_RETURN_MAP[8][8] = {
+    { 15, 14, 13, 12, 11, 10,  9,  8 },
+    { 14,  0,  1,  3,  6, 10, 10,  9 },
+    { 13,  1,  2,  4,  7, 11, 11, 10 },
+    { 12,  3,  4,  5,  8, 12, 12, 11 },
+    { 11,  6,  7,  8,  9, 13, 13, 12 },
+    { 10, 10, 11, 12, 13, 14, 14, 13 },
+    {  9, 10, 11, 12, 13, 14, 15, 14 },
+    {  8,  9, 10, 11, 12, 13, 14, 15 },
+};
+
+static const uint8_t _LASER_LAZ_RETURN_LEVEL[8][8] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7 },
+    { 1, 0, 1, 2, 3, 4, 5, 6 },
+    { 2, 1, 0, 1, 2, 3, 4, 5 },
+    { 3, 2, 1, 0, 1, 2, 3, 4 },
+    { 4, 3, 2, 1, 0, 1, 2, 3 },
+    { 5, 4, 3, 2, 1, 0, 1, 2 },
+    { 6, 5, 4, 3, 2, 1, 0, 1 },
+    { 7, 6, 5, 4, 3, 2, 1, 0 },
+};
+
+typedef struct _laserLazBit {
+    uint32_t bit_0_count;
+    uint32_t bit_count;
+    uint32_t bit_0_prob;
+    uint32_t update_cycle;
+    uint32_t bits_until_update;
+} _laserLazBit;
+
+typedef struct _laserLazModel {
+    uint32_t* distribution;
+    uint32_t* symbol_count;
+    uint32_t* decoder_table;
+    uint32_t symbols;
+    uint32_t total_count;
+    uint32_t update_cycle;
+    uint32_t symbols_until_update;
+    uint32_t table_size;
+    uint32_t table_shift;
+} _laserLazModel;
+
+typedef struct _laserLazIc {
+    uint32_t bits;
+    uint32_t range;
+    int32_t min;
+    uint32_t k;
+    _laserLazModel models[_LASER_LAZ_MAX_CONTEXTS];
+    _laserLazBit corrector_bit;
+    _laserLazModel correctors[33];
+} _laserLazIc;
+
+typedef struct _laserLazMedian {
+    int32_t values[5];
+    int high;
+} _laserLazMedian;
+
+typedef struct _laserLazDecoder {
+    const laserFile* file;
+    laserResult error;
+    uint64_t chunk;
+    uint64_t next;
+    uint32_t value;
+    uint32_t length;
+    const uint8_t* in;
+    const uint8_t* in_end;
+    uint64_t in_offset;
+    uint64_t in_limit;
+    uint8_t* arena;
+    uint64_t arena_size;
+    uint64_t arena_used;
+
+    int32_t gpstime_offset;
+    int32_t rgb_offset;
+    int32_t bytes_offset;
+    uint32_t byte_count;
+
+    int32_t x, y, z;
+    uint16_t intensity;
+    uint8_t returns;
+    uint8_t classification;
+    uint8_t scan_angle;
+    uint8_t usr;
+    uint16_t point_id;
+    uint16_t last_intensity[16];
+    int32_t last_height[8];
+    _laserLazMedian median_x[16];
+    _laserLazMedian median_y[16];
+    _laserLazModel changed_values;
+    _laserLazModel scan_angle_models[2];
+    _laserLazModel* returns_models[256];
+    _laserLazModel* classification_models[256];
+    _laserLazModel* usr_models[256];
+    _laserLazIc ic_intensity;
+    _laserLazIc ic_point_id;
+    _laserLazIc ic_dx;
+    _laserLazIc ic_dy;
+    _laserLazIc ic_z;
+
+    uint64_t gpstime[4];
+    int32_t gpstime_diff[4];
+    int32_t gpstime_extreme[4];
+    uint32_t gpstime_last;
+    uint32_t gpstime_next;
+    _laserLazModel gpstime_multi;
+    _laserLazModel gpstime_0diff;
+    _laserLazIc ic_gpstime;
+
+    uint16_t rgb[3];
+    _laserLazModel rgb_used;
+    _laserLazModel rgb_diff[6];
+
+    uint8_t* last_bytes;
+    _laserLazModel* byte_models;
+
+    uint8_t input[LASER_IO_BUFFER_SIZE];
+} _laserLazDecoder;
+
+static laserResult _laser_file_read(const laserFile* file, void* data, uint64_t size, uint64_t offset) {
+    if(file->mem) {
+        if(offset > file->size || size > file->size - offset) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+        memcpy(data, ((const uint8_t*) file->mem) + offset, size);
+        return LASER_SUCCESS;
+    }
+    return _LASER_IO(file->fn, file->usr, data, size, offset) == size ? LASER_SUCCESS: LASER_ERROR_IO_READ;
+}
+
+static uint64_t _laser_laz_model_size(uint32_t symbols) {
+    uint32_t table_bits = 3;
+    while(symbols > (1u << (table_bits + 2))) {
+        table_bits++;
+    }
+    uint64_t words = 2 * (uint64_t) symbols + (symbols > 16 ? (1u << table_bits) + 2: 0);
+    return (words * sizeof(uint32_t) + 7) & ~(uint64_t) 7;
+}
+
+static uint64_t _laser_laz_ic_size(uint32_t bits, uint32_t contexts) {
+    bits = bits && bits < 32 ? bits: 32;
+    uint64_t size = contexts * _laser_laz_model_size(bits + 1);
+    for(uint32_t i = 1; i <= bits; i++) {
+        size += _laser_laz_model_size(i <= 8 ? 1u << i: 256);
+    }
+    return size;
+}
+
+static uint64_t _laser_laz_arena_size(const laserLaz* laz) {
+    uint64_t size = _laser_laz_ic_size(32, 2);
+    uint64_t lazy = _laser_laz_model_size(256) + ((sizeof(_laserLazModel) + 7) & ~(uint64_t) 7);
+    uint64_t items = 0;
+    for(uint32_t i = 0; i < laz->item_count; i++) {
+        const laserLazItem* item = &laz->items[i];
+        if(item->type == _LASER_LAZ_ITEM_POINT10) {
+            items += _laser_laz_model_size(64) + _laser_laz_ic_size(16, 4) + 2 * _laser_laz_model_size(256) + _laser_laz_ic_size(16, 1);
+            items += _laser_laz_ic_size(32, 2) + _laser_laz_ic_size(32, 22) + _laser_laz_ic_size(32, 20) + 3 * 256 * lazy;
+        } else if(item->type == _LASER_LAZ_ITEM_GPSTIME11) {
+            items += _laser_laz_model_size(_LASER_LAZ_GPSTIME_MULTI_TOTAL) + _laser_laz_model_size(6) + _laser_laz_ic_size(32, 9);
+        } else if(item->type == _LASER_LAZ_ITEM_RGB12) {
+            items += _laser_laz_model_size(128) + 6 * _laser_laz_model_size(256);
+        } else if(item->type == _LASER_LAZ_ITEM_BYTE) {
+            items += item->size * lazy + ((item->size + 7) & ~(uint64_t) 7);
+        }
+    }
+    return size > items ? size: items;
+}
+
+static void* _laser_laz_alloc(_laserLazDecoder* decoder, uint64_t size) {
+    size = (size + 7) & ~(uint64_t) 7;
+    LASER_ASSERT(decoder->arena_used + size <= decoder->arena_size);
+    void* data = decoder->arena + decoder->arena_used;
+    decoder->arena_used += size;
+    return data;
+}
+
+static int _laser_laz_refill(_laserLazDecoder* decoder) {
+    const laserFile* file = decoder->file;
+    if(file->mem || decoder->in_offset >= decoder->in_limit) {
+        return 0;
+    }
+
+    uint64_t size = decoder->in_limit - decoder->in_offset;
+    size = size > sizeof(decoder->input) ? sizeof(decoder->input): size;
+    uint64_t read = _LASER_IO(file->fn, file->usr, decoder->input, size, decoder->in_offset);
+    if(!read) {
+        /* Only the chunk table runs to the end of the file, a chunk cut short is a failed read. */
+        decoder->error = decoder->in_limit != (uint64_t) -1 ? LASER_ERROR_IO_READ: decoder->error;
+        decoder->in_limit = decoder->in_offset;
+        return 0;
+    }
+    decoder->in = decoder->input;
+    decoder->in_end = decoder->input + read;
+    decoder->in_offset += read;
+    return 1;
+}
+
+static uint32_t _laser_laz_byte(_laserLazDecoder* decoder) {
+    if(decoder->in == decoder->in_end && !_laser_laz_refill(decoder)) {
+        /* LASzip pads every chunk so valid streams never get here, anything else decodes from zeros. */
+        return 0;
+    }
+    return *decoder->in++;
+}
+
+static void _laser_laz_seek(_laserLazDecoder* decoder, uint64_t offset, uint64_t limit) {
+    const laserFile* file = decoder->file;
+    if(file->mem) {
+        limit = limit < file->size ? limit: file->size;
+        offset = offset < limit ? offset: limit;
+        decoder->in = ((const uint8_t*) file->mem) + offset;
+        decoder->in_end = ((const uint8_t*) file->mem) + limit;
+    } else {
+        decoder->in = decoder->in_end = decoder->input;
+    }
+    decoder->in_offset = offset;
+    decoder->in_limit = limit;
+}
+
+static void _laser_laz_start(_laserLazDecoder* decoder) {
+    decoder->value = 0;
+    for(int i = 0; i < 4; i++) {
+        decoder->value = (decoder->value << 8) | _laser_laz_byte(decoder);
+    }
+    decoder->length = 0xFFFFFFFFu;
+}
+
+static void _laser_laz_renorm(_laserLazDecoder* decoder) {
+    do {
+        decoder->value = (decoder->value << 8) | _laser_laz_byte(decoder);
+    } while((decoder->length <<= 8) < _LASER_LAZ_MIN_LENGTH);
+}
+
+static void _laser_laz_bit_init(_laserLazBit* bit) {
+    bit->bit_0_count = 1;
+    bit->bit_count = 2;
+    bit->bit_0_prob = 1u << (_LASER_LAZ_BIT_SHIFT - 1);
+    bit->update_cycle = bit->bits_until_update = 4;
+}
+
+static void _laser_laz_bit_update(_laserLazBit* bit) {
+    if((bit->bit_count += bit->update_cycle) > _LASER_LAZ_BIT_MAX_COUNT) {
+        bit->bit_count = (bit->bit_count + 1) >> 1;
+        bit->bit_0_count = (bit->bit_0_count + 1) >> 1;
+        bit->bit_count += bit->bit_0_count == bit->bit_count;
+    }
+
+    uint32_t scale = 0x80000000u / bit->bit_count;
+    bit->bit_0_prob = (bit->bit_0_count * scale) >> (31 - _LASER_LAZ_BIT_SHIFT);
+    bit->update_cycle = (5 * bit->update_cycle) >> 2;
+    bit->update_cycle = bit->update_cycle > 64 ? 64: bit->update_cycle;
+    bit->bits_until_update = bit->update_cycle;
+}
+
+static uint32_t _laser_laz_decode_bit(_laserLazDecoder* decoder, _laserLazBit* bit) {
+    uint32_t x = bit->bit_0_prob * (decoder->length >> _LASER_LAZ_BIT_SHIFT);
+    uint32_t symbol = decoder->value >= x;
+    if(!symbol) {
+        decoder->length = x;
+        bit->bit_0_count++;
+    } else {
+        decoder->value -= x;
+        decoder->length -= x;
+    }
+
+    if(decoder->length < _LASER_LAZ_MIN_LENGTH) {
+        _laser_laz_renorm(decoder);
+    }
+    if(--bit->bits_until_update == 0) {
+        _laser_laz_bit_update(bit);
+    }
+    return symbol;
+}
+
+static void _laser_laz_model_update(_laserLazModel* model) {
+    if((model->total_count += model->update_cycle) > _LASER_LAZ_SYMBOL_MAX_COUNT) {
+        model->total_count = 0;
+        for(uint32_t i = 0; i < model->symbols; i++) {
+            model->total_count += (model->symbol_count[i] = (model->symbol_count[i] + 1) >> 1);
+        }
+    }
+
+    uint32_t sum = 0;
+    uint32_t scale = 0x80000000u / model->total_count;
+    if(!model->table_size) {
+        for(uint32_t i = 0; i < model->symbols; i++) {
+            model->distribution[i] = (scale * sum) >> (31 - _LASER_LAZ_SYMBOL_SHIFT);
+            sum += model->symbol_count[i];
+        }
+    } else {
+        uint32_t s = 0;
+        for(uint32_t i = 0; i < model->symbols; i++) {
+            model->distribution[i] = (scale * sum) >> (31 - _LASER_LAZ_SYMBOL_SHIFT);
+            sum += model->symbol_count[i];
+            uint32_t w = model->distribution[i] >> model->table_shift;
+            while(s < w) {
+                model->decoder_table[++s] = i - 1;
+            }
+        }
+        model->decoder_table[0] = 0;
+        while(s <= model->table_size) {
+            model->decoder_table[++s] = model->symbols - 1;
+        }
+    }
+
+    uint32_t max_cycle = (model->symbols + 6) << 3;
+    model->update_cycle = (5 * model->update_cycle) >> 2;
+    model->update_cycle = model->update_cycle > max_cycle ? max_cycle: model->update_cycle;
+    model->symbols_until_update = model->update_cycle;
+}
+
+static void _laser_laz_model_init(_laserLazDecoder* decoder, _laserLazModel* model, uint32_t symbols) {
+    uint32_t table_bits = 3;
+    while(symbols > (1u << (table_bits + 2))) {
+        table_bits++;
+    }
+
+    model->symbols = symbols;
+    model->table_size = symbols > 16 ? 1u << table_bits: 0;
+    model->table_shift = symbols > 16 ? _LASER_LAZ_SYMBOL_SHIFT - table_bits: 0;
+    model->distribution = (uint32_t*) _laser_laz_alloc(decoder, _laser_laz_model_size(symbols));
+    model->symbol_count = model->distribution + symbols;
+    model->decoder_table = symbols > 16 ? model->distribution + 2 * symbols: 0;
+    for(uint32_t i = 0; i < symbols; i++) {
+        model->symbol_count[i] = 1;
+    }
+
+    model->total_count = 0;
+    model->update_cycle = symbols;
+    _laser_laz_model_update(model);
+    model->symbols_until_update = model->update_cycle = (symbols + 6) >> 1;
+}
+
+static _laserLazModel* _laser_laz_model_lazy(_laserLazDecoder* decoder, _laserLazModel** models, uint32_t context) {
+    if(!models[context]) {
+        models[context] = (_laserLazModel*) _laser_laz_alloc(decoder, sizeof(_laserLazModel));
+        _laser_laz_model_init(decoder, models[context], 256);
+    }
+    return models[context];
+}
+
+static uint32_t _laser_laz_decode_symbol(_laserLazDecoder* decoder, _laserLazModel* model) {
+    uint32_t symbol = 0;
+    uint32_t x = 0;
+    uint32_t y = decoder->length;
+    if(model->decoder_table) {
+        uint32_t dv = decoder->value / (decoder->length >>= _LASER_LAZ_SYMBOL_SHIFT);
+        uint32_t t = dv >> model->table_shift;
+        t = t > model->table_size ? model->table_size: t;
+        symbol = model->decoder_table[t];
+        uint32_t n = model->decoder_table[t + 1] + 1;
+        while(n > symbol + 1) {
+            uint32_t k = (symbol + n) >> 1;
+            if(model->distribution[k] > dv) {
+                n = k;
+            } else {
+                symbol = k;
+            }
+        }
+        x = model->distribution[symbol] * decoder->length;
+        if(symbol != model->symbols - 1) {
+            y = model->distribution[symbol + 1] * decoder->length;
+        }
+    } else {
+        uint32_t n = model->symbols;
+        uint32_t k = n >> 1;
+        decoder->length >>= _LASER_LAZ_SYMBOL_SHIFT;
+        do {
+            uint32_t z = decoder->length * model->distribution[k];
+            if(z > decoder->value) {
+                n = k;
+                y = z;
+            } else {
+                symbol = k;
+                x = z;
+            }
+        } while((k = (symbol + n) >> 1) != symbol);
+    }
+
+    decoder->value -= x;
+    decoder->length = y - x;
+    if(decoder->length < _LASER_LAZ_MIN_LENGTH) {
+        _laser_laz_renorm(decoder);
+    }
+
+    model->symbol_count[symbol]++;
+    if(--model->symbols_until_update == 0) {
+        _laser_laz_model_update(model);
+    }
+    return symbol;
+}
+
+static uint32_t _laser_laz_read_bits(_laserLazDecoder* decoder, uint32_t bits) {
+    if(bits > 19) {
+        uint32_t low = _laser_laz_read_bits(decoder, 16);
+        return (_laser_laz_read_bits(decoder, bits - 16) << 16) | low;
+    }
+
+    uint32_t symbol = decoder->value / (decoder->length >>= bits);
+    decoder->value -= decoder->length * symbol;
+    if(decoder->length < _LASER_LAZ_MIN_LENGTH) {
+        _laser_laz_renorm(decoder);
+    }
+    return symbol;
+}
+
+static uint32_t _laser_laz_read_int(_laserLazDecoder* decoder) {
+    uint32_t low = _laser_laz_read_bits(decoder, 16);
+    return (_laser_laz_read_bits(decoder, 16) << 16) | low;
+}
+
+static void _laser_laz_ic_init(_laserLazDecoder* decoder, _laserLazIc* ic, uint32_t bits, uint32_t contexts) {
+    ic->bits = bits && bits < 32 ? bits: 32;
+    ic->range = bits && bits < 32 ? 1u << bits: 0;
+    ic->min = bits && bits < 32 ? -(int32_t) (ic->range / 2): INT32_MIN;
+    ic->k = 0;
+    for(uint32_t i = 0; i < contexts; i++) {
+        _laser_laz_model_init(decoder, &ic->models[i], ic->bits + 1);
+    }
+    _laser_laz_bit_init(&ic->corrector_bit);
+    for(uint32_t i = 1; i <= ic->bits; i++) {
+        _laser_laz_model_init(decoder, &ic->correctors[i], i <= 8 ? 1u << i: 256);
+    }
+}
+
+static int32_t _laser_laz_ic_decompress(_laserLazDecoder* decoder, _laserLazIc* ic, int32_t prediction, uint32_t context) {
+    /* `k` is the bit length of the correction, corrections wider than 8 bits send the low bits raw. */
+    uint32_t k = ic->k = _laser_laz_decode_symbol(decoder, &ic->models[context]);
+    uint32_t correction = 0;
+    if(!k) {
+        correction = _laser_laz_decode_bit(decoder, &ic->corrector_bit);
+    } else if(k < 32) {
+        correction = _laser_laz_decode_symbol(decoder, &ic->correctors[k]);
+        if(k > 8) {
+            correction = (correction << (k - 8)) | _laser_laz_read_bits(decoder, k - 8);
+        }
+        correction = correction >= (1u << (k - 1)) ? correction + 1: correction - ((1u << k) - 1);
+    } else {
+        correction = (uint32_t) ic->min;
+    }
+
+    uint32_t real = (uint32_t) prediction + correction;
+    if((int32_t) real < 0) {
+        real += ic->range;
+    } else if(real >= ic->range) {
+        real -= ic->range;
+    }
+    return (int32_t) real;
+}
+
+static void _laser_laz_median_init(_laserLazMedian* median) {
+    memset(median->values, 0, sizeof(median->values));
+    median->high = 1;
+}
+
+static void _laser_laz_median_add(_laserLazMedian* median, int32_t v) {
+    int32_t* values = median->values;
+    if(median->high) {
+        if(v < values[2]) {
+            values[4] = values[3];
+            values[3] = values[2];
+            if(v < values[0]) {
+                values[2] = values[1];
+                values[1] = values[0];
+                values[0] = v;
+            } else if(v < values[1]) {
+                values[2] = values[1];
+                values[1] = v;
+            } else {
+                values[2] = v;
+            }
+        } else {
+            if(v < values[3]) {
+                values[4] = values[3];
+                values[3] = v;
+            } else {
+                values[4] = v;
+            }
+            median->high = 0;
+        }
+    } else {
+        if(values[2] < v) {
+            values[0] = values[1];
+            values[1] = values[2];
+            if(values[4] < v) {
+                values[2] = values[3];
+                values[3] = values[4];
+                values[4] = v;
+            } else if(values[3] < v) {
+                values[2] = values[3];
+                values[3] = v;
+            } else {
+                values[2] = v;
+            }
+        } else {
+            if(values[1] < v) {
+                values[0] = values[1];
+                values[1] = v;
+            } else {
+                values[0] = v;
+            }
+            median->high = 1;
+        }
+    }
+}
+
+static uint8_t _laser_laz_clamp(int32_t v) {
+    return (uint8_t) (v < 0 ? 0: (v > 255 ? 255: v));
+}
+
+static void _laser_laz_point10_init(_laserLazDecoder* decoder, const uint8_t* raw_point) {
+    memcpy(&decoder->x, raw_point, 4);
+    memcpy(&decoder->y, raw_point + 4, 4);
+    memcpy(&decoder->z, raw_point + 8, 4);
+    decoder->intensity = 0;
+    decoder->returns = raw_point[14];
+    decoder->classification = raw_point[15];
+    decoder->scan_angle = raw_point[16];
+    decoder->usr = raw_point[17];
+    memcpy(&decoder->point_id, raw_point + 18, 2);
+    memset(decoder->last_intensity, 0, sizeof(decoder->last_intensity));
+    memset(decoder->last_height, 0, sizeof(decoder->last_height));
+    for(int i = 0; i < 16; i++) {
+        _laser_laz_median_init(&decoder->median_x[i]);
+        _laser_laz_median_init(&decoder->median_y[i]);
+    }
+
+    _laser_laz_model_init(decoder, &decoder->changed_values, 64);
+    _laser_laz_ic_init(decoder, &decoder->ic_intensity, 16, 4);
+    _laser_laz_model_init(decoder, &decoder->scan_angle_models[0], 256);
+    _laser_laz_model_init(decoder, &decoder->scan_angle_models[1], 256);
+    _laser_laz_ic_init(decoder, &decoder->ic_point_id, 16, 1);
+    memset(decoder->returns_models, 0, sizeof(decoder->returns_models));
+    memset(decoder->classification_models, 0, sizeof(decoder->classification_models));
+    memset(decoder->usr_models, 0, sizeof(decoder->usr_models));
+    _laser_laz_ic_init(decoder, &decoder->ic_dx, 32, 2);
+    _laser_laz_ic_init(decoder, &decoder->ic_dy, 32, 22);
+    _laser_laz_ic_init(decoder, &decoder->ic_z, 32, 20);
+}
+
+static void _laser_laz_point10_read(_laserLazDecoder* decoder, uint8_t* raw_point) {
+    uint32_t changed_values = _laser_laz_decode_symbol(decoder, &decoder->changed_values);
+    if(changed_values & 32) {
+        decoder->returns = (uint8_t) _laser_laz_decode_symbol(decoder, _laser_laz_model_lazy(decoder, decoder->returns_models, decoder->returns));
+    }
+
+    uint32_t r = decoder->returns & 0x7;
+    uint32_t n = (decoder->returns >> 3) & 0x7;
+    uint32_t m = _LASER_LAZ_RETURN_MAP[n][r];
+    uint32_t l = _LASER_LAZ_RETURN_LEVEL[n][r];
+    if(changed_values & 16) {
+        decoder->intensity = (uint16_t) _laser_laz_ic_decompress(decoder, &decoder->ic_intensity, decoder->last_intensity[m], m < 3 ? m: 3);
+        decoder->last_intensity[m] = decoder->intensity;
+    } else if(changed_values) {
+        decoder->intensity = decoder->last_intensity[m];
+    }
+    if(changed_values & 8) {
+        decoder->classification = (uint8_t) _laser_laz_decode_symbol(decoder, _laser_laz_model_lazy(decoder, decoder->classification_models, decoder->classification));
+    }
+    if(changed_values & 4) {
+        uint32_t delta = _laser_laz_decode_symbol(decoder, &decoder->scan_angle_models[(decoder->returns >> 6) & 1]);
+        decoder->scan_angle = (uint8_t) (delta + decoder->scan_angle);
+    }
+    if(changed_values & 2) {
+        decoder->usr = (uint8_t) _laser_laz_decode_symbol(decoder, _laser_laz_model_lazy(decoder, decoder->usr_models, decoder->usr));
+    }
+    if(changed_values & 1) {
+        decoder->point_id = (uint16_t) _laser_laz_ic_decompress(decoder, &decoder->ic_point_id, decoder->point_id, 0);
+    }
+
+    /* X and Y are predicted by the median of the last 5 differences of the same return, Z by the last height of the same level. */
+    int32_t diff = _laser_laz_ic_decompress(decoder, &decoder->ic_dx, decoder->median_x[m].values[2], n == 1);
+    decoder->x = (int32_t) ((uint32_t) decoder->x + (uint32_t) diff);
+    _laser_laz_median_add(&decoder->median_x[m], diff);
+
+    uint32_t k = decoder->ic_dx.k;
+    diff = _laser_laz_ic_decompress(decoder, &decoder->ic_dy, decoder->median_y[m].values[2], (n == 1) + (k < 20 ? k & ~1u: 20));
+    decoder->y = (int32_t) ((uint32_t) decoder->y + (uint32_t) diff);
+    _laser_laz_median_add(&decoder->median_y[m], diff);
+
+    k = (decoder->ic_dx.k + decoder->ic_dy.k) / 2;
+    decoder->z = _laser_laz_ic_decompress(decoder, &decoder->ic_z, decoder->last_height[l], (n == 1) + (k < 18 ? k & ~1u: 18));
+    decoder->last_height[l] = decoder->z;
+
+    memcpy(raw_point, &decoder->x, 4);
+    memcpy(raw_point + 4, &decoder->y, 4);
+    memcpy(raw_point + 8, &decoder->z, 4);
+    memcpy(raw_point + 12, &decoder->intensity, 2);
+    raw_point[14] = decoder->returns;
+    raw_point[15] = decoder->classification;
+    raw_point[16] = decoder->scan_angle;
+    raw_point[17] = decoder->usr;
+    memcpy(raw_point + 18, &decoder->point_id, 2);
+}
+
+static void _laser_laz_gpstime_init(_laserLazDecoder* decoder, const uint8_t* raw_point) {
+    memset(decoder->gpstime, 0, sizeof(decoder->gpstime));
+    memset(decoder->gpstime_diff, 0, sizeof(decoder->gpstime_diff));
+    memset(decoder->gpstime_extreme, 0, sizeof(decoder->gpstime_extreme));
+    memcpy(&decoder->gpstime[0], raw_point, 8);
+    decoder->gpstime_last = 0;
+    decoder->gpstime_next = 0;
+    _laser_laz_model_init(decoder, &decoder->gpstime_multi, _LASER_LAZ_GPSTIME_MULTI_TOTAL);
+    _laser_laz_model_init(decoder, &decoder->gpstime_0diff, 6);
+    _laser_laz_ic_init(decoder, &decoder->ic_gpstime, 32, 9);
+}
+
+static void _laser_laz_gpstime_full(_laserLazDecoder* decoder) {
+    uint32_t last = decoder->gpstime_last;
+    uint32_t next = decoder->gpstime_next = (decoder->gpstime_next + 1) & 3;
+    uint64_t high = (uint32_t) _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, (int32_t) (decoder->gpstime[last] >> 32), 8);
+    decoder->gpstime[next] = (high << 32) | _laser_laz_read_int(decoder);
+    decoder->gpstime_last = next;
+    decoder->gpstime_diff[next] = 0;
+    decoder->gpstime_extreme[next] = 0;
+}
+
+static int32_t _laser_laz_gpstime_extreme(_laserLazDecoder* decoder, uint32_t last, int32_t diff) {
+    if(++decoder->gpstime_extreme[last] > 3) {
+        decoder->gpstime_diff[last] = diff;
+        decoder->gpstime_extreme[last] = 0;
+    }
+    return diff;
+}
+
+static void _laser_laz_gpstime_read(_laserLazDecoder* decoder, uint8_t* raw_point) {
+    /*
+     *  Up to four interleaved time sequences are tracked, each predicting the next difference as a multiple of its
+     *  last one. A switch to another sequence is followed by that sequence's code, so the loop runs at most twice.
+     */
+    for(int pass = 0; pass < 2; pass++) {
+        uint32_t last = decoder->gpstime_last;
+        int32_t last_diff = decoder->gpstime_diff[last];
+        if(!last_diff) {
+            uint32_t multi = _laser_laz_decode_symbol(decoder, &decoder->gpstime_0diff);
+            if(multi == 1) {
+                decoder->gpstime_diff[last] = _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, 0, 0);
+                decoder->gpstime[last] += (uint64_t) (int64_t) decoder->gpstime_diff[last];
+                decoder->gpstime_extreme[last] = 0;
+            } else if(multi == 2) {
+                _laser_laz_gpstime_full(decoder);
+            } else if(multi > 2) {
+                decoder->gpstime_last = (last + multi - 2) & 3;
+                continue;
+            }
+        } else {
+            int32_t multi = (int32_t) _laser_laz_decode_symbol(decoder, &decoder->gpstime_multi);
+            if(multi == 1) {
+                /* Same difference as last time (within the residual), which stays the reference difference. */
+                decoder->gpstime[last] += (uint64_t) (int64_t) _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, last_diff, 1);
+                decoder->gpstime_extreme[last] = 0;
+            } else if(multi < _LASER_LAZ_GPSTIME_MULTI_UNCHANGED) {
+                int32_t diff = 0;
+                if(multi == 0) {
+                    diff = _laser_laz_gpstime_extreme(decoder, last, _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, 0, 7));
+                } else if(multi < _LASER_LAZ_GPSTIME_MULTI) {
+                    int32_t prediction = (int32_t) ((uint32_t) multi * (uint32_t) last_diff);
+                    diff = _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, prediction, multi < 10 ? 2: 3);
+                } else if(multi == _LASER_LAZ_GPSTIME_MULTI) {
+                    int32_t prediction = (int32_t) ((uint32_t) _LASER_LAZ_GPSTIME_MULTI * (uint32_t) last_diff);
+                    diff = _laser_laz_gpstime_extreme(decoder, last, _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, prediction, 4));
+                } else {
+                    multi = _LASER_LAZ_GPSTIME_MULTI - multi;
+                    if(multi > _LASER_LAZ_GPSTIME_MULTI_MINUS) {
+                        int32_t prediction = (int32_t) ((uint32_t) multi * (uint32_t) last_diff);
+                        diff = _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, prediction, 5);
+                    } else {
+                        int32_t prediction = (int32_t) ((uint32_t) _LASER_LAZ_GPSTIME_MULTI_MINUS * (uint32_t) last_diff);
+                        diff = _laser_laz_gpstime_extreme(decoder, last, _laser_laz_ic_decompress(decoder, &decoder->ic_gpstime, prediction, 6));
+                    }
+                }
+                decoder->gpstime[last] += (uint64_t) (int64_t) diff;
+            } else if(multi == _LASER_LAZ_GPSTIME_MULTI_CODE_FULL) {
+                _laser_laz_gpstime_full(decoder);
+            } else if(multi > _LASER_LAZ_GPSTIME_MULTI_CODE_FULL) {
+                decoder->gpstime_last = (last + (uint32_t) multi - _LASER_LAZ_GPSTIME_MULTI_CODE_FULL) & 3;
+                continue;
+            }
+        }
+        break;
+    }
+    memcpy(raw_point, &decoder->gpstime[decoder->gpstime_last], 8);
+}
+
+static void _laser_laz_rgb_init(_laserLazDecoder* decoder, const uint8_t* raw_point) {
+    memcpy(decoder->rgb, raw_point, 6);
+    _laser_laz_model_init(decoder, &decoder->rgb_used, 128);
+    for(int i = 0; i < 6; i++) {
+        _laser_laz_model_init(decoder, &decoder->rgb_diff[i], 256);
+    }
+}
+
+static uint32_t _laser_laz_rgb_byte(_laserLazDecoder* decoder, uint32_t used, uint32_t bit, int32_t prediction, uint32_t last) {
+    if(used & (1u << bit)) {
+        return (_laser_laz_decode_symbol(decoder, &decoder->rgb_diff[bit]) + _laser_laz_clamp(prediction)) & 0xFF;
+    }
+    return last;
+}
+
+static void _laser_laz_rgb_read(_laserLazDecoder* decoder, uint8_t* raw_point) {
+    /* Red is coded against the last red, green and blue against the last value moved by red's (and green's) change. */
+    uint16_t* last = decoder->rgb;
+    uint32_t used = _laser_laz_decode_symbol(decoder, &decoder->rgb_used);
+    uint32_t rgb[6];
+    rgb[0] = _laser_laz_rgb_byte(decoder, used, 0, last[0] & 0xFF, last[0] & 0xFF);
+    rgb[1] = _laser_laz_rgb_byte(decoder, used, 1, last[0] >> 8, last[0] >> 8);
+    if(used & (1 << 6)) {
+        int32_t diff = (int32_t) rgb[0] - (last[0] & 0xFF);
+        rgb[2] = _laser_laz_rgb_byte(decoder, used, 2, diff + (last[1] & 0xFF), last[1] & 0xFF);
+        diff = (diff + ((int32_t) rgb[2] - (last[1] & 0xFF))) / 2;
+        rgb[4] = _laser_laz_rgb_byte(decoder, used, 4, diff + (last[2] & 0xFF), last[2] & 0xFF);
+        diff = (int32_t) rgb[1] - (last[0] >> 8);
+        rgb[3] = _laser_laz_rgb_byte(decoder, used, 3, diff + (last[1] >> 8), last[1] >> 8);
+        diff = (diff + ((int32_t) rgb[3] - (last[1] >> 8))) / 2;
+        rgb[5] = _laser_laz_rgb_byte(decoder, used, 5, diff + (last[2] >> 8), last[2] >> 8);
+    } else {
+        rgb[2] = rgb[4] = rgb[0];
+        rgb[3] = rgb[5] = rgb[1];
+    }
+
+    for(int i = 0; i < 3; i++) {
+        last[i] = (uint16_t) (rgb[2 * i] | (rgb[2 * i + 1] << 8));
+    }
+    memcpy(raw_point, last, 6);
+}
+
+static void _laser_laz_bytes_init(_laserLazDecoder* decoder, const uint8_t* raw_point) {
+    decoder->last_bytes = (uint8_t*) _laser_laz_alloc(decoder, decoder->byte_count);
+    decoder->byte_models = (_laserLazModel*) _laser_laz_alloc(decoder, decoder->byte_count * ((sizeof(_laserLazModel) + 7) & ~(uint64_t) 7));
+    memcpy(decoder->last_bytes, raw_point, decoder->byte_count);
+    for(uint32_t i = 0; i < decoder->byte_count; i++) {
+        _laser_laz_model_init(decoder, &decoder->byte_models[i], 256);
+    }
+}
+
+static void _laser_laz_bytes_read(_laserLazDecoder* decoder, uint8_t* raw_point) {
+    for(uint32_t i = 0; i < decoder->byte_count; i++) {
+        decoder->last_bytes[i] = (uint8_t) (decoder->last_bytes[i] + _laser_laz_decode_symbol(decoder, &decoder->byte_models[i]));
+    }
+    memcpy(raw_point, decoder->last_bytes, decoder->byte_count);
+}
+
+static _laserLazDecoder* _laser_laz_decoder(const laserFile* file, uint32_t index) {
+    return (_laserLazDecoder*) (file->laz.decoders + index * file->laz.decoder_size);
+}
+
+static uint64_t _laser_laz_chunk(const laserLaz* laz, uint64_t point) {
+    if(laz->chunk_size != 0xFFFFFFFFu) {
+        return point / laz->chunk_size;
+    }
+
+    uint64_t low = 0;
+    uint64_t high = laz->chunk_count;
+    while(high - low > 1) {
+        uint64_t mid = (low + high) / 2;
+        if(laz->chunk_points[mid] <= point) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void _laser_laz_start_chunk(_laserLazDecoder* decoder, uint64_t chunk) {
+    const laserLaz* laz = &decoder->file->laz;
+    decoder->chunk = chunk;
+    decoder->next = laz->chunk_points[chunk];
+    decoder->arena_used = 0;
+    _laser_laz_seek(decoder, laz->chunk_offsets[chunk], laz->chunk_offsets[chunk + 1]);
+}
+
+/* Decodes the next record of the decoder's chunk, the first one of a chunk is stored raw and seeds every model. */
+static void _laser_laz_next(_laserLazDecoder* decoder, uint8_t* raw_point) {
+    const laserFile* file = decoder->file;
+    while(decoder->next == file->laz.chunk_points[decoder->chunk + 1]) {
+        _laser_laz_start_chunk(decoder, decoder->chunk + 1);
+    }
+
+    if(decoder->next == file->laz.chunk_points[decoder->chunk]) {
+        for(uint32_t i = 0; i < file->info.point_size; i++) {
+            raw_point[i] = (uint8_t) _laser_laz_byte(decoder);
+        }
+        _laser_laz_point10_init(decoder, raw_point);
+        if(decoder->gpstime_offset >= 0) {
+            _laser_laz_gpstime_init(decoder, raw_point + decoder->gpstime_offset);
+        }
+        if(decoder->rgb_offset >= 0) {
+            _laser_laz_rgb_init(decoder, raw_point + decoder->rgb_offset);
+        }
+        if(decoder->byte_count) {
+            _laser_laz_bytes_init(decoder, raw_point + decoder->bytes_offset);
+        }
+        _laser_laz_start(decoder);
+    } else {
+        _laser_laz_point10_read(decoder, raw_point);
+        if(decoder->gpstime_offset >= 0) {
+            _laser_laz_gpstime_read(decoder, raw_point + decoder->gpstime_offset);
+        }
+        if(decoder->rgb_offset >= 0) {
+            _laser_laz_rgb_read(decoder, raw_point + decoder->rgb_offset);
+        }
+        if(decoder->byte_count) {
+            _laser_laz_bytes_read(decoder, raw_point + decoder->bytes_offset);
+        }
+    }
+    decoder->next++;
+}
+
+/* Decodes `[first, first + count)` into `raw_points`, continuing the current chunk whenever `first` lies ahead in it. */
+static laserResult _laser_laz_decode(const laserFile* file, _laserLazDecoder* decoder, uint8_t* raw_points, uint64_t first, uint64_t count) {
+#if defined(LASER_TRACE)
+    uint64_t start = _laser_trace_enter(LASER_TRACE_DECOMPRESS, count);
+#endif
+    decoder->file = file;
+    uint64_t chunk = _laser_laz_chunk(&file->laz, first);
+    if(decoder->error != LASER_SUCCESS || decoder->chunk != chunk || decoder->next > first) {
+        decoder->error = LASER_SUCCESS;
+        _laser_laz_start_chunk(decoder, chunk);
+    }
+
+#if defined(LASER_TRACE)
+    uint64_t decompressed = first - decoder->next + count;
+#endif
+    while(decoder->next < first) {
+        _laser_laz_next(decoder, raw_points);
+    }
+    for(uint64_t i = 0; i < count; i++) {
+        _laser_laz_next(decoder, raw_points + i * file->info.point_size);
+    }
+#if defined(LASER_TRACE)
+    _LASER_TRACE_ADD(_laser_trace.decompress_ns, _laser_trace_leave(LASER_TRACE_DECOMPRESS, decompressed, start));
+    _LASER_TRACE_ADD(_laser_trace.points_decompressed, decompressed);
+#endif
+    return decoder->error;
+}
+
+/* Same contract as `_laser_scan_raw`, the records are decompressed into a stack buffer by decoder `index`. */
+static laserResult _laser_laz_scan(const laserFile* file, uint32_t index, uint64_t first, uint64_t count, _laserScanFn fn, void* usr) {
+    uint8_t point_buffer[LASER_IO_BUFFER_SIZE];
+    uint64_t max_point_count = sizeof(point_buffer) / file->info.point_size;
+    max_point_count = max_point_count > LASER_DECODE_BLOCK_SIZE ? LASER_DECODE_BLOCK_SIZE: max_point_count;
+    if(count && (!max_point_count || index >= file->laz.decoder_count)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    _laserLazDecoder* decoder = count ? _laser_laz_decoder(file, index): 0;
+    while(count > 0) {
+        uint64_t block = count < max_point_count ? count: max_point_count;
+        laserResult res = LASER_SUCCESS;
+        if((res = _laser_laz_decode(file, decoder, point_buffer, first, block)) != LASER_SUCCESS) {
+            return res;
+        }
+
+        fn(usr, point_buffer, first, block);
+        first += block;
+        count -= block;
+    }
+    return LASER_SUCCESS;
+}
+
+typedef struct _laserDecodeScan {
+    const laserPlan* plan;
+    void* points;
+    uint64_t index;
+    laserStats* stats;
+} _laserDecodeScan;
+
+static void _laser_scan_decode(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count) {
+    _laserDecodeScan* scan = (_laserDecodeScan*) usr;
+    (void) first;
+    _laser_decode_range(scan->points, scan->index, scan->plan, raw_point, count, scan->stats);
+    scan->index += count;
+}
+
+static laserResult _laser_read_attribs_from_laz(const laserFile* file, uint32_t decoder, const laserPlan* plan, void* points, uint64_t index, uint64_t first, uint64_t count, laserStats* stats) {
+    count = count == LASER_ALL_POINTS ? file->info.point_count: count;
+    if(first > file->info.point_count || count > file->info.point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    }
+
+    _laserDecodeScan scan;
+    scan.plan = plan;
+    scan.points = points;
+    scan.index = index;
+    scan.stats = stats;
+    return _laser_laz_scan(file, decoder, first, count, _laser_scan_decode, (void*) &scan);
+}
+
+static void _laser_cursor_fetch(void* arg) {
+    laserCursor* cursor = (laserCursor*) arg;
+    const laserFile* file = cursor->file;
+    uint64_t point_size = file->info.point_size;
+    cursor->fetch_read = _LASER_IO(file->fn, file->usr, cursor->fetch_buffer, cursor->fetch_count * point_size, file->info.point_offset + cursor->fetch_first * point_size);
+}
+
+static void _laser_cursor_prefetch(laserCursor* cursor, uint8_t* buffer) {
+    uint64_t max_point_count = (cursor->scratch_size / 2) / cursor->file->info.point_size;
+    uint64_t count = cursor->end - cursor->fetch_end;
+    cursor->fetch_buffer = buffer;
+    cursor->fetch_first = cursor->fetch_end;
+    cursor->fetch_count = count > max_point_count ? max_point_count: count;
+    cursor->fetch_end += cursor->fetch_count;
+    if(cursor->fetch_count) {
+        cursor->scheduler->submit(cursor->scheduler->usr, _laser_cursor_fetch, (void*) cursor);
+    }
+}
+
+static laserResult _laser_cursor_next_pipelined(laserCursor* cursor, void* points, uint64_t index, uint64_t capacity, uint64_t* decoded) {
+    const laserInfo* info = &cursor->file->info;
+    if(!cursor->ready_count) {
+        if(!cursor->fetch_count) {
+            return LASER_SUCCESS;
+        }
+
+        cursor->scheduler->wait(cursor->scheduler->usr);
+        uint64_t count = cursor->fetch_count;
+        cursor->fetch_count = 0;
+        if(cursor->fetch_read != count * info->point_size) {
+            return LASER_ERROR_IO_READ;
+        }
+
+        cursor->ready_data = cursor->fetch_buffer;
+        cursor->ready_count = count;
+        _laser_cursor_prefetch(cursor, cursor->fetch_buffer == cursor->buffers[0] ? cursor->buffers[1]: cursor->buffers[0]);
+    }
+
+    uint64_t count = cursor->ready_count > capacity ? capacity: cursor->ready_count;
+    laserResult res = _laser_read_attribs_from_mem(points, index, cursor->plan, info, cursor->ready_data, count * info->point_size, 0, count);
+    if(res == LASER_SUCCESS) {
+        cursor->ready_data += count * info->point_size;
+        cursor->ready_count -= count;
+        cursor->next += count;
+        *decoded = count;
+    }
+    return res;
+}
+
+static laserResult _laser_cursor_next(laserCursor* cursor, void* points, uint64_t index, uint64_t capacity, uint64_t* decoded) {
+    *decoded = 0;
+    if(cursor->result != LASER_SUCCESS) {
+        return cursor->result;
+    } else if(cursor->scheduler) {
+        return cursor->result = _laser_cursor_next_pipelined(cursor, points, index, capacity, decoded);
+    }
+
+    const laserFile* file = cursor->file;
+    const laserInfo* info = &file->info;
+    uint64_t count = cursor->end - cursor->next;
+    count = count > capacity ? capacity: count;
+
+    if(!count) {
+        return LASER_SUCCESS;
+    }
+
+    laserResult res = LASER_SUCCESS;
+    if(info->compressed) {
+        res = _laser_read_attribs_from_laz(file, 0, cursor->plan, points, index, cursor->next, count, cursor->plan->stats);
+    } else if(file->mem) {
+        res = _laser_read_attribs_from_mem(points, index, cursor->plan, info, ((uint8_t*) file->mem) + info->point_offset, _laser_points_size(file), cursor->next, count);
+    } else {
+        uint64_t max_point_count = cursor->scratch_size / info->point_size;
+        count = count > max_point_count ? max_point_count: count;
+
+        uint64_t expected = count * info->point_size;
+        uint64_t read = _LASER_IO(file->fn, file->usr, cursor->scratch, expected, info->point_offset + cursor->next * info->point_size);
+        if(read != expected) {
+            return cursor->result = LASER_ERROR_IO_READ;
+        }
+        res = _laser_read_attribs_from_mem(points, index, cursor->plan, info, cursor->scratch, read, 0, count);
+    }
+
+    if(res == LASER_SUCCESS) {
+        cursor->next += count;
+        *decoded = count;
+    }
+    return cursor->result = res;
+}
+
+laserResult laser_cursor_init(laserCursor* cursor, const laserFile* file, const laserPlan* plan, void* scratch, uint64_t scratch_size, uint64_t first, uint64_t count) {
+    uint64_t point_count = file->info.point_count;
+    if(plan->filter) {
+        return LASER_ERROR_FILTERED_PLAN;
+    } else if(first > point_count) {
+        return LASER_ERROR_INVALID_RANGE;
+    }
+
+    count = count == LASER_ALL_POINTS ? point_count - first: count;
+    if(count > point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    } else if(file->info.compressed ? !file->laz.decoder_count: (!file->mem && scratch_size < file->info.point_size)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    cursor->file = file;
+    cursor->plan = plan;
+    cursor->scratch = (uint8_t*) scratch;
+    cursor->scratch_size = scratch_size;
+    cursor->next = first;
+    cursor->end = first + count;
+    cursor->scheduler = 0;
+    cursor->ready_data = 0;
+    cursor->ready_count = 0;
+    cursor->fetch_count = 0;
+    cursor->result = LASER_SUCCESS;
+    return LASER_SUCCESS;
+}
+
+laserResult laser_cursor_init_pipelined(laserCursor* cursor, const laserFile* file, const laserPlan* plan, void* scratch, uint64_t scratch_size, uint64_t first, uint64_t count, laserScheduler* scheduler) {
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_cursor_init(cursor, file, plan, scratch, scratch_size, first, count)) != LASER_SUCCESS || file->mem || file->info.compressed) {
+        return res;
+    } else if((scratch_size / 2) < file->info.point_size) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    cursor->scheduler = scheduler;
+    cursor->buffers[0] = (uint8_t*) scratch;
+    cursor->buffers[1] = ((uint8_t*) scratch) + (scratch_size / 2);
+    cursor->fetch_end = cursor->next;
+    _laser_cursor_prefetch(cursor, cursor->buffers[0]);
+    return LASER_SUCCESS;
+}
+
+laserResult laser_cursor_next(laserCursor* cursor, void* points, uint64_t capacity, uint64_t* decoded) {
+    return _laser_cursor_next(cursor, points, 0, capacity, decoded);
+}
+
+void laser_cursor_close(laserCursor* cursor) {
+    if(cursor->scheduler && cursor->fetch_count) {
+        cursor->scheduler->wait(cursor->scheduler->usr);
+        cursor->fetch_count = 0;
+    }
+}
+
+static laserResult _laser_read_attribs_from_io(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count) {
+    uint8_t point_buffer[LASER_IO_BUFFER_SIZE];
+
+    count = count == LASER_ALL_POINTS ? file->info.point_count: count;
+    if(first > file->info.point_count || count > file->info.point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    }
+
+    laserCursor cursor;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_cursor_init(&cursor, file, plan, (void*) point_buffer, sizeof(point_buffer), first, count)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    uint64_t index = 0;
+    uint64_t decoded = 0;
+    do {
+        res = _laser_cursor_next(&cursor, points, index, (uint64_t) -1, &decoded);
+        index += decoded;
+    } while(res == LASER_SUCCESS && decoded);
+    return res;
+}
+
+static int32_t _laser_filter_quantize(double value, float scale, float offset, int round_up) {
+    double quantized = (value - offset) / scale;
+    if(quantized <= (double) INT32_MIN) {
+        return INT32_MIN;
+    } else if(quantized >= (double) INT32_MAX) {
+        return INT32_MAX;
+    }
+
+    int32_t truncated = (int32_t) quantized;
+    if(round_up && (double) truncated < quantized) {
+        truncated++;
+    } else if(!round_up && (double) truncated > quantized) {
+        truncated--;
+    }
+    return truncated;
+}
+
+static uint64_t _laser_filter_block(const laserPlan* plan, const uint8_t* raw_point, uint64_t count, uint16_t* selection) {
+    uint64_t selected = 0;
+    for(uint64_t i = 0; i < count; i++) {
+        const int32_t* xyz = (const int32_t*) raw_point;
+        uint32_t classification = raw_point[plan->classification_offset] & plan->classification_mask;
+        uint32_t return_number = raw_point[_LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_FLAGS]] & plan->return_mask;
+        uint32_t withheld = raw_point[_LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_CLASSIFICATION]] & plan->filter_withheld;
+        uint32_t keep =
+            (xyz[0] >= plan->filter_min[0]) & (xyz[0] <= plan->filter_max[0]) &
+            (xyz[1] >= plan->filter_min[1]) & (xyz[1] <= plan->filter_max[1]) &
+            (xyz[2] >= plan->filter_min[2]) & (xyz[2] <= plan->filter_max[2]) &
+            (plan->filter_classifications[classification >> 5] >> (classification & 0x1F)) &
+            (plan->filter_returns >> return_number) &
+            (withheld == 0);
+        selection[selected] = (uint16_t) i;
+        selected += keep & 1;
+        raw_point += plan->point_size;
+    }
+    return selected;
+}
+
+enum {
+    _LASER_PLAN_FILTER = (1 << 0),
+    _LASER_PLAN_SAMPLE = (1 << 1)
+};
+
+static uint64_t _laser_mix_64(uint64_t v) {
+    v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ull;
+    v = (v ^ (v >> 27)) * 0x94D049BB133111EBull;
+    return v ^ (v >> 31);
+}
+
+static uint32_t _laser_voxel_axis(int32_t value, int32_t min, double scale) {
+    double voxel = (double) ((int64_t) value - min) * scale;
+    voxel = voxel < 0.0 ? 0.0: voxel;
+    return voxel < 2097151.0 ? (uint32_t) voxel: 2097151;
+}
+
+static int _laser_voxels_insert(laserVoxels* voxels, uint64_t key) {
+    uint64_t mask = voxels->capacity - 1;
+    if(voxels->count >= voxels->capacity - voxels->capacity / 4) {
+        voxels->count = voxels->capacity;
+        return 0;
+    }
+
+    for(uint64_t slot = _laser_mix_64(key) & mask;; slot = (slot + 1) & mask) {
+        if(voxels->slots[slot] == key) {
+            return 0;
+        } else if(!voxels->slots[slot]) {
+            voxels->slots[slot] = key;
+            voxels->count++;
+            return 1;
+        }
+    }
+}
+
+static uint64_t _laser_sample_block(const laserPlan* plan, const uint8_t* raw_point, uint64_t first, uint16_t* selection, uint64_t selected) {
+    uint64_t kept = 0;
+    switch(plan->sample) {
+        case LASER_SAMPLE_EVERY: {
+            /* Walks the multiples of `every` alongside the ascending selection instead of dividing per point. */
+            uint64_t next = (plan->sample_every - first % plan->sample_every) % plan->sample_every;
+            for(uint64_t i = 0; i < selected; i++) {
+                while(next < selection[i]) {
+                    next += plan->sample_every;
+                }
+                selection[kept] = selection[i];
+                kept += next == selection[i];
+            }
+            break;
+        }
+        case LASER_SAMPLE_FRACTION:
+            for(uint64_t i = 0; i < selected; i++) {
+                selection[kept] = selection[i];
+                kept += (_laser_mix_64((first + selection[i]) ^ plan->sample_seed) >> 32) < plan->sample_threshold;
+            }
+            break;
+        case LASER_SAMPLE_VOXEL:
+            for(uint64_t i = 0; i < selected; i++) {
+                const int32_t* xyz = (const int32_t*) (raw_point + selection[i] * plan->point_size);
+                uint64_t key = ((uint64_t) 1 << 63) |
+                    ((uint64_t) _laser_voxel_axis(xyz[0], plan->sample_min[0], plan->sample_scale[0])) |
+                    ((uint64_t) _laser_voxel_axis(xyz[1], plan->sample_min[1], plan->sample_scale[1]) << 21) |
+                    ((uint64_t) _laser_voxel_axis(xyz[2], plan->sample_min[2], plan->sample_scale[2]) << 42);
+                selection[kept] = selection[i];
+                kept += _laser_voxels_insert(plan->voxels, key);
+            }
+            break;
+        default:
+            kept = selected;
+            break;
+    }
+    return kept;
+}
+
+static uint64_t _laser_select_block(const laserPlan* plan, const uint8_t* raw_point, uint64_t first, uint64_t count, uint16_t* selection) {
+    uint64_t selected = count;
+    if(plan->filter & _LASER_PLAN_FILTER) {
+        selected = _laser_filter_block(plan, raw_point, count, selection);
+    } else {
+        for(uint64_t i = 0; i < count; i++) {
+            selection[i] = (uint16_t) i;
+        }
+    }
+    return (plan->filter & _LASER_PLAN_SAMPLE) ? _laser_sample_block(plan, raw_point, first, selection, selected): selected;
+}
+
+static laserResult _laser_sample_result(const laserPlan* plan) {
+    int full = plan && (plan->filter & _LASER_PLAN_SAMPLE) && plan->voxels && plan->voxels->count >= plan->voxels->capacity;
+    return full ? LASER_ERROR_BUFFER_TOO_SMALL: LASER_SUCCESS;
+}
+
+static uint64_t _laser_read_filtered_block(const laserPlan* plan, uint8_t* points, uint64_t index, const uint8_t* raw_point, uint64_t first, uint64_t count, int decode) {
+    uint16_t selection[LASER_DECODE_BLOCK_SIZE];
+    uint64_t selected = _laser_select_block(plan, raw_point, first, count, selection);
+    if(!decode) {
+        return selected;
+    }
+
+    /* Consecutive matches are decoded as runs, the plan kernels never see a gathered copy. */
+    for(uint64_t i = 0; i < selected;) {
+        uint64_t run = 1;
+        while(i + run < selected && selection[i + run] == selection[i] + run) {
+            run++;
+        }
+        _LASER_DECODE(plan, points, index, raw_point + selection[i] * plan->point_size, run);
+        if(plan->stats) {
+            _laser_stats_block(plan->stats, plan, raw_point + selection[i] * plan->point_size, run);
+        }
+        index += run;
+        i += run;
+    }
+    return selected;
+}
+
+/*
+ *  Hands the raw records of a range to `fn` in pieces of at most `LASER_DECODE_BLOCK_SIZE`, io files are read
+ *  through a stack buffer of `LASER_IO_BUFFER_SIZE` and LAZ files are decompressed into one by the first decoder.
+ */
+static laserResult _laser_scan_raw(const laserFile* file, uint64_t first, uint64_t count, _laserScanFn fn, void* usr) {
+    uint8_t point_buffer[LASER_IO_BUFFER_SIZE];
+    const laserInfo* info = &file->info;
+
+    count = count == LASER_ALL_POINTS ? info->point_count: count;
+    if(first > info->point_count || count > info->point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    } else if(info->compressed) {
+        return _laser_laz_scan(file, 0, first, count, fn, usr);
+    }
+
+    uint64_t max_point_count = file->mem ? count: sizeof(point_buffer) / info->point_size;
+    if(count && !max_point_count) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    while(count > 0) {
+        uint64_t chunk = count < max_point_count ? count: max_point_count;
+        const uint8_t* raw_point = 0;
+        if(file->mem) {
+            raw_point = ((const uint8_t*) file->mem) + info->point_offset + first * info->point_size;
+        } else {
+            uint64_t expected = chunk * info->point_size;
+            if(_LASER_IO(file->fn, file->usr, point_buffer, expected, info->point_offset + first * info->point_size) != expected) {
+                return LASER_ERROR_IO_READ;
+            }
+            raw_point = point_buffer;
+        }
+
+        for(uint64_t i = 0; i < chunk; i += LASER_DECODE_BLOCK_SIZE) {
+            uint64_t block = (chunk - i) < LASER_DECODE_BLOCK_SIZE ? (chunk - i): LASER_DECODE_BLOCK_SIZE;
+            fn(usr, raw_point + i * info->point_size, first + i, block);
+        }
+        first += chunk;
+        count -= chunk;
+    }
+    return LASER_SUCCESS;
+}
+
+typedef struct _laserFilterScan {
+    const laserPlan* plan;
+    uint8_t* points;
+    uint64_t index;
+    int decode;
+} _laserFilterScan;
+
+static void _laser_scan_filtered(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count) {
+    _laserFilterScan* scan = (_laserFilterScan*) usr;
+    scan->index += _laser_read_filtered_block(scan->plan, scan->points, scan->index, raw_point, first, count, scan->decode);
+}
+
+static laserResult _laser_read_filtered(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count, uint64_t* matched, int decode) {
+    _laserFilterScan scan;
+    scan.plan = plan;
+    scan.points = (uint8_t*) points;
+    scan.index = 0;
+    scan.decode = decode;
+
+    laserResult res = _laser_scan_raw(file, first, count, _laser_scan_filtered, (void*) &scan);
+    *matched = scan.index;
+    return res == LASER_SUCCESS ? _laser_sample_result(plan): res;
+}
+
+static laserResult _laser_open_header(laserFile* file, void* mem, uint64_t size) {
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_info_from_mem(&file->info, mem, size)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    const laserPublicHeaderBlock* public_header_block = (const laserPublicHeaderBlock*) mem;
+    file->header_size = public_header_block->phb_size;
+    file->vlr_count = public_header_block->vlr_count;
+    file->mem = mem;
+    file->size = size;
+    file->fn = 0;
+    file->usr = 0;
+    memset(&file->laz, 0, sizeof(file->laz));
+    return LASER_SUCCESS;
+}
+
+/* Finds the LASzip VLR of a LAZ file, files without one open fine and fail in `laser_laz_attach`. */
+static laserResult _laser_open_laz(laserFile* file) {
+    uint64_t offset = file->header_size;
+    for(uint32_t i = 0; i < file->vlr_count && file->info.compressed; i++) {
+        uint8_t header[54];
+        laserResult res = LASER_SUCCESS;
+        if((res = _laser_file_read(file, header, sizeof(header), offset)) != LASER_SUCCESS) {
+            return res;
+        }
+
+        uint16_t record_id = (uint16_t) (header[18] | (header[19] << 8));
+        uint16_t length = (uint16_t) (header[20] | (header[21] << 8));
+        offset += sizeof(header);
+        if(record_id != 22204 || memcmp(header + 2, "laszip encoded", 15) != 0) {
+            offset += length;
+            continue;
+        }
+
+        uint8_t vlr[34 + 6 * LASER_LAZ_MAX_ITEMS];
+        uint32_t item_count = length >= 34 ? (uint32_t) ((length - 34) / 6): 0;
+        item_count = item_count > LASER_LAZ_MAX_ITEMS ? LASER_LAZ_MAX_ITEMS: item_count;
+        if(length < 34 || (res = _laser_file_read(file, vlr, 34 + 6 * item_count, offset)) != LASER_SUCCESS) {
+            return length < 34 ? LASER_ERROR_INVALID_FILE: res;
+        }
+
+        /* More items than fit are left unparsed, the layout check then rejects the file. */
+        laserLaz* laz = &file->laz;
+        memcpy(&laz->chunk_size, vlr + 12, 4);
+        laz->compressor = (uint32_t) (vlr[0] | (vlr[1] << 8));
+        laz->coder = (uint32_t) (vlr[2] | (vlr[3] << 8));
+        laz->item_count = (uint32_t) (vlr[32] | (vlr[33] << 8));
+        laz->item_count = laz->item_count > item_count ? item_count: laz->item_count;
+        for(uint32_t j = 0; j < laz->item_count; j++) {
+            memcpy(&laz->items[j], vlr + 34 + 6 * j, 6);
+        }
+        break;
+    }
+    return LASER_SUCCESS;
+}
+
+laserResult laser_open_from_mem(laserFile* file, void* mem, uint64_t size) {
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_open_header(file, mem, size)) != LASER_SUCCESS) {
+        return res;
+    } else if(!_laser_points_fit(&file->info, size)) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+    return _laser_open_laz(file);
+}
+
+laserResult laser_open_from_io(laserFile* file, laserIoReadFn fn, void* usr) {
+    laserPublicHeaderBlock14 public_header_block;
+    uint64_t read = _LASER_IO(fn, usr, (void*) &public_header_block, sizeof(laserPublicHeaderBlock14), 0);
+    if(read < sizeof(laserPublicHeaderBlock)) {
+        return LASER_ERROR_IO_READ;
+    }
+
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_open_header(file, (void*) &public_header_block, read)) != LASER_SUCCESS) {
+        return res;
+    }
+    file->mem = 0;
+    file->size = 0;
+    file->fn = fn;
+    file->usr = usr;
+    return _laser_open_laz(file);
+}
+
+/* Only the layouts written for point formats 0 - 3 are decodable: point10, then optionally gpstime11, rgb12 and extra bytes. */
+static laserResult _laser_laz_layout(const laserFile* file, _laserLazDecoder* decoder) {
+    static const uint16_t order[4] = { _LASER_LAZ_ITEM_POINT10, _LASER_LAZ_ITEM_GPSTIME11, _LASER_LAZ_ITEM_RGB12, _LASER_LAZ_ITEM_BYTE };
+    static const uint16_t sizes[4] = { 20, 8, 6, 0 };
+    const laserLaz* laz = &file->laz;
+    int32_t offsets[4] = { -1, -1, -1, -1 };
+    uint32_t byte_count = 0;
+    uint32_t offset = 0;
+    uint32_t next = 0;
+    if(laz->compressor != 2 || laz->coder != 0 || !laz->chunk_size || !laz->item_count || laz->items[0].type != _LASER_LAZ_ITEM_POINT10) {
+        return LASER_ERROR_FORMAT_UNSUPPORTED;
+    }
+
+    for(uint32_t i = 0; i < laz->item_count; i++) {
+        const laserLazItem* item = &laz->items[i];
+        while(next < 4 && order[next] != item->type) {
+            next++;
+        }
+        if(next == 4 || item->version != 2 || (sizes[next] && item->size != sizes[next]) || !item->size) {
+            return LASER_ERROR_FORMAT_UNSUPPORTED;
+        }
+
+        offsets[next] = (int32_t) offset;
+        byte_count = order[next] == _LASER_LAZ_ITEM_BYTE ? item->size: byte_count;
+        offset += item->size;
+        next++;
+    }
+    if(offset != file->info.point_size) {
+        return LASER_ERROR_FORMAT_UNSUPPORTED;
+    }
+
+    if(decoder) {
+        decoder->gpstime_offset = offsets[1];
+        decoder->rgb_offset = offsets[2];
+        decoder->bytes_offset = offsets[3];
+        decoder->byte_count = byte_count;
+    }
+    return LASER_SUCCESS;
+}
+
+static laserResult _laser_laz_table(const laserFile* file, uint64_t* table_offset, uint64_t* chunk_count) {
+    int64_t offset = 0;
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_file_read(file, &offset, sizeof(offset), file->info.point_offset)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    /* Writers that could not seek back store the table offset at the end of the file instead, only memory files know where that is. */
+    if(offset == -1 && (!file->mem || file->size < 8 || (res = _laser_file_read(file, &offset, sizeof(offset), file->size - 8)) != LASER_SUCCESS)) {
+        return file->mem ? LASER_ERROR_INVALID_FILE: LASER_ERROR_FORMAT_UNSUPPORTED;
+    }
+
+    *table_offset = (uint64_t) offset;
+    *chunk_count = 0;
+    if(offset == (int64_t) file->info.point_offset) {
+        return file->info.point_count ? LASER_ERROR_INVALID_FILE: LASER_SUCCESS;
+    } else if(offset < (int64_t) file->info.point_offset) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    uint32_t table[2];
+    if((res = _laser_file_read(file, table, sizeof(table), (uint64_t) offset)) != LASER_SUCCESS) {
+        return res;
+    }
+    *chunk_count = table[1];
+    return table[0] != 0 ? LASER_ERROR_INVALID_FILE: LASER_SUCCESS;
+}
+
+static uint64_t _laser_laz_decoder_size(const laserFile* file) {
+    return ((sizeof(_laserLazDecoder) + 7) & ~(uint64_t) 7) + _laser_laz_arena_size(&file->laz);
+}
+
+laserResult laser_laz_size(const laserFile* file, uint32_t decoders, uint64_t* size) {
+    *size = 0;
+    if(!file->info.compressed) {
+        return LASER_SUCCESS;
+    }
+
+    uint64_t table_offset = 0;
+    uint64_t chunk_count = 0;
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_laz_layout(file, 0)) != LASER_SUCCESS || (res = _laser_laz_table(file, &table_offset, &chunk_count)) != LASER_SUCCESS) {
+        return res;
+    }
+    *size = 2 * (chunk_count + 1) * sizeof(uint64_t) + decoders * _laser_laz_decoder_size(file);
+    return LASER_SUCCESS;
+}
+
+laserResult laser_laz_attach(laserFile* file, void* mem, uint64_t size, uint32_t decoders) {
+    if(!file->info.compressed) {
+        return LASER_SUCCESS;
+    }
+
+    laserLaz* laz = &file->laz;
+    uint64_t table_offset = 0;
+    uint64_t chunk_count = 0;
+    uint64_t required = 0;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_laz_size(file, decoders, &required)) != LASER_SUCCESS || (res = _laser_laz_table(file, &table_offset, &chunk_count)) != LASER_SUCCESS) {
+        return res;
+    } else if(!decoders || size < required) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    laz->decoder_count = 0;
+    laz->chunk_count = chunk_count;
+    laz->chunk_points = (uint64_t*) mem;
+    laz->chunk_offsets = laz->chunk_points + chunk_count + 1;
+    laz->decoders = (uint8_t*) (laz->chunk_offsets + chunk_count + 1);
+    laz->decoder_size = _laser_laz_decoder_size(file);
+    for(uint32_t i = 0; i < decoders; i++) {
+        _laserLazDecoder* decoder = _laser_laz_decoder(file, i);
+        decoder->file = file;
+        decoder->error = LASER_SUCCESS;
+        decoder->chunk = (uint64_t) -1;
+        decoder->next = 0;
+        decoder->arena = ((uint8_t*) decoder) + ((sizeof(_laserLazDecoder) + 7) & ~(uint64_t) 7);
+        decoder->arena_size = _laser_laz_arena_size(laz);
+        decoder->arena_used = 0;
+        _laser_laz_layout(file, decoder);
+    }
+
+    /* The table holds the point count (variable chunks only) and byte size of every chunk, each coded against the previous one. */
+    _laserLazDecoder* decoder = _laser_laz_decoder(file, 0);
+    int variable = laz->chunk_size == 0xFFFFFFFFu;
+    laz->chunk_points[0] = 0;
+    laz->chunk_offsets[0] = file->info.point_offset + 8;
+    if(chunk_count) {
+        _laser_laz_seek(decoder, table_offset + 8, (uint64_t) -1);
+        _laser_laz_start(decoder);
+        _laserLazIc* ic = &decoder->ic_dx;
+        _laser_laz_ic_init(decoder, ic, 32, 2);
+        for(uint64_t i = 1; i <= chunk_count; i++) {
+            if(variable) {
+                laz->chunk_points[i] = (uint32_t) _laser_laz_ic_decompress(decoder, ic, i > 1 ? (int32_t) laz->chunk_points[i - 1]: 0, 0);
+            }
+            laz->chunk_offsets[i] = (uint32_t) _laser_laz_ic_decompress(decoder, ic, i > 1 ? (int32_t) laz->chunk_offsets[i - 1]: 0, 1);
+        }
+        if(decoder->error != LASER_SUCCESS) {
+            return decoder->error;
+        }
+    }
+
+    for(uint64_t i = 1; i <= chunk_count; i++) {
+        uint64_t points = (uint64_t) laz->chunk_size * i;
+        laz->chunk_points[i] = variable ? laz->chunk_points[i - 1] + laz->chunk_points[i]: (points < file->info.point_count ? points: file->info.point_count);
+        laz->chunk_offsets[i] += laz->chunk_offsets[i - 1];
+    }
+    if(laz->chunk_points[chunk_count] != file->info.point_count || (file->mem && laz->chunk_offsets[chunk_count] > file->size)) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+    laz->decoder_count = decoders;
+    return LASER_SUCCESS;
+}
+
+void laser_plan_attribs(laserPlan* plan, const laserFile* file, const laserAttrib* attribs, uint64_t stride) {
+    _laser_plan_compile(plan, &file->info, attribs, stride);
+}
+
+void laser_plan_columns(laserPlan* plan, const laserFile* file, const laserColumn* columns) {
+    _laser_plan_compile_columns(plan, &file->info, columns);
+}
+
+void laser_plan_time_base(laserPlan* plan, double time_base) {
+    plan->time_base = time_base;
+}
+
+void laser_plan_filter(laserPlan* plan, const laserFile* file, const laserFilter* filter) {
+    const laserInfo* info = &file->info;
+    uint32_t flags = filter ? filter->flags: 0;
+
+    plan->filter = (plan->filter & ~_LASER_PLAN_FILTER) | (flags ? _LASER_PLAN_FILTER: 0);
+    /* `classifications` covers the classes of formats 0 - 5, the classes above 31 of formats 6 - 10 pass only without it. */
+    plan->filter_classifications[0] = (flags & LASER_FILTER_CLASSIFICATION) ? filter->classifications: 0xFFFFFFFF;
+    for(uint32_t i = 1; i < 8; i++) {
+        plan->filter_classifications[i] = (flags & LASER_FILTER_CLASSIFICATION) ? 0: 0xFFFFFFFF;
+    }
+    plan->filter_returns = (flags & LASER_FILTER_RETURN_NUMBER) ? filter->returns: 0xFFFF;
+    plan->filter_withheld = (flags & LASER_FILTER_WITHHELD) ? plan->withheld_mask: 0;
+    for(uint32_t i = 0; i < 3; i++) {
+        plan->filter_min[i] = INT32_MIN;
+        plan->filter_max[i] = INT32_MAX;
+    }
+
+    if(flags & LASER_FILTER_BOUNDS) {
+        plan->filter_min[0] = _laser_filter_quantize(filter->min_x, info->scale_x, info->offset_x, 1);
+        plan->filter_min[1] = _laser_filter_quantize(filter->min_y, info->scale_y, info->offset_y, 1);
+        plan->filter_min[2] = _laser_filter_quantize(filter->min_z, info->scale_z, info->offset_z, 1);
+        plan->filter_max[0] = _laser_filter_quantize(filter->max_x, info->scale_x, info->offset_x, 0);
+        plan->filter_max[1] = _laser_filter_quantize(filter->max_y, info->scale_y, info->offset_y, 0);
+        plan->filter_max[2] = _laser_filter_quantize(filter->max_z, info->scale_z, info->offset_z, 0);
+    }
+}
+
+void laser_plan_sample(laserPlan* plan, const laserFile* file, const laserSample* sample) {
+    const laserInfo* info = &file->info;
+    const double mins[3] = { info->min_x, info->min_y, info->min_z };
+    const float scales[3] = { info->scale_x, info->scale_y, info->scale_z };
+    const float offsets[3] = { info->offset_x, info->offset_y, info->offset_z };
+    laserSampleMode mode = sample ? sample->mode: LASER_SAMPLE_NONE;
+
+    plan->filter = (plan->filter & ~_LASER_PLAN_SAMPLE) | (mode != LASER_SAMPLE_NONE ? _LASER_PLAN_SAMPLE: 0);
+    plan->sample = mode;
+    plan->sample_every = mode == LASER_SAMPLE_EVERY && sample->every ? sample->every: 1;
+    plan->sample_seed = mode == LASER_SAMPLE_FRACTION ? _laser_mix_64(sample->seed): 0;
+    plan->sample_threshold = (uint64_t) 1 << 32;
+    if(mode == LASER_SAMPLE_FRACTION && sample->fraction < 1.0) {
+        plan->sample_threshold = sample->fraction > 0.0 ? (uint64_t) (sample->fraction * 4294967296.0): 0;
+    }
+
+    /* Voxel coordinates are a single multiply on the raw integers, relative to the header minimum. */
+    plan->voxels = mode == LASER_SAMPLE_VOXEL ? sample->voxels: 0;
+    for(uint32_t i = 0; i < 3; i++) {
+        plan->sample_min[i] = _laser_filter_quantize(mins[i], scales[i], offsets[i], 0);
+        plan->sample_scale[i] = mode == LASER_SAMPLE_VOXEL && sample->voxel_size > 0.0 ? scales[i] / sample->voxel_size: 0.0;
+    }
+    if(mode == LASER_SAMPLE_VOXEL && !plan->voxels) {
+        plan->filter &= ~_LASER_PLAN_SAMPLE;
+        plan->sample = LASER_SAMPLE_NONE;
+    }
+}
+
+laserResult laser_voxels_init(laserVoxels* voxels, void* mem, uint64_t size) {
+    uint64_t capacity = 4;
+    if(size / sizeof(uint64_t) < capacity) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    while(capacity * 2 <= size / sizeof(uint64_t)) {
+        capacity *= 2;
+    }
+    voxels->slots = (uint64_t*) mem;
+    voxels->capacity = capacity;
+    laser_voxels_reset(voxels);
+    return LASER_SUCCESS;
+}
+
+void laser_voxels_reset(laserVoxels* voxels) {
+    memset(voxels->slots, 0, voxels->capacity * sizeof(uint64_t));
+    voxels->count = 0;
+}
+
+laserResult laser_file_read_filtered(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count, uint64_t* matched) {
+    return _laser_read_filtered(file, plan, points, first, count, matched, 1);
+}
+
+laserResult laser_file_count_filtered(const laserFile* file, const laserPlan* plan, uint64_t first, uint64_t count, uint64_t* matched) {
+    return _laser_read_filtered(file, plan, 0, first, count, matched, 0);
+}
+
+static uint64_t* _laser_index_offsets(const laserIndex* index) {
+    return (uint64_t*) (index + 1);
+}
+
+static laserSpan* _laser_index_spans(const laserIndex* index) {
+    return (laserSpan*) (_laser_index_offsets(index) + (uint64_t) index->cells_x * index->cells_y + 1);
+}
+
+static uint64_t _laser_index_cell(const laserIndex* index, const uint8_t* raw_point) {
+    const int32_t* xyz = (const int32_t*) raw_point;
+    int64_t dx = (int64_t) xyz[0] - index->min_x;
+    int64_t dy = (int64_t) xyz[1] - index->min_y;
+    uint64_t x = dx < 0 ? 0: (uint64_t) dx / index->cell_size_x;
+    uint64_t y = dy < 0 ? 0: (uint64_t) dy / index->cell_size_y;
+    x = x >= index->cells_x ? index->cells_x - 1: x;
+    y = y >= index->cells_y ? index->cells_y - 1: y;
+    return y * index->cells_x + x;
+}
+
+typedef struct _laserIndexScan {
+    laserIndex* index;
+    uint64_t* offsets;
+    laserSpan* spans;
+    uint64_t point_size;
+    uint64_t cell;
+    uint64_t first;
+    uint64_t span_count;
+} _laserIndexScan;
+
+static void _laser_index_emit(_laserIndexScan* scan, uint64_t end) {
+    if(scan->spans) {
+        laserSpan* span = &scan->spans[scan->offsets[scan->cell + 1]++];
+        span->first = scan->first;
+        span->count = end - scan->first;
+    } else if(scan->offsets) {
+        scan->offsets[scan->cell + 1]++;
+    }
+    scan->span_count++;
+}
+
+static void _laser_scan_index(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count) {
+    _laserIndexScan* scan = (_laserIndexScan*) usr;
+    for(uint64_t i = 0; i < count; i++) {
+        uint64_t cell = _laser_index_cell(scan->index, raw_point);
+        if(cell != scan->cell) {
+            if(first + i) {
+                _laser_index_emit(scan, first + i);
+            }
+            scan->cell = cell;
+            scan->first = first + i;
+        }
+        raw_point += scan->point_size;
+    }
+}
+
+static void _laser_sort_spans(laserSpan* spans, uint64_t count) {
+    /* Heapsort, the spans of each cell are already sorted but the cells interleave arbitrarily. */
+    for(uint64_t end = count; end > 1;) {
+        if(end == count) {
+            for(uint64_t start = count / 2; start-- > 0;) {
+                for(uint64_t root = start, child; (child = 2 * root + 1) < count; root = child) {
+                    child += (child + 1 < count && spans[child + 1].first > spans[child].first);
+                    if(spans[root].first >= spans[child].first) {
+                        break;
+                    }
+                    laserSpan span = spans[root]; spans[root] = spans[child]; spans[child] = span;
+                }
+            }
+        }
+
+        end--;
+        laserSpan span = spans[0]; spans[0] = spans[end]; spans[end] = span;
+        for(uint64_t root = 0, child; (child = 2 * root + 1) < end; root = child) {
+            child += (child + 1 < end && spans[child + 1].first > spans[child].first);
+            if(spans[root].first >= spans[child].first) {
+                break;
+            }
+            span = spans[root]; spans[root] = spans[child]; spans[child] = span;
+        }
+    }
+}
+
+laserResult laser_index_build(laserIndex* index, uint64_t size, const laserFile* file, uint32_t cells_x, uint32_t cells_y, uint64_t* required) {
+    const laserInfo* info = &file->info;
+    laserIndex header;
+    cells_x = cells_x < 1 ? 1: cells_x;
+    cells_y = cells_y < 1 ? 1: cells_y;
+
+    uint64_t cell_count = (uint64_t) cells_x * cells_y;
+    uint64_t offsets_size = sizeof(laserIndex) + (cell_count + 1) * sizeof(uint64_t);
+    int32_t min_x = _laser_filter_quantize(info->min_x, info->scale_x, info->offset_x, 0);
+    int32_t min_y = _laser_filter_quantize(info->min_y, info->scale_y, info->offset_y, 0);
+    int32_t max_x = _laser_filter_quantize(info->max_x, info->scale_x, info->offset_x, 1);
+    int32_t max_y = _laser_filter_quantize(info->max_y, info->scale_y, info->offset_y, 1);
+    max_x = max_x < min_x ? min_x: max_x;
+    max_y = max_y < min_y ? min_y: max_y;
+
+    memcpy(header.magic, "LIDX", 4);
+    header.version = 1;
+    header.cells_x = cells_x;
+    header.cells_y = cells_y;
+    header.min_x = min_x;
+    header.min_y = min_y;
+    header.cell_size_x = ((uint64_t) ((int64_t) max_x - min_x) + cells_x) / cells_x;
+    header.cell_size_y = ((uint64_t) ((int64_t) max_y - min_y) + cells_y) / cells_y;
+    header.point_count = info->point_count;
+    header.span_count = 0;
+
+    /* First pass counts the spans per cell into `offsets[cell + 1]`, if there is room for the offsets. */
+    _laserIndexScan scan;
+    scan.index = &header;
+    scan.offsets = index && size >= offsets_size ? (uint64_t*) (index + 1): 0;
+    scan.spans = 0;
+    scan.point_size = info->point_size;
+    scan.cell = (uint64_t) -1;
+    scan.first = 0;
+    scan.span_count = 0;
+    if(scan.offsets) {
+        memset(scan.offsets, 0, (cell_count + 1) * sizeof(uint64_t));
+    }
+
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_scan_raw(file, 0, LASER_ALL_POINTS, _laser_scan_index, (void*) &scan)) != LASER_SUCCESS) {
+        return res;
+    }
+    if(info->point_count) {
+        _laser_index_emit(&scan, info->point_count);
+    }
+
+    *required = offsets_size + scan.span_count * sizeof(laserSpan);
+    if(!index || size < *required) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    /* Turn the counts into the first span of each cell, the second pass advances them to the first span of the next cell. */
+    uint64_t total = 0;
+    for(uint64_t i = 0; i < cell_count; i++) {
+        uint64_t span_count = scan.offsets[i + 1];
+        scan.offsets[i + 1] = total;
+        total += span_count;
+    }
+
+    header.span_count = scan.span_count;
+    *index = header;
+    scan.spans = _laser_index_spans(index);
+    scan.cell = (uint64_t) -1;
+    scan.first = 0;
+    scan.span_count = 0;
+    if((res = _laser_scan_raw(file, 0, LASER_ALL_POINTS, _laser_scan_index, (void*) &scan)) != LASER_SUCCESS) {
+        return res;
+    }
+    if(info->point_count) {
+        _laser_index_emit(&scan, info->point_count);
+    }
+    return LASER_SUCCESS;
+}
+
+laserResult laser_index_check(const laserIndex* index, uint64_t size, const laserFile* file) {
+    if(size < sizeof(laserIndex) || memcmp(index->magic, "LIDX", 4) != 0 || index->version != 1 || !index->cells_x || !index->cells_y) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    uint64_t cell_count = (uint64_t) index->cells_x * index->cells_y;
+    uint64_t offsets_size = sizeof(laserIndex) + (cell_count + 1) * sizeof(uint64_t);
+    if(size < offsets_size || (size - offsets_size) / sizeof(laserSpan) < index->span_count) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    const uint64_t* offsets = _laser_index_offsets(index);
+    if(offsets[0] != 0 || offsets[cell_count] != index->span_count || index->point_count != file->info.point_count) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+    for(uint64_t i = 0; i < cell_count; i++) {
+        if(offsets[i] > offsets[i + 1]) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+    }
+    return LASER_SUCCESS;
+}
+
+laserResult laser_index_query(const laserIndex* index, const laserFile* file, const laserFilter* filter, uint64_t gap, laserSpan* spans, uint64_t capacity, uint64_t* span_count) {
+    const laserInfo* info = &file->info;
+    uint64_t min_cell_x = 0;
+    uint64_t min_cell_y = 0;
+    uint64_t max_cell_x = index->cells_x - 1;
+    uint64_t max_cell_y = index->cells_y - 1;
+
+    *span_count = 0;
+    if(filter && (filter->flags & LASER_FILTER_BOUNDS)) {
+        int64_t min_x = (int64_t) _laser_filter_quantize(filter->min_x, info->scale_x, info->offset_x, 1) - index->min_x;
+        int64_t min_y = (int64_t) _laser_filter_quantize(filter->min_y, info->scale_y, info->offset_y, 1) - index->min_y;
+        int64_t max_x = (int64_t) _laser_filter_quantize(filter->max_x, info->scale_x, info->offset_x, 0) - index->min_x;
+        int64_t max_y = (int64_t) _laser_filter_quantize(filter->max_y, info->scale_y, info->offset_y, 0) - index->min_y;
+        if(max_x < min_x || max_y < min_y) {
+            return LASER_SUCCESS;
+        }
+
+        /* Points outside the header bounds live in the border cells, so the query is clamped the same way. */
+        min_cell_x = min_x < 0 ? 0: (uint64_t) min_x / index->cell_size_x;
+        min_cell_y = min_y < 0 ? 0: (uint64_t) min_y / index->cell_size_y;
+        max_cell_x = max_x < 0 ? 0: (uint64_t) max_x / index->cell_size_x;
+        max_cell_y = max_y < 0 ? 0: (uint64_t) max_y / index->cell_size_y;
+        min_cell_x = min_cell_x >= index->cells_x ? index->cells_x - 1: min_cell_x;
+        min_cell_y = min_cell_y >= index->cells_y ? index->cells_y - 1: min_cell_y;
+        max_cell_x = max_cell_x >= index->cells_x ? index->cells_x - 1: max_cell_x;
+        max_cell_y = max_cell_y >= index->cells_y ? index->cells_y - 1: max_cell_y;
+    }
+
+    const uint64_t* offsets = _laser_index_offsets(index);
+    const laserSpan* cell_spans = _laser_index_spans(index);
+    uint64_t count = 0;
+    for(uint64_t y = min_cell_y; y <= max_cell_y; y++) {
+        uint64_t row = y * index->cells_x;
+        count += offsets[row + max_cell_x + 1] - offsets[row + min_cell_x];
+    }
+    if(count > capacity) {
+        *span_count = count;
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    count = 0;
+    for(uint64_t y = min_cell_y; y <= max_cell_y; y++) {
+        uint64_t row = y * index->cells_x;
+        uint64_t first = offsets[row + min_cell_x];
+        uint64_t last = offsets[row + max_cell_x + 1];
+        memcpy(spans + count, cell_spans + first, (last - first) * sizeof(laserSpan));
+        count += last - first;
+    }
+    _laser_sort_spans(spans, count);
+
+    uint64_t coalesced = 0;
+    for(uint64_t i = 0; i < count; i++) {
+        laserSpan* span = &spans[coalesced - (coalesced > 0)];
+        if(coalesced && spans[i].first <= span->first + span->count + gap) {
+            uint64_t end = spans[i].first + spans[i].count;
+            span->count = end > span->first + span->count ? end - span->first: span->count;
+        } else {
+            spans[coalesced++] = spans[i];
+        }
+    }
+    *span_count = coalesced;
+    return LASER_SUCCESS;
+}
+
+laserResult laser_file_read_range(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count) {
+    if(plan->filter) {
+        return LASER_ERROR_FILTERED_PLAN;
+    } else if(file->info.compressed) {
+        return _laser_read_attribs_from_laz(file, 0, plan, points, 0, first, count, plan->stats);
+    } else if(file->mem) {
+        return _laser_read_attribs_from_mem(points, 0, plan, &file->info, ((uint8_t*) file->mem) + file->info.point_offset, _laser_points_size(file), first, count);
+    }
+    return _laser_read_attribs_from_io(file, plan, points, first, count);
+}
+
+laserResult laser_read_range_from_mem_with_attribs(void* points, uint64_t stride, laserAttrib* attribs, void* mem, uint64_t size, uint64_t first, uint64_t count) {
+    laserFile file;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_open_from_mem(&file, mem, size)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    laser_plan_attribs(&plan, &file, attribs, stride);
+    return laser_file_read_range(&file, &plan, points, first, count);
+}
+
+laserResult laser_read_range_from_io_with_attribs(void* points, uint64_t stride, laserAttrib* attribs, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count) {
+    laserFile file;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_open_from_io(&file, fn, usr)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    laser_plan_attribs(&plan, &file, attribs, stride);
+    return laser_file_read_range(&file, &plan, points, first, count);
+}
+
+laserResult laser_read_range_from_mem_columns(laserColumn* columns, void* mem, uint64_t size, uint64_t first, uint64_t count) {
+    laserFile file;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_open_from_mem(&file, mem, size)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    laser_plan_columns(&plan, &file, columns);
+    return laser_file_read_range(&file, &plan, 0, first, count);
+}
+
+laserResult laser_read_range_from_io_columns(laserColumn* columns, laserIoReadFn fn, void* usr, uint64_t first, uint64_t count) {
+    laserFile file;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_open_from_io(&file, fn, usr)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    laser_plan_columns(&plan, &file, columns);
+    return laser_file_read_range(&file, &plan, 0, first, count);
+}
+
+typedef struct _laserTask {
+    const laserPlan* plan;
+    void* points;
+    void* raw_points;
+    uint64_t index;
+    uint64_t first;
+    uint64_t count;
+    laserStats* stats;
+} _laserTask;
+
+static void _laser_run_task(void* arg) {
+    _laserTask* task = (_laserTask*) arg;
+    const uint8_t* raw_point = ((const uint8_t*) task->raw_points) + task->first * task->plan->point_size;
+    _laser_decode_range(task->points, task->index, task->plan, raw_point, task->count, task->stats);
+}
+
+static laserResult _laser_read_attribs_parallel(void* points, const laserPlan* plan, const laserInfo* info, void* raw_points, uint64_t size, uint64_t first, uint64_t count, laserScheduler* scheduler) {
+    count = count == LASER_ALL_POINTS ? info->point_count: count;
+    if(first > info->point_count || count > info->point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    } else if(count && (!plan->point_size || first > size / plan->point_size || count > size / plan->point_size - first)) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    /* Chunks are whole decode blocks so every task runs the same kernels as a serial read would. */
+    uint64_t block_count = (count + LASER_DECODE_BLOCK_SIZE - 1) / LASER_DECODE_BLOCK_SIZE;
+    uint64_t task_count = scheduler->task_count > LASER_MAX_TASKS ? LASER_MAX_TASKS: scheduler->task_count;
+    task_count = task_count > block_count ? block_count: task_count;
+    task_count = plan->stats && task_count > plan->stats_count ? plan->stats_count: task_count;
+    if(task_count <= 1) {
+        return _laser_read_attribs_from_mem(points, 0, plan, info, raw_points, size, first, count);
+    }
+
+    _laserTask tasks[LASER_MAX_TASKS];
+    uint64_t chunk = ((block_count + task_count - 1) / task_count) * LASER_DECODE_BLOCK_SIZE;
+    uint64_t task_first = 0;
+    uint32_t submitted = 0;
+    for(; submitted < task_count && task_first < count; submitted++) {
+        _laserTask* task = &tasks[submitted];
+        task->plan = plan;
+        task->points = points;
+        task->raw_points = raw_points;
+        task->index = task_first;
+        task->first = first + task_first;
+        task->count = (count - task_first) < chunk ? (count - task_first): chunk;
+        task->stats = plan->stats ? &plan->stats[submitted]: 0;
+        if(task->stats && submitted) {
+            laser_stats_init(task->stats);
+        }
+        scheduler->submit(scheduler->usr, _laser_run_task, task);
+        task_first += task->count;
+    }
+    scheduler->wait(scheduler->usr);
+
+    for(uint32_t i = 1; i < submitted && plan->stats; i++) {
+        laser_stats_merge(&plan->stats[0], &plan->stats[i]);
+    }
+    return LASER_SUCCESS;
+}
+
+void laser_plan_stats(laserPlan* plan, laserStats* stats, uint32_t stats_count) {
+    plan->stats = stats_count ? stats: 0;
+    plan->stats_count = stats_count;
+}
+
+void laser_stats_init(laserStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->min_x = INT32_MAX;
+    stats->min_y = INT32_MAX;
+    stats->min_z = INT32_MAX;
+    stats->max_x = INT32_MIN;
+    stats->max_y = INT32_MIN;
+    stats->max_z = INT32_MIN;
+    stats->intensity_min = UINT16_MAX;
+}
+
+void laser_stats_merge(laserStats* stats, const laserStats* other) {
+    stats->point_count += other->point_count;
+    stats->min_x = other->min_x < stats->min_x ? other->min_x: stats->min_x;
+    stats->min_y = other->min_y < stats->min_y ? other->min_y: stats->min_y;
+    stats->min_z = other->min_z < stats->min_z ? other->min_z: stats->min_z;
+    stats->max_x = other->max_x > stats->max_x ? other->max_x: stats->max_x;
+    stats->max_y = other->max_y > stats->max_y ? other->max_y: stats->max_y;
+    stats->max_z = other->max_z > stats->max_z ? other->max_z: stats->max_z;
+    for(uint32_t i = 0; i < 16; i++) {
+        stats->return_counts[i] += other->return_counts[i];
+    }
+    for(uint32_t i = 0; i < 256; i++) {
+        stats->classification_counts[i] += other->classification_counts[i];
+    }
+    stats->intensity_min = other->intensity_min < stats->intensity_min ? other->intensity_min: stats->intensity_min;
+    stats->intensity_max = other->intensity_max > stats->intensity_max ? other->intensity_max: stats->intensity_max;
+    stats->intensity_sum += other->intensity_sum;
+}
+
+void laser_stats_apply(const laserStats* stats, laserInfo* info) {
+    if(!stats->point_count) {
+        return;
+    }
+    info->min_x = (float) ((double) stats->min_x * info->scale_x + info->offset_x);
+    info->min_y = (float) ((double) stats->min_y * info->scale_y + info->offset_y);
+    info->min_z = (float) ((double) stats->min_z * info->scale_z + info->offset_z);
+    info->max_x = (float) ((double) stats->max_x * info->scale_x + info->offset_x);
+    info->max_y = (float) ((double) stats->max_y * info->scale_y + info->offset_y);
+    info->max_z = (float) ((double) stats->max_z * info->scale_z + info->offset_z);
+}
+
+typedef struct _laserLazTask {
+    const laserFile* file;
+    const laserPlan* plan;
+    void* points;
+    uint64_t index;
+    uint64_t first;
+    uint64_t count;
+    laserStats* stats;
+    uint32_t decoder;
+    laserResult res;
+} _laserLazTask;
+
+static void _laser_run_laz_task(void* arg) {
+    _laserLazTask* task = (_laserLazTask*) arg;
+    task->res = _laser_read_attribs_from_laz(task->file, task->decoder, task->plan, task->points, task->index, task->first, task->count, task->stats);
+}
+
+static laserResult _laser_read_attribs_laz_parallel(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count, laserScheduler* scheduler) {
+    const laserLaz* laz = &file->laz;
+    count = count == LASER_ALL_POINTS ? file->info.point_count: count;
+    if(first > file->info.point_count || count > file->info.point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    }
+
+    /* Tasks own whole chunks (the first and last may be partial) so no chunk is ever decoded twice. */
+    uint64_t first_chunk = count ? _laser_laz_chunk(laz, first): 0;
+    uint64_t chunk_count = count ? _laser_laz_chunk(laz, first + count - 1) - first_chunk + 1: 0;
+    uint64_t task_count = scheduler->task_count > LASER_MAX_TASKS ? LASER_MAX_TASKS: scheduler->task_count;
+    task_count = task_count > laz->decoder_count ? laz->decoder_count: task_count;
+    task_count = task_count > chunk_count ? chunk_count: task_count;
+    task_count = plan->stats && task_count > plan->stats_count ? plan->stats_count: task_count;
+    if(task_count <= 1) {
+        return _laser_read_attribs_from_laz(file, 0, plan, points, 0, first, count, plan->stats);
+    }
+
+    _laserLazTask tasks[LASER_MAX_TASKS];
+    uint64_t chunks_per_task = (chunk_count + task_count - 1) / task_count;
+    uint64_t task_first = first;
+    uint32_t submitted = 0;
+    for(; submitted < task_count && task_first < first + count; submitted++) {
+        uint64_t end_chunk = first_chunk + (submitted + 1) * chunks_per_task;
+        uint64_t end = end_chunk < laz->chunk_count ? laz->chunk_points[end_chunk]: file->info.point_count;
+        end = end < first + count ? end: first + count;
+
+        _laserLazTask* task = &tasks[submitted];
+        task->file = file;
+        task->plan = plan;
+        task->points = points;
+        task->index = task_first - first;
+        task->first = task_first;
+        task->count = end - task_first;
+        task->stats = plan->stats ? &plan->stats[submitted]: 0;
+        task->decoder = submitted;
+        task->res = LASER_SUCCESS;
+        if(task->stats && submitted) {
+            laser_stats_init(task->stats);
+        }
+        scheduler->submit(scheduler->usr, _laser_run_laz_task, task);
+        task_first = end;
+    }
+    scheduler->wait(scheduler->usr);
+
+    laserResult res = LASER_SUCCESS;
+    for(uint32_t i = 0; i < submitted; i++) {
+        if(i && plan->stats) {
+            laser_stats_merge(&plan->stats[0], &plan->stats[i]);
+        }
+        res = res == LASER_SUCCESS ? tasks[i].res: res;
+    }
+    return res;
+}
+
+laserResult laser_file_read_range_parallel(const laserFile* file, const laserPlan* plan, void* points, uint64_t first, uint64_t count, laserScheduler* scheduler) {
+    if(plan->filter) {
+        return LASER_ERROR_FILTERED_PLAN;
+    } else if(file->info.compressed) {
+        return _laser_read_attribs_laz_parallel(file, plan, points, first, count, scheduler);
+    } else if(!file->mem) {
+        return laser_file_read_range(file, plan, points, first, count);
+    }
+    return _laser_read_attribs_parallel(points, plan, &file->info, ((uint8_t*) file->mem) + file->info.point_offset, _laser_points_size(file), first, count, scheduler);
+}
+
+laserResult laser_read_range_from_mem_with_attribs_parallel(void* points, uint64_t stride, laserAttrib* attribs, void* mem, uint64_t size, uint64_t first, uint64_t count, laserScheduler* scheduler) {
+    laserFile file;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_open_from_mem(&file, mem, size)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    laser_plan_attribs(&plan, &file, attribs, stride);
+    return laser_file_read_range_parallel(&file, &plan, points, first, count, scheduler);
+}
+
+laserResult laser_read_range_from_mem_columns_parallel(laserColumn* columns, void* mem, uint64_t size, uint64_t first, uint64_t count, laserScheduler* scheduler) {
+    laserFile file;
+    laserResult res = LASER_SUCCESS;
+    if((res = laser_open_from_mem(&file, mem, size)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    laser_plan_columns(&plan, &file, columns);
+    return laser_file_read_range_parallel(&file, &plan, 0, first, count, scheduler);
+}
+
+static double _laser_catalog_widen(float value, int up) {
+    /* `laserInfo` rounds the header bounds to float, widen by one ulp so pruning never drops a tile at its border. */
+    double ulp = (double) (value < 0 ? -value: value) * (1.0 / 8388608.0);
+    return up ? (double) value + ulp: (double) value - ulp;
+}
+
+laserResult laser_catalog_begin(laserCatalog* catalog, void* mem, uint64_t size, uint32_t capacity) {
+    if(size < sizeof(laserCatalogHeader) + (uint64_t) capacity * sizeof(laserCatalogEntry)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    catalog->mem = (uint8_t*) mem;
+    catalog->size = size;
+    catalog->capacity = capacity;
+    catalog->entry_count = 0;
+    catalog->names_size = 0;
+    catalog->entries = (laserCatalogEntry*) (catalog->mem + sizeof(laserCatalogHeader));
+    catalog->names = (char*) (catalog->entries + capacity);
+    return LASER_SUCCESS;
+}
+
+static void _laser_catalog_fill(laserCatalogEntry* entry, const laserInfo* info) {
+    entry->point_count = info->point_count;
+    entry->point_format = info->point_format;
+    entry->point_size = info->point_size;
+    entry->point_offset = info->point_offset;
+    entry->min_x = _laser_catalog_widen(info->min_x, 0);
+    entry->min_y = _laser_catalog_widen(info->min_y, 0);
+    entry->min_z = _laser_catalog_widen(info->min_z, 0);
+    entry->max_x = _laser_catalog_widen(info->max_x, 1);
+    entry->max_y = _laser_catalog_widen(info->max_y, 1);
+    entry->max_z = _laser_catalog_widen(info->max_z, 1);
+}
+
+laserResult laser_catalog_add(laserCatalog* catalog, const char* name, const laserInfo* info) {
+    uint64_t name_size = strlen(name);
+    uint64_t used = (uint64_t) (((uint8_t*) catalog->names) - catalog->mem) + catalog->names_size;
+    if(catalog->entry_count >= catalog->capacity || catalog->size - used < name_size + 1) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    laserCatalogEntry* entry = &catalog->entries[catalog->entry_count++];
+    entry->name_offset = catalog->names_size;
+    entry->name_size = (uint32_t) name_size;
+    _laser_catalog_fill(entry, info);
+    memcpy(catalog->names + catalog->names_size, name, name_size + 1);
+    catalog->names_size += name_size + 1;
+    return LASER_SUCCESS;
+}
+
+laserResult laser_catalog_finish(laserCatalog* catalog, uint64_t* size) {
+    char* names = (char*) (catalog->entries + catalog->entry_count);
+    memmove(names, catalog->names, catalog->names_size);
+    catalog->names = names;
+    catalog->capacity = catalog->entry_count;
+
+    laserCatalogHeader* header = (laserCatalogHeader*) catalog->mem;
+    memcpy(header->magic, "LCAT", 4);
+    header->version = 1;
+    header->entry_count = catalog->entry_count;
+    header->_ = 0;
+    header->names_size = catalog->names_size;
+    *size = (uint64_t) (((uint8_t*) names) - catalog->mem) + catalog->names_size;
+    return LASER_SUCCESS;
+}
+
+laserResult laser_catalog_load(laserCatalog* catalog, void* mem, uint64_t size) {
+    const laserCatalogHeader* header = (const laserCatalogHeader*) mem;
+    if(size < sizeof(laserCatalogHeader) || memcmp(header->magic, "LCAT", 4) != 0 || header->version != 1) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    uint64_t entries_size = (uint64_t) header->entry_count * sizeof(laserCatalogEntry);
+    if(size - sizeof(laserCatalogHeader) < entries_size || size - sizeof(laserCatalogHeader) - entries_size < header->names_size) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    catalog->mem = (uint8_t*) mem;
+    catalog->size = size;
+    catalog->capacity = header->entry_count;
+    catalog->entry_count = header->entry_count;
+    catalog->names_size = header->names_size;
+    catalog->entries = (laserCatalogEntry*) (catalog->mem + sizeof(laserCatalogHeader));
+    catalog->names = (char*) (catalog->entries + catalog->entry_count);
+    for(uint32_t i = 0; i < catalog->entry_count; i++) {
+        const laserCatalogEntry* entry = &catalog->entries[i];
+        if(entry->name_offset >= catalog->names_size || catalog->names_size - entry->name_offset <= entry->name_size || catalog->names[entry->name_offset + entry->name_size] != 0) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+    }
+    return LASER_SUCCESS;
+}
+
+const char* laser_catalog_name(const laserCatalog* catalog, uint32_t tile) {
+    return catalog->names + catalog->entries[tile].name_offset;
+}
+
+laserResult laser_catalog_query(const laserCatalog* catalog, const laserFilter* filter, uint32_t* tiles, uint32_t capacity, uint32_t* tile_count) {
+    int bounds = filter && (filter->flags & LASER_FILTER_BOUNDS);
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < catalog->entry_count; i++) {
+        const laserCatalogEntry* entry = &catalog->entries[i];
+        if(bounds && (
+                entry->max_x < filter->min_x || entry->min_x > filter->max_x ||
+                entry->max_y < filter->min_y || entry->min_y > filter->max_y ||
+                entry->max_z < filter->min_z || entry->min_z > filter->max_z)) {
+            continue;
+        }
+
+        if(count < capacity) {
+            tiles[count] = i;
+        }
+        count++;
+    }
+
+    *tile_count = count;
+    return count > capacity ? LASER_ERROR_BUFFER_TOO_SMALL: LASER_SUCCESS;
+}
+
+typedef struct _laserCatalogTask {
+    const laserCatalog* catalog;
+    const uint32_t* tiles;
+    uint32_t first;
+    uint32_t count;
+    laserCatalogFn fn;
+    void* usr;
+} _laserCatalogTask;
+
+static void _laser_run_catalog_task(void* arg) {
+    _laserCatalogTask* task = (_laserCatalogTask*) arg;
+    for(uint32_t i = task->first; i < task->first + task->count; i++) {
+        task->fn(task->usr, task->catalog, task->tiles ? task->tiles[i]: i);
+    }
+}
+
+void laser_catalog_for_each(const laserCatalog* catalog, const uint32_t* tiles, uint32_t tile_count, laserCatalogFn fn, void* usr, laserScheduler* scheduler) {
+    tile_count = tiles ? tile_count: catalog->entry_count;
+
+    uint32_t task_count = scheduler ? scheduler->task_count: 1;
+    task_count = task_count > LASER_MAX_TASKS ? LASER_MAX_TASKS: task_count;
+    task_count = task_count > tile_count ? tile_count: task_count;
+
+    _laserCatalogTask tasks[LASER_MAX_TASKS];
+    uint32_t chunk = task_count ? (tile_count + task_count - 1) / task_count: 0;
+    uint32_t submitted = 0;
+    for(uint32_t first = 0; first < tile_count; first += chunk, submitted++) {
+        _laserCatalogTask* task = &tasks[submitted];
+        task->catalog = catalog;
+        task->tiles = tiles;
+        task->first = first;
+        task->count = (tile_count - first) < chunk ? (tile_count - first): chunk;
+        task->fn = fn;
+        task->usr = usr;
+        if(task_count > 1) {
+            scheduler->submit(scheduler->usr, _laser_run_catalog_task, task);
+        } else {
+            _laser_run_catalog_task(task);
+        }
+    }
+
+    if(task_count > 1) {
+        scheduler->wait(scheduler->usr);
+    }
+}
+
+static uint64_t _laser_spread_bits_3(uint64_t v) {
+    v &= 0x1FFFFF;
+    v = (v | (v << 32)) & 0x1F00000000FFFFull;
+    v = (v | (v << 16)) & 0x1F0000FF0000FFull;
+    v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+    v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+static uint64_t _laser_spread_bits_2(uint64_t v) {
+    v &= 0xFFFFFFFF;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+/*
+ *  Skilling, "Programming the Hilbert curve": the axes are turned into the transposed Hilbert index in place, which
+ *  interleaves into the key like a Morton code. Inverting or exchanging the low bits is done without branching.
+ */
+#define _LASER_HILBERT_STEP(a, b, q, p) \
+    do { \
+        uint32_t set = 0u - (((b) & (q)) != 0); \
+        uint32_t t = ((a) ^ (b)) & (p) & ~set; \
+        (a) ^= ((p) & set) | t; \
+        (b) ^= t; \
+    } while(0)
+
+static uint64_t _laser_hilbert_3(uint32_t x, uint32_t y, uint32_t z) {
+    for(uint32_t q = 1u << 20; q > 1; q >>= 1) {
+        uint32_t p = q - 1;
+        x ^= p & (0u - ((x & q) != 0));
+        _LASER_HILBERT_STEP(x, y, q, p);
+        _LASER_HILBERT_STEP(x, z, q, p);
+    }
+
+    y ^= x;
+    z ^= y;
+    uint32_t t = 0;
+    for(uint32_t q = 1u << 20; q > 1; q >>= 1) {
+        t ^= (q - 1) & (0u - ((z & q) != 0));
+    }
+    return (_laser_spread_bits_3(x ^ t) << 2) | (_laser_spread_bits_3(y ^ t) << 1) | _laser_spread_bits_3(z ^ t);
+}
+
+static uint64_t _laser_hilbert_2(uint32_t x, uint32_t y) {
+    for(uint32_t q = 1u << 31; q > 1; q >>= 1) {
+        uint32_t p = q - 1;
+        x ^= p & (0u - ((x & q) != 0));
+        _LASER_HILBERT_STEP(x, y, q, p);
+    }
+
+    y ^= x;
+    uint32_t t = 0;
+    for(uint32_t q = 1u << 31; q > 1; q >>= 1) {
+        t ^= (q - 1) & (0u - ((y & q) != 0));
+    }
+    return (_laser_spread_bits_2(x ^ t) << 1) | _laser_spread_bits_2(y ^ t);
+}
+
+typedef struct _laserCurveScan {
+    laserCurve curve;
+    uint64_t point_size;
+    int64_t min[3];
+    uint64_t extent[3];
+    uint32_t shift[3];
+    uint64_t* keys;
+    uint64_t* indices;
+    uint64_t index;
+} _laserCurveScan;
+
+static void _laser_scan_curve(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count) {
+    _laserCurveScan* scan = (_laserCurveScan*) usr;
+    uint32_t dims = scan->curve == LASER_CURVE_MORTON || scan->curve == LASER_CURVE_HILBERT ? 3: 2;
+    for(uint64_t i = 0; i < count; i++) {
+        const int32_t* xyz = (const int32_t*) raw_point;
+        uint32_t axes[3];
+        for(uint32_t d = 0; d < dims; d++) {
+            int64_t v = (int64_t) xyz[d] - scan->min[d];
+            v = v < 0 ? 0: ((uint64_t) v > scan->extent[d] ? (int64_t) scan->extent[d]: v);
+            axes[d] = (uint32_t) ((uint64_t) v >> scan->shift[d]);
+        }
+
+        uint64_t key = 0;
+        switch(scan->curve) {
+            case LASER_CURVE_MORTON:
+                key = _laser_spread_bits_3(axes[0]) | (_laser_spread_bits_3(axes[1]) << 1) | (_laser_spread_bits_3(axes[2]) << 2);
+                break;
+            case LASER_CURVE_HILBERT:
+                key = _laser_hilbert_3(axes[0], axes[1], axes[2]);
+                break;
+            case LASER_CURVE_MORTON_XY:
+                key = _laser_spread_bits_2(axes[0]) | (_laser_spread_bits_2(axes[1]) << 1);
+                break;
+            case LASER_CURVE_HILBERT_XY:
+                key = _laser_hilbert_2(axes[0], axes[1]);
+                break;
+        }
+
+        scan->keys[scan->index] = key;
+        scan->indices[scan->index] = first + i;
+        scan->index++;
+        raw_point += scan->point_size;
+    }
+}
+
+laserResult laser_file_curve_keys(const laserFile* file, laserCurve curve, uint64_t first, uint64_t count, uint64_t* keys, uint64_t* indices) {
+    const laserInfo* info = &file->info;
+    const float mins[3] = { info->min_x, info->min_y, info->min_z };
+    const float maxs[3] = { info->max_x, info->max_y, info->max_z };
+    const float scales[3] = { info->scale_x, info->scale_y, info->scale_z };
+    const float offsets[3] = { info->offset_x, info->offset_y, info->offset_z };
+    uint32_t bits = curve == LASER_CURVE_MORTON || curve == LASER_CURVE_HILBERT ? 21: 32;
+
+    /* The header bounds define the grid, each axis is shifted down until its extent fits the bits of the curve. */
+    _laserCurveScan scan;
+    scan.curve = curve;
+    scan.point_size = info->point_size;
+    for(uint32_t d = 0; d < 3; d++) {
+        int32_t min = _laser_filter_quantize(mins[d], scales[d], offsets[d], 0);
+        int32_t max = _laser_filter_quantize(maxs[d], scales[d], offsets[d], 1);
+        scan.min[d] = min;
+        scan.extent[d] = max > min ? (uint64_t) ((int64_t) max - min): 0;
+        scan.shift[d] = 0;
+        while((scan.extent[d] >> scan.shift[d]) >= ((uint64_t) 1 << bits)) {
+            scan.shift[d]++;
+        }
+    }
+    scan.keys = keys;
+    scan.indices = indices;
+    scan.index = 0;
+    return _laser_scan_raw(file, first, count, _laser_scan_curve, (void*) &scan);
+}
+
+typedef struct _laserSortTask {
+    const uint64_t* keys;
+    const uint64_t* indices;
+    uint64_t* out_keys;
+    uint64_t* out_indices;
+    uint64_t first;
+    uint64_t count;
+    uint32_t shift;
+    uint64_t* histogram;
+} _laserSortTask;
+
+static void _laser_run_sort_histogram(void* arg) {
+    _laserSortTask* task = (_laserSortTask*) arg;
+    uint64_t* histogram = task->histogram;
+    memset(histogram, 0, 256 * sizeof(uint64_t));
+    for(uint64_t i = task->first; i < task->first + task->count; i++) {
+        histogram[(task->keys[i] >> task->shift) & 0xFF]++;
+    }
+}
+
+static void _laser_run_sort_scatter(void* arg) {
+    _laserSortTask* task = (_laserSortTask*) arg;
+    uint64_t* offsets = task->histogram;
+    for(uint64_t i = task->first; i < task->first + task->count; i++) {
+        uint64_t key = task->keys[i];
+        uint64_t target = offsets[(key >> task->shift) & 0xFF]++;
+        task->out_keys[target] = key;
+        task->out_indices[target] = task->indices[i];
+    }
+}
+
+static uint32_t _laser_sort_task_count(uint64_t count, const laserScheduler* scheduler) {
+    uint64_t task_count = scheduler ? scheduler->task_count: 1;
+    task_count = task_count > LASER_MAX_TASKS ? LASER_MAX_TASKS: task_count;
+    task_count = task_count > (count / 65536) ? (count / 65536): task_count;
+    return task_count < 1 ? 1: (uint32_t) task_count;
+}
+
+uint64_t laser_sort_scratch_size(uint64_t count, const laserScheduler* scheduler) {
+    return count * 2 * sizeof(uint64_t) + (uint64_t) _laser_sort_task_count(count, scheduler) * 256 * sizeof(uint64_t);
+}
+
+laserResult laser_sort_keys(uint64_t* keys, uint64_t* indices, uint64_t count, void* scratch, uint64_t scratch_size, laserScheduler* scheduler) {
+    uint32_t task_count = _laser_sort_task_count(count, scheduler);
+    if(scratch_size < laser_sort_scratch_size(count, scheduler)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    uint64_t* buffers[2][2] = { { keys, indices }, { (uint64_t*) scratch, ((uint64_t*) scratch) + count } };
+    uint64_t* histograms = ((uint64_t*) scratch) + 2 * count;
+    uint64_t all_bits = 0;
+    uint64_t any_bits = ~(uint64_t) 0;
+    for(uint64_t i = 0; i < count; i++) {
+        all_bits |= keys[i];
+        any_bits &= keys[i];
+    }
+
+    _laserSortTask tasks[LASER_MAX_TASKS];
+    uint64_t chunk = (count + task_count - 1) / task_count;
+    uint32_t current = 0;
+    for(uint32_t shift = 0; shift < 64; shift += 8) {
+        /* Digits where every key agrees don't reorder anything. */
+        if((((all_bits ^ any_bits) >> shift) & 0xFF) == 0) {
+            continue;
+        }
+
+        for(uint32_t t = 0; t < task_count; t++) {
+            _laserSortTask* task = &tasks[t];
+            task->keys = buffers[current][0];
+            task->indices = buffers[current][1];
+            task->out_keys = buffers[current ^ 1][0];
+            task->out_indices = buffers[current ^ 1][1];
+            task->first = (uint64_t) t * chunk;
+            task->first = task->first > count ? count: task->first;
+            task->count = (count - task->first) < chunk ? (count - task->first): chunk;
+            task->shift = shift;
+            task->histogram = histograms + (uint64_t) t * 256;
+            if(task_count > 1) {
+                scheduler->submit(scheduler->usr, _laser_run_sort_histogram, task);
+            } else {
+                _laser_run_sort_histogram(task);
+            }
+        }
+        if(task_count > 1) {
+            scheduler->wait(scheduler->usr);
+        }
+
+        /* Digit-major, task-minor prefix sum keeps the scatter stable. */
+        uint64_t offset = 0;
+        for(uint32_t digit = 0; digit < 256; digit++) {
+            for(uint32_t t = 0; t < task_count; t++) {
+                uint64_t digit_count = tasks[t].histogram[digit];
+                tasks[t].histogram[digit] = offset;
+                offset += digit_count;
+            }
+        }
+
+        for(uint32_t t = 0; t < task_count; t++) {
+            if(task_count > 1) {
+                scheduler->submit(scheduler->usr, _laser_run_sort_scatter, &tasks[t]);
+            } else {
+                _laser_run_sort_scatter(&tasks[t]);
+            }
+        }
+        if(task_count > 1) {
+            scheduler->wait(scheduler->usr);
+        }
+        current ^= 1;
+    }
+
+    if(current) {
+        memcpy(keys, buffers[1][0], count * sizeof(uint64_t));
+        memcpy(indices, buffers[1][1], count * sizeof(uint64_t));
+    }
+    return LASER_SUCCESS;
+}
+
+laserResult laser_file_read_indices(const laserFile* file, const laserPlan* plan, void* points, const uint64_t* indices, uint64_t count) {
+    uint8_t point_buffer[LASER_IO_BUFFER_SIZE];
+    uint8_t run_buffer[LASER_IO_BUFFER_SIZE];
+    const laserInfo* info = &file->info;
+    uint64_t max_run = sizeof(run_buffer) / info->point_size;
+    uint64_t max_point_count = sizeof(point_buffer) / info->point_size;
+    max_point_count = max_point_count > LASER_DECODE_BLOCK_SIZE ? LASER_DECODE_BLOCK_SIZE: max_point_count;
+    if(plan->filter) {
+        return LASER_ERROR_FILTERED_PLAN;
+    } else if(count && !max_point_count) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    } else if(info->compressed && count && !file->laz.decoder_count) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    /* Going back within a chunk or to an earlier one restarts it, any unsorted order would decompress in quadratic time. */
+    for(uint64_t i = 1; info->compressed && i < count; i++) {
+        if(indices[i] < indices[i - 1]) {
+            return LASER_ERROR_INVALID_RANGE;
+        }
+    }
+
+    /*
+     *  Records are gathered into a block first so the plan runs its regular block kernels. IO files read each run of
+     *  ascending indices within `max_run` records with a single call, adjacent ones straight into the block, others
+     *  through `run_buffer`.
+     */
+    for(uint64_t index = 0; index < count;) {
+        uint64_t block = (count - index) < max_point_count ? (count - index): max_point_count;
+        for(uint64_t i = 0; i < block;) {
+            uint64_t point = indices[index + i];
+            uint64_t offset = info->point_offset + point * info->point_size;
+            uint8_t* record = point_buffer + i * info->point_size;
+            laserResult res = LASER_SUCCESS;
+            if(point >= info->point_count) {
+                return LASER_ERROR_INVALID_RANGE;
+            } else if(info->compressed) {
+                if((res = _laser_laz_decode(file, _laser_laz_decoder(file, 0), record, point, 1)) != LASER_SUCCESS) {
+                    return res;
+                }
+                i++;
+                continue;
+            } else if(file->mem) {
+                memcpy(record, ((const uint8_t*) file->mem) + offset, info->point_size);
+                i++;
+                continue;
+            }
+
+            uint64_t run = 1;
+            uint32_t adjacent = 1;
+            for(; i + run < block; run++) {
+                uint64_t next = indices[index + i + run];
+                if(next < indices[index + i + run - 1] || next >= info->point_count || next - point >= max_run) {
+                    break;
+                }
+                adjacent &= next == indices[index + i + run - 1] + 1;
+            }
+
+            uint64_t size = (indices[index + i + run - 1] - point + 1) * info->point_size;
+            if(_LASER_IO(file->fn, file->usr, adjacent ? record: run_buffer, size, offset) != size) {
+                return LASER_ERROR_IO_READ;
+            }
+            for(uint64_t j = 0; !adjacent && j < run; j++) {
+                memcpy(record + j * info->point_size, run_buffer + (indices[index + i + j] - point) * info->point_size, info->point_size);
+            }
+            i += run;
+        }
+
+        _LASER_DECODE(plan, (uint8_t*) points, index, point_buffer, block);
+        if(plan->stats) {
+            _laser_stats_block(plan->stats, plan, point_buffer, block);
+        }
+        index += block;
+    }
+    return LASER_SUCCESS;
+}
+
+void laser_lod_order(const uint64_t* indices, uint64_t* lod, uint64_t count) {
+    uint32_t bits = 0;
+    while(bits < 64 && ((uint64_t) 1 << bits) < count) {
+        bits++;
+    }
+
+    /* Visits the ranks 0, n/2, n/4, 3n/4, ... skipping those past the end, the reversed counter covers each rank once. */
+    uint64_t written = 0;
+    for(uint64_t i = 0; written < count; i++) {
+        uint64_t rank = i;
+        rank = ((rank >> 1) & 0x5555555555555555ull) | ((rank & 0x5555555555555555ull) << 1);
+        rank = ((rank >> 2) & 0x3333333333333333ull) | ((rank & 0x3333333333333333ull) << 2);
+        rank = ((rank >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((rank & 0x0F0F0F0F0F0F0F0Full) << 4);
+        rank = ((rank >> 8) & 0x00FF00FF00FF00FFull) | ((rank & 0x00FF00FF00FF00FFull) << 8);
+        rank = ((rank >> 16) & 0x0000FFFF0000FFFFull) | ((rank & 0x0000FFFF0000FFFFull) << 16);
+        rank = (rank >> 32) | (rank << 32);
+        rank = bits ? rank >> (64 - bits): 0;
+        if(rank < count) {
+            lod[written++] = indices[rank];
+        }
+    }
+}
+
+static void _laser_raster_reset(laserRaster* raster) {
+    uint64_t cell_count = (uint64_t) raster->width * raster->height;
+    float initial = raster->reduce == LASER_RASTER_MIN ? 3.402823466e+38f: (raster->reduce == LASER_RASTER_MAX ? -3.402823466e+38f: 0.0f);
+    for(uint64_t i = 0; i < cell_count; i++) {
+        raster->cells[i] = initial;
+    }
+    memset(raster->counts, 0, cell_count * sizeof(uint32_t));
+}
+
+uint64_t laser_raster_size(const laserRaster* raster) {
+    return (uint64_t) raster->width * raster->height * (sizeof(float) + sizeof(uint32_t));
+}
+
+laserResult laser_raster_init(laserRaster* raster, const laserFile* file, void* mem, uint64_t size) {
+    const laserInfo* info = &file->info;
+    if(size < laser_raster_size(raster)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    /* Cell coordinates are a single multiply-add on the raw integers. */
+    raster->cells = (float*) mem;
+    raster->counts = (uint32_t*) (raster->cells + (uint64_t) raster->width * raster->height);
+    raster->scale_x = info->scale_x / raster->cell_size;
+    raster->bias_x = (info->offset_x - raster->origin_x) / raster->cell_size;
+    raster->scale_y = info->scale_y / raster->cell_size;
+    raster->bias_y = (info->offset_y - raster->origin_y) / raster->cell_size;
+    raster->value_scale = raster->value == LASER_RASTER_Z ? info->scale_z: 1.0f;
+    raster->value_offset = raster->value == LASER_RASTER_Z ? info->offset_z: 0.0f;
+    raster->return_mask = info->point_format >= 6 ? 0xF: 0x7;
+    raster->return_count_shift = info->point_format >= 6 ? 4: 3;
+    _laser_raster_reset(raster);
+    return LASER_SUCCESS;
+}
+
+static void _laser_raster_add(laserRaster* raster, const uint8_t* raw_point, uint64_t point_size, uint64_t count) {
+    uint64_t targets[LASER_DECODE_BLOCK_SIZE];
+    float values[LASER_DECODE_BLOCK_SIZE];
+    uint32_t last_returns = (raster->flags & LASER_RASTER_LAST_RETURNS) != 0;
+    uint32_t intensity = raster->value == LASER_RASTER_INTENSITY;
+    double width = (double) raster->width;
+    double height = (double) raster->height;
+
+    /* First bin the block without branching, then reduce in a loop specialized for the reduction. */
+    uint64_t binned = 0;
+    for(uint64_t i = 0; i < count; i++, raw_point += point_size) {
+        const int32_t* xyz = (const int32_t*) raw_point;
+        uint32_t returns = raw_point[_LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_FLAGS]];
+        double x = xyz[0] * raster->scale_x + raster->bias_x;
+        double y = xyz[1] * raster->scale_y + raster->bias_y;
+        uint32_t keep = (x >= 0.0) & (y >= 0.0) & (x < width) & (y < height) & (!last_returns | ((returns & raster->return_mask) == ((returns >> raster->return_count_shift) & raster->return_mask)));
+        x = keep ? x: 0.0;
+        y = keep ? y: 0.0;
+
+        float z = xyz[2] * raster->value_scale + raster->value_offset;
+        float value = *((const uint16_t*) (raw_point + _LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_INTENSITY]));
+        targets[binned] = (uint64_t) y * raster->width + (uint64_t) x;
+        values[binned] = intensity ? value: z;
+        binned += keep;
+    }
+
+    float* cells = raster->cells;
+    uint32_t* counts = raster->counts;
+    switch(raster->reduce) {
+        case LASER_RASTER_MIN:
+            for(uint64_t i = 0; i < binned; i++) {
+                float* cell = &cells[targets[i]];
+                *cell = values[i] < *cell ? values[i]: *cell;
+                counts[targets[i]]++;
+            }
+            break;
+        case LASER_RASTER_MAX:
+            for(uint64_t i = 0; i < binned; i++) {
+                float* cell = &cells[targets[i]];
+                *cell = values[i] > *cell ? values[i]: *cell;
+                counts[targets[i]]++;
+            }
+            break;
+        case LASER_RASTER_MEAN:
+            for(uint64_t i = 0; i < binned; i++) {
+                uint32_t n = ++counts[targets[i]];
+                cells[targets[i]] += (values[i] - cells[targets[i]]) / (float) n;
+            }
+            break;
+        case LASER_RASTER_COUNT:
+            for(uint64_t i = 0; i < binned; i++) {
+                counts[targets[i]]++;
+            }
+            break;
+    }
+}
+
+typedef struct _laserRasterScan {
+    const laserPlan* plan;
+    laserRaster* raster;
+    uint64_t point_size;
+} _laserRasterScan;
+
+static void _laser_scan_raster(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count) {
+    _laserRasterScan* scan = (_laserRasterScan*) usr;
+    if(!scan->plan || !scan->plan->filter) {
+        _laser_raster_add(scan->raster, raw_point, scan->point_size, count);
+        return;
+    }
+
+    uint16_t selection[LASER_DECODE_BLOCK_SIZE];
+    uint64_t selected = _laser_select_block(scan->plan, raw_point, first, count, selection);
+    for(uint64_t i = 0; i < selected; i++) {
+        _laser_raster_add(scan->raster, raw_point + selection[i] * scan->point_size, scan->point_size, 1);
+    }
+}
+
+laserResult laser_file_rasterize(const laserFile* file, const laserPlan* plan, laserRaster* raster, uint64_t first, uint64_t count) {
+    _laserRasterScan scan;
+    scan.plan = plan;
+    scan.raster = raster;
+    scan.point_size = file->info.point_size;
+    laserResult res = _laser_scan_raw(file, first, count, _laser_scan_raster, (void*) &scan);
+    return res == LASER_SUCCESS ? _laser_sample_result(plan): res;
+}
+
+typedef struct _laserRasterTask {
+    const laserFile* file;
+    const laserPlan* plan;
+    laserRaster raster;
+    uint64_t first;
+    uint64_t count;
+    laserResult res;
+} _laserRasterTask;
+
+static void _laser_run_raster_task(void* arg) {
+    _laserRasterTask* task = (_laserRasterTask*) arg;
+    task->res = laser_file_rasterize(task->file, task->plan, &task->raster, task->first, task->count);
+}
+
+laserResult laser_file_rasterize_parallel(const laserFile* file, const laserPlan* plan, laserRaster* raster, uint64_t first, uint64_t count, void* scratch, uint64_t scratch_size, laserScheduler* scheduler) {
+    const laserInfo* info = &file->info;
+    count = count == LASER_ALL_POINTS ? info->point_count: count;
+    if(first > info->point_count || count > info->point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    }
+
+    /* The first task bins into `raster` itself, every other one into a partial grid out of `scratch`. */
+    uint64_t raster_size = laser_raster_size(raster);
+    uint64_t task_count = scheduler->task_count > LASER_MAX_TASKS ? LASER_MAX_TASKS: scheduler->task_count;
+    uint64_t partial_count = raster_size ? scratch_size / raster_size: 0;
+    task_count = task_count > partial_count + 1 ? partial_count + 1: task_count;
+    task_count = task_count > (count + LASER_DECODE_BLOCK_SIZE - 1) / LASER_DECODE_BLOCK_SIZE ? (count + LASER_DECODE_BLOCK_SIZE - 1) / LASER_DECODE_BLOCK_SIZE: task_count;
+    if(!file->mem || info->compressed || task_count <= 1 || (plan && plan->voxels)) {
+        return laser_file_rasterize(file, plan, raster, first, count);
+    }
+
+    _laserRasterTask tasks[LASER_MAX_TASKS];
+    uint64_t chunk = (count + task_count - 1) / task_count;
+    uint32_t submitted = 0;
+    for(uint64_t task_first = 0; task_first < count; task_first += chunk, submitted++) {
+        _laserRasterTask* task = &tasks[submitted];
+        task->file = file;
+        task->plan = plan;
+        task->raster = *raster;
+        task->first = first + task_first;
+        task->count = (count - task_first) < chunk ? (count - task_first): chunk;
+        task->res = LASER_SUCCESS;
+        if(submitted) {
+            laser_raster_init(&task->raster, file, ((uint8_t*) scratch) + (submitted - 1) * raster_size, raster_size);
+        }
+        scheduler->submit(scheduler->usr, _laser_run_raster_task, task);
+    }
+    scheduler->wait(scheduler->usr);
+
+    laserResult res = LASER_SUCCESS;
+    for(uint32_t i = 0; i < submitted; i++) {
+        if(i) {
+            laser_raster_merge(raster, &tasks[i].raster);
+        }
+        res = res == LASER_SUCCESS ? tasks[i].res: res;
+    }
+    return res;
+}
+
+void laser_raster_merge(laserRaster* raster, const laserRaster* other) {
+    uint64_t cell_count = (uint64_t) raster->width * raster->height;
+    for(uint64_t i = 0; i < cell_count; i++) {
+        uint32_t n = other->counts[i];
+        if(!n) {
+            continue;
+        }
+
+        float value = other->cells[i];
+        switch(raster->reduce) {
+            case LASER_RASTER_MIN:
+                raster->cells[i] = value < raster->cells[i] ? value: raster->cells[i];
+                break;
+            case LASER_RASTER_MAX:
+                raster->cells[i] = value > raster->cells[i] ? value: raster->cells[i];
+                break;
+            case LASER_RASTER_MEAN:
+                raster->cells[i] += (value - raster->cells[i]) * ((float) n / (float) (raster->counts[i] + n));
+                break;
+            case LASER_RASTER_COUNT:
+                break;
+        }
+        raster->counts[i] += n;
+    }
+}
+
+void laser_raster_finish(laserRaster* raster) {
+    uint64_t cell_count = (uint64_t) raster->width * raster->height;
+    for(uint64_t i = 0; i < cell_count; i++) {
+        if(raster->reduce == LASER_RASTER_COUNT) {
+            raster->cells[i] = (float) raster->counts[i];
+        } else if(!raster->counts[i]) {
+            raster->cells[i] = raster->nodata;
+        }
+    }
+}
+
+/*
+ *  Writing runs the decode in reverse: the layout is compiled into one encode kernel per attribute, records are zeroed
+ *  and filled block by block straight in the caller's buffer, the shared bit fields are or'ed in. Coordinates go
+ *  through the quantize kernel which also tracks the quantized bounds, the return counts are taken from the finished
+ *  records while they are still in cache.
+ */
+
+typedef void (*_laserAttribEncodeFn)(uint8_t* raw_point, uint64_t point_size, const uint8_t* point, uint64_t stride, uint64_t count, laserWriter* writer);
+
+typedef struct _laserEncodeEntry {
+    _laserAttribEncodeFn encode;
+    const uint8_t* point;
+    uint64_t stride;
+} _laserEncodeEntry;
+
+static double _laser_writer_clamp(double quantized) {
+    quantized = quantized > -2147483648.0 ? quantized: -2147483648.0;
+    return quantized < 2147483647.0 ? quantized: 2147483647.0;
+}
+
+/* Rounds to nearest, ties to even, which is what `_mm_cvtpd_epi32` does under the default rounding mode. */
+static int32_t _laser_writer_round(double quantized) {
+    int32_t truncated = (int32_t) quantized;
+    double fraction = quantized - (double) truncated;
+    if(fraction > 0.5 || (fraction == 0.5 && (truncated & 1))) {
+        truncated++;
+    } else if(fraction < -0.5 || (fraction == -0.5 && (truncated & 1))) {
+        truncated--;
+    }
+    return truncated;
+}
+
+static void _laser_quantize(laserWriter* writer, uint32_t axis, uint8_t* raw, uint64_t point_size, const uint8_t* point, uint64_t stride, uint64_t count) {
+    uint32_t wide = writer->info.flags & LASER_WRITER_DOUBLE_XYZ;
+    double scale = writer->quantize_scale[axis];
+    double offset = writer->quantize_offset[axis];
+    double min = writer->min[axis];
+    double max = writer->max[axis];
+    uint64_t i = 0;
+
+#if defined(_LASER_SIMD_SSE2)
+    if(count >= 2) {
+        __m128d vscale = _mm_set1_pd(scale), voffset = _mm_set1_pd(offset);
+        __m128d lo = _mm_set1_pd(-2147483648.0), hi = _mm_set1_pd(2147483647.0);
+        __m128d vmin = _mm_set1_pd(min), vmax = _mm_set1_pd(max);
+        for(; i + 2 <= count; i += 2) {
+            __m128d v = wide ?
+                _mm_set_pd(*((const double*) (point + stride)), *((const double*) point)):
+                _mm_set_pd((double) *((const float*) (point + stride)), (double) *((const float*) point));
+            __m128d q = _mm_min_pd(_mm_max_pd(_mm_div_pd(_mm_sub_pd(v, voffset), vscale), lo), hi);
+            __m128i r = _mm_cvtpd_epi32(q);
+            __m128d rounded = _mm_cvtepi32_pd(r);
+            vmin = _mm_min_pd(vmin, rounded);
+            vmax = _mm_max_pd(vmax, rounded);
+            *((int32_t*) raw) = _mm_cvtsi128_si32(r);
+            *((int32_t*) (raw + point_size)) = _mm_cvtsi128_si32(_mm_srli_si128(r, 4));
+            point += 2 * stride;
+            raw += 2 * point_size;
+        }
+
+        double lanes[2][2];
+        _mm_storeu_pd(lanes[0], vmin);
+        _mm_storeu_pd(lanes[1], vmax);
+        min = lanes[0][0] < lanes[0][1] ? lanes[0][0]: lanes[0][1];
+        max = lanes[1][0] > lanes[1][1] ? lanes[1][0]: lanes[1][1];
+    }
+#endif
+
+    for(; i < count; i++) {
+        double v = wide ? *((const double*) point): (double) *((const float*) point);
+        int32_t r = _laser_writer_round(_laser_writer_clamp((v - offset) / scale));
+        min = r < min ? r: min;
+        max = r > max ? r: max;
+        *((int32_t*) raw) = r;
+        point += stride;
+        raw += point_size;
+    }
+    writer->min[axis] = min;
+    writer->max[axis] = max;
+}
+
+#define _LASER_DEFINE_COORD_ENCODE(name, axis) \
+    static void _laser_encode_##name(uint8_t* raw_point, uint64_t point_size, const uint8_t* point, uint64_t stride, uint64_t count, laserWriter* writer) { \
+        _laser_quantize(writer, axis, raw_point + 4 * axis, point_size, point, stride, count); \
+    }
+
+/*
+ *  `v` is the attribute of the current point and `raw` points at its field in the record, found the same way as in
+ *  `_LASER_DEFINE_CONVERT_DECODE`.
+ */
+#define _LASER_DEFINE_CONVERT_ENCODE(name, type, attrib, stmt) \
+    static void _laser_encode_##name(uint8_t* raw_point, uint64_t point_size, const uint8_t* point, uint64_t stride, uint64_t count, laserWriter* writer) { \
+        uint8_t* raw = raw_point + _LASER_ATTRIB_OFFSET_TABLE[writer->info.point_format][attrib]; \
+        (void) writer; \
+        for(uint64_t i = 0; i < count; i++) { \
+            type v = *((const type*) point); \
+            stmt; \
+            point += stride; \
+            raw += point_size; \
+        } \
+    }
+
+static int16_t _laser_writer_scan_angle_14(double degrees) {
+    double steps = degrees / 0.006;
+    steps = steps > -30000.0 ? steps: -30000.0;
+    steps = steps < 30000.0 ? steps: 30000.0;
+    return (int16_t) _laser_writer_round(steps);
+}
+
+static int8_t _laser_writer_scan_angle(double degrees) {
+    degrees = degrees > -128.0 ? degrees: -128.0;
+    degrees = degrees < 127.0 ? degrees: 127.0;
+    return (int8_t) _laser_writer_round(degrees);
+}
+
+_LASER_DEFINE_COORD_ENCODE(x, 0)
+_LASER_DEFINE_COORD_ENCODE(y, 1)
+_LASER_DEFINE_COORD_ENCODE(z, 2)
+_LASER_DEFINE_CONVERT_ENCODE(intensity, uint16_t, LASER_ATTRIB_TYPE_INTENSITY, *((uint16_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(flags, uint8_t, LASER_ATTRIB_TYPE_FLAGS, *raw |= v)
+_LASER_DEFINE_CONVERT_ENCODE(flags_14, uint8_t, LASER_ATTRIB_TYPE_FLAGS, raw[0] |= (uint8_t) ((v & 0x7) | ((v & 0x38) << 1)); raw[1] |= (uint8_t) (v & 0xC0))
+_LASER_DEFINE_CONVERT_ENCODE(classification, uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION, *raw |= v)
+_LASER_DEFINE_CONVERT_ENCODE(classification_14, uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION, raw[0] |= (uint8_t) (v & 0x1F); raw[-1] |= (uint8_t) (v >> 5))
+_LASER_DEFINE_CONVERT_ENCODE(scan_angle, int8_t, LASER_ATTRIB_TYPE_SCAN_ANGLE, *((int8_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(scan_angle_14, int8_t, LASER_ATTRIB_TYPE_SCAN_ANGLE, *((int16_t*) raw) = _laser_writer_scan_angle_14((double) v))
+_LASER_DEFINE_CONVERT_ENCODE(usr, uint8_t, LASER_ATTRIB_TYPE_USR, *raw = v)
+_LASER_DEFINE_CONVERT_ENCODE(point_id, uint16_t, LASER_ATTRIB_TYPE_POINT_ID, *((uint16_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(gps_time, double, LASER_ATTRIB_TYPE_GPS_TIME, *((double*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(red, uint16_t, LASER_ATTRIB_TYPE_RED, *((uint16_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(green, uint16_t, LASER_ATTRIB_TYPE_GREEN, *((uint16_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(blue, uint16_t, LASER_ATTRIB_TYPE_BLUE, *((uint16_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(waveform_id, uint8_t, LASER_ATTRIB_TYPE_WAVEFORM_ID, *raw = v)
+_LASER_DEFINE_CONVERT_ENCODE(waveform_offset, uint64_t, LASER_ATTRIB_TYPE_WAVEFORM_OFFSET, *((uint64_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(waveform_size, uint32_t, LASER_ATTRIB_TYPE_WAVEFORM_SIZE, *((uint32_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(waveform_location, float, LASER_ATTRIB_TYPE_WAVEFORM_LOCATION, *((float*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(x_time, float, LASER_ATTRIB_TYPE_X_TIME, *((float*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(y_time, float, LASER_ATTRIB_TYPE_Y_TIME, *((float*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(z_time, float, LASER_ATTRIB_TYPE_Z_TIME, *((float*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(nir, uint16_t, LASER_ATTRIB_TYPE_NIR, *((uint16_t*) raw) = v)
+_LASER_DEFINE_CONVERT_ENCODE(extended_returns, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_RETURNS, *raw |= (uint8_t) (((v & 0xF) > 7 ? 7: (v & 0xF)) | ((v >> 4) > 7 ? 7: (v >> 4)) << 3))
+_LASER_DEFINE_CONVERT_ENCODE(extended_returns_14, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_RETURNS, *raw |= v)
+_LASER_DEFINE_CONVERT_ENCODE(extended_classification, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION, *raw |= (uint8_t) (v > 31 ? 31: v))
+_LASER_DEFINE_CONVERT_ENCODE(extended_classification_14, uint8_t, LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION, *raw |= v)
+_LASER_DEFINE_CONVERT_ENCODE(classification_flags, uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS, *raw |= (uint8_t) ((v & 0x7) << 5))
+_LASER_DEFINE_CONVERT_ENCODE(classification_flags_14, uint8_t, LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS, *raw |= (uint8_t) (v & 0xF))
+_LASER_DEFINE_CONVERT_ENCODE(scanner_channel_14, uint8_t, LASER_ATTRIB_TYPE_SCANNER_CHANNEL, *raw |= (uint8_t) ((v & 0x3) << 4))
+_LASER_DEFINE_CONVERT_ENCODE(scan_angle_degrees, float, LASER_ATTRIB_TYPE_SCAN_ANGLE_DEGREES, *((int8_t*) raw) = _laser_writer_scan_angle((double) v))
+_LASER_DEFINE_CONVERT_ENCODE(scan_angle_degrees_14, float, LASER_ATTRIB_TYPE_SCAN_ANGLE_DEGREES, *((int16_t*) raw) = _laser_writer_scan_angle_14((double) v))
+_LASER_DEFINE_CONVERT_ENCODE(gps_time_relative, float, LASER_ATTRIB_TYPE_GPS_TIME_RELATIVE, *((double*) raw) = (double) v + writer->info.time_base)
+_LASER_DEFINE_CONVERT_ENCODE(rgb8, uint32_t, LASER_ATTRIB_TYPE_RGB8, ((uint16_t*) raw)[0] = (uint16_t) ((v & 0xFF) * 257); ((uint16_t*) raw)[1] = (uint16_t) (((v >> 8) & 0xFF) * 257); ((uint16_t*) raw)[2] = (uint16_t) (((v >> 16) & 0xFF) * 257))
+
+/* Legacy formats have no scanner channel, the attribute is dropped like any attribute the format doesn't store. */
+static const _laserAttribEncodeFn _LASER_ATTRIB_ENCODE_TABLE[2][LASER_ATTRIB_TYPE_COUNT] = {
+    {
+        _laser_encode_x,
+        _laser_encode_y,
+        _laser_encode_z,
+        _laser_encode_intensity,
+        _laser_encode_flags,
+        _laser_encode_classification,
+        _laser_encode_scan_angle,
+        _laser_encode_usr,
+        _laser_encode_point_id,
+        _laser_encode_gps_time,
+        _laser_encode_red,
+        _laser_encode_green,
+        _laser_encode_blue,
+        _laser_encode_waveform_id,
+        _laser_encode_waveform_offset,
+        _laser_encode_waveform_size,
+        _laser_encode_waveform_location,
+        _laser_encode_x_time,
+        _laser_encode_y_time,
+        _laser_encode_z_time,
+        _laser_encode_nir,
+        _laser_encode_extended_returns,
+        _laser_encode_extended_classification,
+        _laser_encode_classification_flags,
+        0,
+        _laser_encode_scan_angle_degrees,
+        _laser_encode_gps_time_relative,
+        _laser_encode_rgb8,
+    },
+    {
+        _laser_encode_x,
+        _laser_encode_y,
+        _laser_encode_z,
+        _laser_encode_intensity,
+        _laser_encode_flags_14,
+        _laser_encode_classification_14,
+        _laser_encode_scan_angle_14,
+        _laser_encode_usr,
+        _laser_encode_point_id,
+        _laser_encode_gps_time,
+        _laser_encode_red,
+        _laser_encode_green,
+        _laser_encode_blue,
+        _laser_encode_waveform_id,
+        _laser_encode_waveform_offset,
+        _laser_encode_waveform_size,
+        _laser_encode_waveform_location,
+        _laser_encode_x_time,
+        _laser_encode_y_time,
+        _laser_encode_z_time,
+        _laser_encode_nir,
+        _laser_encode_extended_returns_14,
+        _laser_encode_extended_classification_14,
+        _laser_encode_classification_flags_14,
+        _laser_encode_scanner_channel_14,
+        _laser_encode_scan_angle_degrees_14,
+        _laser_encode_gps_time_relative,
+        _laser_encode_rgb8,
+    },
+};
+
+static uint32_t _laser_writer_add(const laserWriter* writer, _laserEncodeEntry* entries, uint32_t entry_count, laserAttribType type, const uint8_t* point, uint64_t stride) {
+    uint32_t format = writer->info.point_format;
+    _laserAttribEncodeFn encode = _LASER_ATTRIB_ENCODE_TABLE[format >= 6][type];
+    if(!((_LASER_VALID_ATTRIB_TABLE[format] >> type) & 1) || !encode) {
+        return entry_count;
+    }
+
+    entries[entry_count].encode = encode;
+    entries[entry_count].point = point;
+    entries[entry_count].stride = stride;
+    return entry_count + 1;
+}
+
+static void _laser_writer_header(const laserWriter* writer, laserPublicHeaderBlock14* header) {
+    const laserWriterInfo* info = &writer->info;
+    laserPublicHeaderBlock* legacy = &header->legacy;
+    memset(header, 0, sizeof(laserPublicHeaderBlock14));
+    memcpy(&legacy->magic, _LASER_MAGIC, 4);
+    memcpy(legacy->software, "laser", 5);
+    legacy->version_major = 1;
+    legacy->version_minor = (uint8_t) info->version_minor;
+    legacy->global_encoding.wkt = info->point_format >= 6;
+    legacy->phb_size = (uint16_t) writer->header_size;
+    legacy->point_offset = writer->point_offset;
+    legacy->vlr_count = info->vlr_count;
+    legacy->format_id = (uint8_t) info->point_format;
+    legacy->point_size = (uint16_t) info->point_size;
+    legacy->x_scale = info->scale_x;
+    legacy->y_scale = info->scale_y;
+    legacy->z_scale = info->scale_z;
+    legacy->x_offset = info->offset_x;
+    legacy->y_offset = info->offset_y;
+    legacy->z_offset = info->offset_z;
+
+    /* The legacy counts stay zero for formats 6 - 10 and for more points than they can hold. */
+    if(info->point_format < 6 && writer->point_count <= 0xFFFFFFFFull) {
+        legacy->point_count = (uint32_t) writer->point_count;
+        for(uint32_t i = 0; i < 5; i++) {
+            legacy->point_count_per_return[i] = (uint32_t) writer->return_counts[i + 1];
+        }
+    }
+    header->point_count = writer->point_count;
+    for(uint32_t i = 0; i < 15; i++) {
+        header->point_count_per_return[i] = writer->return_counts[i + 1];
+    }
+
+    if(writer->point_count) {
+        legacy->x_min = writer->min[0] * info->scale_x + info->offset_x;
+        legacy->x_max = writer->max[0] * info->scale_x + info->offset_x;
+        legacy->y_min = writer->min[1] * info->scale_y + info->offset_y;
+        legacy->y_max = writer->max[1] * info->scale_y + info->offset_y;
+        legacy->z_min = writer->min[2] * info->scale_z + info->offset_z;
+        legacy->z_max = writer->max[2] * info->scale_z + info->offset_z;
+    }
+}
+
+static laserResult _laser_writer_put(laserWriter* writer, const void* data, uint64_t size, uint64_t offset) {
+    if(writer->result == LASER_SUCCESS && size && writer->fn(writer->usr, data, size, offset) != size) {
+        writer->result = LASER_ERROR_IO_WRITE;
+    }
+    return writer->result;
+}
+
+static laserResult _laser_writer_flush(laserWriter* writer) {
+    _laser_writer_put(writer, writer->buffer, writer->buffer_used, writer->offset);
+    writer->offset += writer->buffer_used;
+    writer->buffer_used = 0;
+    return writer->result;
+}
+
+static laserResult _laser_write_range(laserWriter* writer, const _laserEncodeEntry* entries, uint32_t entry_count, uint32_t flags, uint64_t count) {
+    uint64_t point_size = writer->info.point_size;
+    uint32_t return_mask = writer->info.point_format >= 6 ? 0xF: 0x7;
+    if(writer->result != LASER_SUCCESS) {
+        return writer->result;
+    }
+
+    /* Coordinates left out of the layout are written as zero and count towards the bounds as such. */
+    for(uint32_t axis = 0; axis < 3 && count; axis++) {
+        if(!(flags & (1u << axis))) {
+            writer->min[axis] = writer->min[axis] < 0.0 ? writer->min[axis]: 0.0;
+            writer->max[axis] = writer->max[axis] > 0.0 ? writer->max[axis]: 0.0;
+        }
+    }
+
+    uint64_t index = 0;
+    while(count > 0) {
+        if(writer->buffer_used + point_size > writer->buffer_size && _laser_writer_flush(writer) != LASER_SUCCESS) {
+            return writer->result;
+        }
+
+        uint64_t block = (writer->buffer_size - writer->buffer_used) / point_size;
+        block = block < LASER_DECODE_BLOCK_SIZE ? block: LASER_DECODE_BLOCK_SIZE;
+        block = block < count ? block: count;
+        uint8_t* raw_point = writer->buffer + writer->buffer_used;
+        memset(raw_point, 0, block * point_size);
+        for(uint32_t i = 0; i < entry_count; i++) {
+            entries[i].encode(raw_point, point_size, entries[i].point + index * entries[i].stride, entries[i].stride, block, writer);
+        }
+        for(uint64_t i = 0; i < block; i++) {
+            writer->return_counts[raw_point[i * point_size + _LASER_ATTRIB_OFFSET_TABLE[0][LASER_ATTRIB_TYPE_FLAGS]] & return_mask]++;
+        }
+
+        writer->buffer_used += block * point_size;
+        writer->point_count += block;
+        index += block;
+        count -= block;
+    }
+    return LASER_SUCCESS;
+}
+
+laserResult laser_writer_begin(laserWriter* writer, const laserWriterInfo* info, void* buffer, uint64_t buffer_size, laserIoWriteFn fn, void* usr) {
+    memset(writer, 0, sizeof(laserWriter));
+    writer->info = *info;
+    writer->fn = fn;
+    writer->usr = usr;
+    writer->buffer = (uint8_t*) buffer;
+    writer->buffer_size = buffer_size;
+
+    laserWriterInfo* config = &writer->info;
+    if(config->point_format > 10) {
+        return writer->result = LASER_ERROR_FORMAT_UNSUPPORTED;
+    }
+
+    uint32_t version_minor = _LASER_FORMAT_VERSION_TABLE[config->point_format];
+    config->version_minor = config->version_minor ? config->version_minor: (version_minor > 2 ? version_minor: 2);
+    config->point_size = config->point_size ? config->point_size: (uint32_t) _LASER_POINT_SIZE_TABLE[config->point_format];
+    if(config->version_minor > 4) {
+        return writer->result = LASER_ERROR_VERSION_UNSUPPORTED;
+    } else if(config->version_minor < version_minor || config->point_size < _LASER_POINT_SIZE_TABLE[config->point_format] || config->point_size > 0xFFFF) {
+        return writer->result = LASER_ERROR_FORMAT_UNSUPPORTED;
+    } else if(buffer_size < config->point_size) {
+        return writer->result = LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    LASER_ASSERT(config->scale_x != 0.0 && config->scale_y != 0.0 && config->scale_z != 0.0);
+    writer->header_size = config->version_minor >= 4 ? (uint32_t) sizeof(laserPublicHeaderBlock14): (uint32_t) sizeof(laserPublicHeaderBlock) + (config->version_minor == 3 ? 8: 0);
+    writer->point_offset = (uint32_t) (writer->header_size + config->vlr_size);
+    writer->offset = writer->point_offset;
+    writer->quantize_scale[0] = config->scale_x;
+    writer->quantize_scale[1] = config->scale_y;
+    writer->quantize_scale[2] = config->scale_z;
+    writer->quantize_offset[0] = config->offset_x;
+    writer->quantize_offset[1] = config->offset_y;
+    writer->quantize_offset[2] = config->offset_z;
+    for(uint32_t axis = 0; axis < 3; axis++) {
+        writer->min[axis] = 2147483648.0;
+        writer->max[axis] = -2147483649.0;
+    }
+
+    laserPublicHeaderBlock14 header;
+    _laser_writer_header(writer, &header);
+    _laser_writer_put(writer, &header, writer->header_size, 0);
+    return _laser_writer_put(writer, config->vlrs, config->vlr_size, writer->header_size);
+}
+
+laserResult laser_write_attribs(laserWriter* writer, const void* points, uint64_t stride, const laserAttrib* attribs, uint64_t count) {
+    _laserEncodeEntry entries[LASER_ATTRIB_TYPE_COUNT];
+    uint32_t entry_count = 0;
+    uint32_t flags = 0;
+    for(uint64_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && attribs[i].type != LASER_ATTRIB_TYPE_NONE; i++) {
+        entry_count = _laser_writer_add(writer, entries, entry_count, attribs[i].type, ((const uint8_t*) points) + attribs[i].offset, stride);
+        flags |= 1u << attribs[i].type;
+    }
+    return _laser_write_range(writer, entries, entry_count, flags, count);
+}
+
+laserResult laser_write_columns(laserWriter* writer, const laserColumn* columns, uint64_t count) {
+    _laserEncodeEntry entries[LASER_ATTRIB_TYPE_COUNT];
+    uint32_t entry_count = 0;
+    uint32_t flags = 0;
+    for(uint64_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && columns[i].type != LASER_ATTRIB_TYPE_NONE; i++) {
+        uint64_t size = _LASER_ATTRIB_SIZE_TABLE[columns[i].type];
+        size = columns[i].type <= LASER_ATTRIB_TYPE_Z && (writer->info.flags & LASER_WRITER_DOUBLE_XYZ) ? 8: size;
+        uint64_t stride = columns[i].stride == LASER_DEFAULT_STRIDE ? size: columns[i].stride;
+        entry_count = _laser_writer_add(writer, entries, entry_count, columns[i].type, (const uint8_t*) columns[i].data, stride);
+        flags |= 1u << columns[i].type;
+    }
+    return _laser_write_range(writer, entries, entry_count, flags, count);
+}
+
+laserResult laser_writer_finish(laserWriter* writer) {
+    if(writer->info.version_minor < 4 && writer->point_count > 0xFFFFFFFFull && writer->result == LASER_SUCCESS) {
+        writer->result = LASER_ERROR_INVALID_RANGE;
+    }
+    if(_laser_writer_flush(writer) != LASER_SUCCESS) {
+        return writer->result;
+    }
+
+    laserPublicHeaderBlock14 header;
+    _laser_writer_header(writer, &header);
+    return _laser_writer_put(writer, &header, writer->header_size, 0);
+}
+
+/*
+ *  The cache index is a chained hash over the slots, `buckets` and `next` hold slot indices. The lock only covers the
+ *  index, the clock hand and the counters, readers pin a slot while copying out of it and loaders keep theirs pinned
+ *  in the loading state until the block is in, so neither can be evicted underneath them. Compilers without GCC or
+ *  MSVC atomics get no lock, the cache is then limited to a single thread.
+ */
+
+enum {
+    _LASER_CACHE_EMPTY,
+    _LASER_CACHE_LOADING,
+    _LASER_CACHE_READY
+};
+
+#define _LASER_CACHE_NONE 0xFFFFFFFFu
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define _LASER_CACHE_LOCK(cache) while(_InterlockedExchange((volatile long*) &(cache)->lock, 1)) { while(*((volatile long*) &(cache)->lock)) {} }
+#define _LASER_CACHE_UNLOCK(cache) _InterlockedExchange((volatile long*) &(cache)->lock, 0)
+#elif defined(__GNUC__)
+#define _LASER_CACHE_LOCK(cache) while(__atomic_exchange_n(&(cache)->lock, 1, __ATOMIC_ACQUIRE)) { while(__atomic_load_n(&(cache)->lock, __ATOMIC_RELAXED)) {} }
+#define _LASER_CACHE_UNLOCK(cache) __atomic_store_n(&(cache)->lock, 0, __ATOMIC_RELEASE)
+#else
+#define _LASER_CACHE_LOCK(cache) (void) (cache)
+#define _LASER_CACHE_UNLOCK(cache) (void) (cache)
+#endif
+
+static uint32_t _laser_cache_bucket(const laserCache* cache, uint64_t file, uint64_t block) {
+    return (uint32_t) _laser_mix_64(file * 0x9E3779B97F4A7C15ull + block) & cache->bucket_mask;
+}
+
+static laserCacheSlot* _laser_cache_find(const laserCache* cache, uint64_t file, uint64_t block) {
+    uint32_t index = cache->buckets[_laser_cache_bucket(cache, file, block)];
+    while(index != _LASER_CACHE_NONE) {
+        laserCacheSlot* slot = &cache->slots[index];
+        if(slot->file == file && slot->block == block) {
+            return slot;
+        }
+        index = slot->next;
+    }
+    return 0;
+}
+
+static void _laser_cache_unlink(laserCache* cache, laserCacheSlot* slot) {
+    uint32_t* link = &cache->buckets[_laser_cache_bucket(cache, slot->file, slot->block)];
+    uint32_t index = (uint32_t) (slot - cache->slots);
+    while(*link != index) {
+        link = &cache->slots[*link].next;
+    }
+    *link = slot->next;
+    slot->state = _LASER_CACHE_EMPTY;
+}
+
+/* Second chance: referenced blocks get their bit cleared and are passed over once, pinned blocks are never taken. */
+static laserCacheSlot* _laser_cache_victim(laserCache* cache) {
+    for(uint64_t i = 0; i < 2 * (uint64_t) cache->block_count; i++) {
+        laserCacheSlot* slot = &cache->slots[cache->hand];
+        cache->hand = cache->hand + 1 == cache->block_count ? 0: cache->hand + 1;
+        if(slot->state == _LASER_CACHE_EMPTY) {
+            return slot;
+        } else if(slot->pins) {
+            continue;
+        } else if(slot->referenced) {
+            slot->referenced = 0;
+            continue;
+        }
+
+        _laser_cache_unlink(cache, slot);
+        cache->evictions++;
+        return slot;
+    }
+    return 0;
+}
+
+static uint64_t _laser_cache_copy(const laserCache* cache, const laserCacheSlot* slot, uint8_t* data, uint64_t within, uint64_t size) {
+    uint64_t available = slot->length > within ? slot->length - within: 0;
+    size = size < available ? size: available;
+    memcpy(data, cache->data + (uint64_t) (slot - cache->slots) * cache->block_size + within, size);
+    return size;
+}
+
+static uint64_t _laser_cache_block(laserCacheFile* file, uint8_t* data, uint64_t block, uint64_t within, uint64_t size) {
+    laserCache* cache = file->cache;
+    uint64_t copied = 0;
+    _LASER_CACHE_LOCK(cache);
+    laserCacheSlot* slot = _laser_cache_find(cache, file->id, block);
+    if(slot && slot->state == _LASER_CACHE_READY) {
+        slot->pins++;
+        slot->referenced = 1;
+        cache->hits++;
+        _LASER_CACHE_UNLOCK(cache);
+
+        copied = _laser_cache_copy(cache, slot, data, within, size);
+        _LASER_CACHE_LOCK(cache);
+        slot->pins--;
+        cache->bytes_saved += copied;
+        _LASER_CACHE_UNLOCK(cache);
+        return copied;
+    }
+
+    cache->misses++;
+    slot = slot ? 0: _laser_cache_victim(cache);
+    if(!slot) {
+        cache->bytes_read += size;
+        _LASER_CACHE_UNLOCK(cache);
+        return file->fn(file->usr, data, size, block * cache->block_size + within);
+    }
+
+    uint32_t bucket = _laser_cache_bucket(cache, file->id, block);
+    slot->file = file->id;
+    slot->block = block;
+    slot->state = _LASER_CACHE_LOADING;
+    slot->pins = 1;
+    slot->referenced = 1;
+    slot->next = cache->buckets[bucket];
+    cache->buckets[bucket] = (uint32_t) (slot - cache->slots);
+    cache->bytes_read += cache->block_size;
+    _LASER_CACHE_UNLOCK(cache);
+
+    uint8_t* block_data = cache->data + (uint64_t) (slot - cache->slots) * cache->block_size;
+    slot->length = file->fn(file->usr, block_data, cache->block_size, block * cache->block_size);
+    copied = _laser_cache_copy(cache, slot, data, within, size);
+
+    /* Failed reads aren't cached, the next reader retries them. */
+    _LASER_CACHE_LOCK(cache);
+    slot->pins = 0;
+    slot->state = _LASER_CACHE_READY;
+    if(!slot->length) {
+        _laser_cache_unlink(cache, slot);
+    }
+    _LASER_CACHE_UNLOCK(cache);
+    return copied;
+}
+
+uint64_t laser_cache_size(uint64_t block_size, uint32_t block_count) {
+    uint64_t bucket_count = 1;
+    while(bucket_count < block_count) {
+        bucket_count <<= 1;
+    }
+    uint64_t index_size = (uint64_t) block_count * sizeof(laserCacheSlot) + bucket_count * sizeof(uint32_t);
+    return ((index_size + 63) & ~(uint64_t) 63) + block_size * block_count;
+}
+
+laserResult laser_cache_init(laserCache* cache, void* mem, uint64_t size, uint64_t block_size, uint32_t block_count) {
+    memset(cache, 0, sizeof(laserCache));
+    if(!block_size || !block_count || block_count == _LASER_CACHE_NONE || size < laser_cache_size(block_size, block_count)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    uint64_t bucket_count = 1;
+    while(bucket_count < block_count) {
+        bucket_count <<= 1;
+    }
+    uint64_t index_size = (uint64_t) block_count * sizeof(laserCacheSlot) + bucket_count * sizeof(uint32_t);
+    cache->slots = (laserCacheSlot*) mem;
+    cache->buckets = (uint32_t*) (cache->slots + block_count);
+    cache->data = ((uint8_t*) mem) + ((index_size + 63) & ~(uint64_t) 63);
+    cache->bucket_mask = (uint32_t) (bucket_count - 1);
+    cache->block_count = block_count;
+    cache->block_size = block_size;
+    memset(cache->slots, 0, block_count * sizeof(laserCacheSlot));
+    memset(cache->buckets, 0xFF, bucket_count * sizeof(uint32_t));
+    return LASER_SUCCESS;
+}
+
+void laser_cache_file(laserCacheFile* file, laserCache* cache, uint64_t id, laserIoReadFn fn, void* usr) {
+    file->cache = cache;
+    file->id = id;
+    file->fn = fn;
+    file->usr = usr;
+}
+
+uint64_t laser_cache_read(void* usr, void* data, uint64_t size, uint64_t offset) {
+    laserCacheFile* file = (laserCacheFile*) usr;
+    uint64_t block_size = file->cache->block_size;
+    uint64_t read = 0;
+    while(read < size) {
+        uint64_t block = (offset + read) / block_size;
+        uint64_t within = (offset + read) % block_size;
+        uint64_t chunk = size - read < block_size - within ? size - read: block_size - within;
+        uint64_t copied = _laser_cache_block(file, ((uint8_t*) data) + read, block, within, chunk);
+        read += copied;
+        if(copied < chunk) {
+            break;
+        }
+    }
+    return read;
+}
+
+void laser_cache_stats(laserCache* cache, laserCacheStats* stats) {
+    _LASER_CACHE_LOCK(cache);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->bytes_saved = cache->bytes_saved;
+    stats->bytes_read = cache->bytes_read;
+    _LASER_CACHE_UNLOCK(cache);
+    stats->hit_rate = stats->hits + stats->misses ? (double) stats->hits / (double) (stats->hits + stats->misses): 0.0;
+}
+
+/*
+ *  Columnar files are little-endian like LAS. The header page holds `_laserColumnarHeader`, the rest of the page and the
+ *  gaps between sections are zero. The header checksum covers the header with its checksum field zeroed.
+ */
+
+#define _LASER_COLUMNAR_VERSION 1
+#define _LASER_COLUMNAR_PAGE 4096
+
+static const uint8_t _LASER_COLUMNAR_MAGIC[8] = { 'L', 'A', 'S', 'E', 'R', 'C', 'O', 'L' };
+static const uint8_t _LASER_ZERO_PAGE[_LASER_COLUMNAR_PAGE] = { 0 };
+
+#pragma pack(push, 1)
+typedef struct _laserColumnarFileSection {
+    uint32_t type;
+    uint32_t encoding;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+} _laserColumnarFileSection;
+
+typedef struct _laserColumnarHeader {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t point_count;
+    uint32_t point_format;
+    uint32_t section_count;
+    double scale[3];
+    double offset[3];
+    double min[3];
+    double max[3];
+    uint64_t checksum;
+    _laserColumnarFileSection sections[LASER_ATTRIB_TYPE_COUNT];
+} _laserColumnarHeader;
+#pragma pack(pop)
+
+typedef struct _laserChecksum {
+    uint64_t a;
+    uint64_t b;
+    uint8_t pending[4];
+    uint32_t pending_size;
+} _laserChecksum;
+
+static void _laser_checksum_init(_laserChecksum* checksum) {
+    memset(checksum, 0, sizeof(_laserChecksum));
+}
+
+static void _laser_checksum_update(_laserChecksum* checksum, const uint8_t* data, uint64_t size) {
+    uint64_t a = checksum->a, b = checksum->b;
+    while(checksum->pending_size && size) {
+        checksum->pending[checksum->pending_size++] = *data++;
+        size--;
+        if(checksum->pending_size == 4) {
+            a += *((const uint32_t*) checksum->pending);
+            b += a;
+            checksum->pending_size = 0;
+        }
+    }
+    for(; size >= 4; size -= 4, data += 4) {
+        a += *((const uint32_t*) data);
+        b += a;
+    }
+    while(size--) {
+        checksum->pending[checksum->pending_size++] = *data++;
+    }
+    checksum->a = a;
+    checksum->b = b;
+}
+
+static uint64_t _laser_checksum_final(_laserChecksum* checksum) {
+    if(checksum->pending_size) {
+        _laser_checksum_update(checksum, _LASER_ZERO_PAGE, 4 - checksum->pending_size);
+    }
+    return checksum->a ^ ((checksum->b << 32) | (checksum->b >> 32));
+}
+
+static uint64_t _laser_checksum(const void* data, uint64_t size) {
+    _laserChecksum checksum;
+    _laser_checksum_init(&checksum);
+    _laser_checksum_update(&checksum, (const uint8_t*) data, size);
+    return _laser_checksum_final(&checksum);
+}
+
+typedef struct _laserColumnarExport {
+    const laserFile* file;
+    laserPlan plan;
+    _laserColumnarHeader header;
+    _laserChecksum checksums[LASER_ATTRIB_TYPE_COUNT];
+    uint8_t* columns[LASER_ATTRIB_TYPE_COUNT];
+    uint64_t sizes[LASER_ATTRIB_TYPE_COUNT];
+    uint64_t capacity;
+    uint64_t pending;
+    uint64_t written;
+    laserIoWriteFn fn;
+    void* usr;
+    laserResult result;
+} _laserColumnarExport;
+
+static void _laser_columnar_put(_laserColumnarExport* export_, const void* data, uint64_t size, uint64_t offset) {
+    if(export_->result == LASER_SUCCESS && size && export_->fn(export_->usr, data, size, offset) != size) {
+        export_->result = LASER_ERROR_IO_WRITE;
+    }
+}
+
+static void _laser_columnar_flush(_laserColumnarExport* export_) {
+    for(uint32_t i = 0; i < export_->header.section_count; i++) {
+        const _laserColumnarFileSection* section = &export_->header.sections[i];
+        uint64_t size = export_->pending * export_->sizes[i];
+        _laser_checksum_update(&export_->checksums[i], export_->columns[i], size);
+        _laser_columnar_put(export_, export_->columns[i], size, section->offset + export_->written * export_->sizes[i]);
+    }
+    export_->written += export_->pending;
+    export_->pending = 0;
+}
+
+static void _laser_scan_columnar(void* usr, const uint8_t* raw_point, uint64_t first, uint64_t count) {
+    _laserColumnarExport* export_ = (_laserColumnarExport*) usr;
+    uint64_t point_size = export_->file->info.point_size;
+    (void) first;
+    while(count > 0 && export_->result == LASER_SUCCESS) {
+        uint64_t block = export_->capacity - export_->pending;
+        block = block < count ? block: count;
+        _laser_decode_range(0, export_->pending, &export_->plan, raw_point, block, 0);
+        for(uint32_t i = 0; i < export_->header.section_count; i++) {
+            const _laserColumnarFileSection* section = &export_->header.sections[i];
+            if(section->encoding == LASER_COLUMNAR_RAW) {
+                int32_t* column = ((int32_t*) export_->columns[i]) + export_->pending;
+                const uint8_t* raw = raw_point + _LASER_ATTRIB_OFFSET_TABLE[0][section->type];
+                for(uint64_t j = 0; j < block; j++) {
+                    column[j] = *((const int32_t*) (raw + j * point_size));
+                }
+            }
+        }
+
+        export_->pending += block;
+        raw_point += block * point_size;
+        count -= block;
+        if(export_->pending == export_->capacity) {
+            _laser_columnar_flush(export_);
+        }
+    }
+}
+
+laserResult laser_columnar_export(const laserFile* file, const laserAttribType* types, uint32_t flags, void* scratch, uint64_t scratch_size, laserIoWriteFn fn, void* usr) {
+    _laserColumnarExport export_;
+    _laserColumnarHeader* header = &export_.header;
+    const laserInfo* info = &file->info;
+    memset(&export_, 0, sizeof(_laserColumnarExport));
+    export_.file = file;
+    export_.fn = fn;
+    export_.usr = usr;
+
+    laserPublicHeaderBlock public_header_block;
+    laserResult res = LASER_SUCCESS;
+    if((res = _laser_file_read(file, &public_header_block, sizeof(laserPublicHeaderBlock), 0)) != LASER_SUCCESS) {
+        return res;
+    }
+
+    memcpy(header->magic, _LASER_COLUMNAR_MAGIC, 8);
+    header->version = _LASER_COLUMNAR_VERSION;
+    header->flags = flags;
+    header->point_count = info->point_count;
+    header->point_format = info->point_format;
+    header->scale[0] = public_header_block.x_scale;
+    header->scale[1] = public_header_block.y_scale;
+    header->scale[2] = public_header_block.z_scale;
+    header->offset[0] = public_header_block.x_offset;
+    header->offset[1] = public_header_block.y_offset;
+    header->offset[2] = public_header_block.z_offset;
+    header->min[0] = public_header_block.x_min;
+    header->min[1] = public_header_block.y_min;
+    header->min[2] = public_header_block.z_min;
+    header->max[0] = public_header_block.x_max;
+    header->max[1] = public_header_block.y_max;
+    header->max[2] = public_header_block.z_max;
+
+    /* Sections are laid out up front, every batch then lands at its final offset in each of them. */
+    laserColumn columns[LASER_ATTRIB_TYPE_COUNT + 1];
+    uint32_t column_count = 0;
+    uint64_t point_bytes = 0;
+    uint64_t offset = _LASER_COLUMNAR_PAGE;
+    for(uint32_t i = 0; i < LASER_ATTRIB_TYPE_COUNT && types[i] != LASER_ATTRIB_TYPE_NONE; i++) {
+        _laserColumnarFileSection* section = &header->sections[header->section_count];
+        uint32_t raw = (flags & LASER_COLUMNAR_RAW_XYZ) && types[i] <= LASER_ATTRIB_TYPE_Z;
+        section->type = (uint32_t) types[i];
+        section->encoding = raw ? LASER_COLUMNAR_RAW: LASER_COLUMNAR_DECODED;
+        section->offset = offset;
+        export_.sizes[header->section_count] = raw ? sizeof(int32_t): _LASER_ATTRIB_SIZE_TABLE[types[i]];
+        section->size = export_.sizes[header->section_count] * info->point_count;
+        point_bytes += export_.sizes[header->section_count];
+        offset = (section->offset + section->size + _LASER_COLUMNAR_PAGE - 1) & ~(uint64_t) (_LASER_COLUMNAR_PAGE - 1);
+        header->section_count++;
+    }
+
+    export_.capacity = point_bytes ? scratch_size / point_bytes: 0;
+    if(!export_.capacity) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    uint8_t* column = (uint8_t*) scratch;
+    for(uint32_t i = 0; i < header->section_count; i++) {
+        export_.columns[i] = column;
+        column += export_.capacity * export_.sizes[i];
+        _laser_checksum_init(&export_.checksums[i]);
+        if(header->sections[i].encoding == LASER_COLUMNAR_DECODED) {
+            columns[column_count].type = (laserAttribType) header->sections[i].type;
+            columns[column_count].data = export_.columns[i];
+            columns[column_count].stride = LASER_DEFAULT_STRIDE;
+            column_count++;
+        }
+    }
+    columns[column_count].type = LASER_ATTRIB_TYPE_NONE;
+    laser_plan_columns(&export_.plan, file, columns);
+
+    if((res = _laser_scan_raw(file, 0, LASER_ALL_POINTS, _laser_scan_columnar, &export_)) != LASER_SUCCESS) {
+        return res;
+    }
+    _laser_columnar_flush(&export_);
+
+    for(uint32_t i = 0; i < header->section_count; i++) {
+        const _laserColumnarFileSection* section = &header->sections[i];
+        uint64_t end = section->offset + section->size;
+        header->sections[i].checksum = _laser_checksum_final(&export_.checksums[i]);
+        if(i + 1 < header->section_count) {
+            _laser_columnar_put(&export_, _LASER_ZERO_PAGE, header->sections[i + 1].offset - end, end);
+        }
+    }
+    header->checksum = _laser_checksum(header, sizeof(_laserColumnarHeader));
+    _laser_columnar_put(&export_, header, sizeof(_laserColumnarHeader), 0);
+    _laser_columnar_put(&export_, _LASER_ZERO_PAGE, _LASER_COLUMNAR_PAGE - sizeof(_laserColumnarHeader), sizeof(_laserColumnarHeader));
+    return export_.result;
+}
+
+laserResult laser_columnar_open(laserColumnar* columnar, const void* mem, uint64_t size) {
+    _laserColumnarHeader header;
+    memset(columnar, 0, sizeof(laserColumnar));
+    if(size < _LASER_COLUMNAR_PAGE) {
+        return LASER_ERROR_INVALID_FILE;
+    }
+
+    memcpy(&header, mem, sizeof(_laserColumnarHeader));
+    uint64_t checksum = header.checksum;
+    header.checksum = 0;
+    if(memcmp(header.magic, _LASER_COLUMNAR_MAGIC, 8) || checksum != _laser_checksum(&header, sizeof(_laserColumnarHeader))) {
+        return LASER_ERROR_INVALID_FILE;
+    } else if(header.version != _LASER_COLUMNAR_VERSION) {
+        return LASER_ERROR_VERSION_UNSUPPORTED;
+    } else if(header.point_format > 10 || header.section_count > LASER_ATTRIB_TYPE_COUNT) {
+        return LASER_ERROR_FORMAT_UNSUPPORTED;
+    }
+
+    for(uint32_t i = 0; i < header.section_count; i++) {
+        const _laserColumnarFileSection* section = &header.sections[i];
+        uint64_t element_size = section->encoding == LASER_COLUMNAR_RAW ? sizeof(int32_t): _LASER_ATTRIB_SIZE_TABLE[section->type < LASER_ATTRIB_TYPE_COUNT ? section->type: 0];
+        if(section->type >= LASER_ATTRIB_TYPE_COUNT || section->encoding > LASER_COLUMNAR_RAW || (section->encoding == LASER_COLUMNAR_RAW && section->type > LASER_ATTRIB_TYPE_Z)) {
+            return LASER_ERROR_FORMAT_UNSUPPORTED;
+        } else if(section->offset % _LASER_COLUMNAR_PAGE || section->offset > size || section->size > size - section->offset ||
+                header.point_count > size / element_size || section->size != element_size * header.point_count) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+
+        columnar->sections[i].type = (laserAttribType) section->type;
+        columnar->sections[i].encoding = (laserColumnarEncoding) section->encoding;
+        columnar->sections[i].offset = section->offset;
+        columnar->sections[i].size = section->size;
+        columnar->sections[i].checksum = section->checksum;
+    }
+
+    laserInfo* info = &columnar->info;
+    info->version_major = 1;
+    info->version_minor = header.point_format >= 6 ? 4: 2;
+    info->point_count = header.point_count;
+    info->point_format = header.point_format;
+    info->point_size = (uint32_t) _LASER_POINT_SIZE_TABLE[header.point_format];
+    info->scale_x = (float) header.scale[0];
+    info->scale_y = (float) header.scale[1];
+    info->scale_z = (float) header.scale[2];
+    info->offset_x = (float) header.offset[0];
+    info->offset_y = (float) header.offset[1];
+    info->offset_z = (float) header.offset[2];
+    info->min_x = (float) header.min[0];
+    info->min_y = (float) header.min[1];
+    info->min_z = (float) header.min[2];
+    info->max_x = (float) header.max[0];
+    info->max_y = (float) header.max[1];
+    info->max_z = (float) header.max[2];
+    memcpy(columnar->scale, header.scale, sizeof(columnar->scale));
+    memcpy(columnar->offset, header.offset, sizeof(columnar->offset));
+    columnar->mem = (const uint8_t*) mem;
+    columnar->size = size;
+    columnar->section_count = header.section_count;
+    return LASER_SUCCESS;
+}
+
+const void* laser_columnar_column(const laserColumnar* columnar, laserAttribType type) {
+    for(uint32_t i = 0; i < columnar->section_count; i++) {
+        if(columnar->sections[i].type == type) {
+            return columnar->mem + columnar->sections[i].offset;
+        }
+    }
+    return 0;
+}
+
+laserResult laser_columnar_verify(const laserColumnar* columnar, laserAttribType type) {
+    for(uint32_t i = 0; i < columnar->section_count; i++) {
+        const laserColumnarSection* section = &columnar->sections[i];
+        if((type == LASER_ATTRIB_TYPE_NONE || section->type == type) && _laser_checksum(columnar->mem + section->offset, section->size) != section->checksum) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+    }
+    return LASER_SUCCESS;
+}
+
+#if defined(LASER_CATALOG_SCAN)
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static uint64_t _laser_catalog_read(void* usr, void* data, uint64_t size, uint64_t offset) {
+    ssize_t read = pread(*((int*) usr), data, size, (off_t) offset);
+    return read < 0 ? 0: (uint64_t) read;
+}
+
+/* The tasks write the entries, so they reach the catalog through `usr` rather than the const one they are given. */
+typedef struct _laserCatalogScan {
+    laserCatalog* catalog;
+    const char* directory;
+} _laserCatalogScan;
+
+static void _laser_catalog_read_header(void* usr, const laserCatalog* scanned, uint32_t tile) {
+    _laserCatalogScan* scan = (_laserCatalogScan*) usr;
+    laserCatalogEntry* entry = &scan->catalog->entries[tile];
+    uint64_t directory_size = strlen(scan->directory);
+    char path[4096];
+
+    (void) scanned;
+    entry->point_size = 0;
+    if(directory_size + entry->name_size + 2 > sizeof(path)) {
+        return;
+    }
+    memcpy(path, scan->directory, directory_size);
+    path[directory_size] = '/';
+    memcpy(path + directory_size + 1, laser_catalog_name(scan->catalog, tile), entry->name_size + 1);
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+
+    laserInfo info;
+    if(laser_info_from_io(&info, _laser_catalog_read, (void*) &fd) == LASER_SUCCESS) {
+        _laser_catalog_fill(entry, &info);
+    }
+    close(fd);
+}
+
+laserResult laser_catalog_scan(laserCatalog* catalog, const char* directory, laserScheduler* scheduler) {
+    DIR* dir = opendir(directory);
+    if(!dir) {
+        return LASER_ERROR_IO_READ;
+    }
+
+    uint32_t first = catalog->entry_count;
+    uint64_t names_size = catalog->names_size;
+    laserResult res = LASER_SUCCESS;
+    laserInfo placeholder;
+    memset(&placeholder, 0, sizeof(placeholder));
+    for(struct dirent* ent = readdir(dir); ent && res == LASER_SUCCESS; ent = readdir(dir)) {
+        uint64_t name_size = strlen(ent->d_name);
+        const char* extension = ent->d_name + name_size - 4;
+        if(name_size > 4 && extension[0] == '.' &&
+                (extension[1] | 0x20) == 'l' && (extension[2] | 0x20) == 'a' && (extension[3] | 0x20) == 's') {
+            res = laser_catalog_add(catalog, ent->d_name, &placeholder);
+        }
+    }
+    closedir(dir);
+    if(res != LASER_SUCCESS) {
+        return res;
+    }
+
+    /* Headers are read in parallel, each task only writes its own entries. */
+    laserCatalog scanned = *catalog;
+    scanned.entries += first;
+    scanned.entry_count -= first;
+    _laserCatalogScan scan;
+    scan.catalog = &scanned;
+    scan.directory = directory;
+    laser_catalog_for_each(&scanned, 0, 0, _laser_catalog_read_header, (void*) &scan, scheduler);
+
+    /* Files that failed to open are dropped along with their names, the names were added in entry order. */
+    uint32_t kept = first;
+    for(uint32_t i = first; i < catalog->entry_count; i++) {
+        laserCatalogEntry* entry = &catalog->entries[i];
+        if(entry->point_size) {
+            memmove(catalog->names + names_size, catalog->names + entry->name_offset, entry->name_size + 1);
+            entry->name_offset = names_size;
+            names_size += entry->name_size + 1;
+            catalog->entries[kept++] = *entry;
+        }
+    }
+    catalog->entry_count = kept;
+    catalog->names_size = names_size;
+    return LASER_SUCCESS;
+}
+#endif
+
+#if defined(LASER_PTHREADS)
+static void* _laser_thread_main(void* arg) {
+    laserThreads* threads = (laserThreads*) arg;
+    pthread_mutex_lock(&threads->mutex);
+    for(;;) {
+        while(!threads->queued && !threads->stop) {
+            pthread_cond_wait(&threads->submitted, &threads->mutex);
+        }
+        if(!threads->queued) {
+            break;
+        }
+
+        laserThreadTask task = threads->tasks[threads->first];
+        threads->first = (threads->first + 1) % LASER_MAX_TASKS;
+        threads->queued--;
+        threads->running++;
+        pthread_mutex_unlock(&threads->mutex);
+        task.fn(task.arg);
+        pthread_mutex_lock(&threads->mutex);
+        if(!--threads->running && !threads->queued) {
+            pthread_cond_broadcast(&threads->finished);
+        }
+    }
+    pthread_mutex_unlock(&threads->mutex);
+    return 0;
+}
+
+static void _laser_threads_submit(void* usr, laserTaskFn fn, void* arg) {
+    laserThreads* threads = (laserThreads*) usr;
+    pthread_mutex_lock(&threads->mutex);
+    if(threads->count && threads->queued < LASER_MAX_TASKS) {
+        laserThreadTask* task = &threads->tasks[(threads->first + threads->queued) % LASER_MAX_TASKS];
+        task->fn = fn;
+        task->arg = arg;
+        threads->queued++;
+        pthread_cond_signal(&threads->submitted);
+        pthread_mutex_unlock(&threads->mutex);
+        return;
+    }
+    pthread_mutex_unlock(&threads->mutex);
+    fn(arg);
+}
+
+static void _laser_threads_wait(void* usr) {
+    laserThreads* threads = (laserThreads*) usr;
+    pthread_mutex_lock(&threads->mutex);
+    while(threads->queued || threads->running) {
+        pthread_cond_wait(&threads->finished, &threads->mutex);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+void laser_threads_scheduler(laserScheduler* scheduler, laserThreads* threads, uint32_t task_count) {
+    uint32_t worker_count = task_count > LASER_MAX_TASKS ? LASER_MAX_TASKS: (task_count ? task_count: 1);
+    pthread_mutex_init(&threads->mutex, 0);
+    pthread_cond_init(&threads->submitted, 0);
+    pthread_cond_init(&threads->finished, 0);
+    threads->count = 0;
+    threads->first = 0;
+    threads->queued = 0;
+    threads->running = 0;
+    threads->stop = 0;
+    while(threads->count < worker_count && pthread_create(&threads->threads[threads->count], 0, _laser_thread_main, (void*) threads) == 0) {
+        threads->count++;
+    }
+
+    scheduler->submit = _laser_threads_submit;
+    scheduler->wait = _laser_threads_wait;
+    scheduler->usr = (void*) threads;
+    scheduler->task_count = task_count;
+}
+
+void laser_threads_close(laserThreads* threads) {
+    pthread_mutex_lock(&threads->mutex);
+    threads->stop = 1;
+    pthread_cond_broadcast(&threads->submitted);
+    pthread_mutex_unlock(&threads->mutex);
+    for(uint32_t i = 0; i < threads->count; i++) {
+        pthread_join(threads->threads[i], 0);
+    }
+    threads->count = 0;
+    pthread_cond_destroy(&threads->finished);
+    pthread_cond_destroy(&threads->submitted);
+    pthread_mutex_destroy(&threads->mutex);
+}
+#endif
+
+#if defined(LASER_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+static void _laser_uring_unmap(laserUring* uring) {
+    if(uring->sqes) {
+        munmap(uring->sqes, uring->sqes_size);
+    }
+    if(uring->cq_ring && uring->cq_ring != uring->sq_ring) {
+        munmap(uring->cq_ring, uring->cq_ring_size);
+    }
+    if(uring->sq_ring) {
+        munmap(uring->sq_ring, uring->sq_ring_size);
+    }
+    if(uring->ring >= 0) {
+        close(uring->ring);
+    }
+    uring->sq_ring = 0;
+    uring->cq_ring = 0;
+    uring->sqes = 0;
+    uring->ring = -1;
+}
+
+static int _laser_uring_setup(laserUring* uring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    uring->ring = (int) syscall(__NR_io_uring_setup, uring->depth, &params);
+    if(uring->ring < 0) {
+        return 0;
+    }
+
+    uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        uring->sq_ring_size = uring->cq_ring_size > uring->sq_ring_size ? uring->cq_ring_size: uring->sq_ring_size;
+    }
+
+    void* sq_ring = mmap(0, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ring, IORING_OFF_SQ_RING);
+    uring->sq_ring = sq_ring == MAP_FAILED ? 0: sq_ring;
+    if(!uring->sq_ring) {
+        _laser_uring_unmap(uring);
+        return 0;
+    }
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        uring->cq_ring = uring->sq_ring;
+    } else {
+        void* cq_ring = mmap(0, uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ring, IORING_OFF_CQ_RING);
+        uring->cq_ring = cq_ring == MAP_FAILED ? 0: cq_ring;
+    }
+
+    uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(0, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ring, IORING_OFF_SQES);
+    uring->sqes = sqes == MAP_FAILED ? 0: sqes;
+    if(!uring->cq_ring || !uring->sqes) {
+        _laser_uring_unmap(uring);
+        return 0;
+    }
+
+    uint8_t* sq = (uint8_t*) uring->sq_ring;
+    uint8_t* cq = (uint8_t*) uring->cq_ring;
+    uring->sq_head = (uint32_t*) (sq + params.sq_off.head);
+    uring->sq_tail = (uint32_t*) (sq + params.sq_off.tail);
+    uring->sq_mask = (uint32_t*) (sq + params.sq_off.ring_mask);
+    uring->sq_array = (uint32_t*) (sq + params.sq_off.array);
+    uring->cq_head = (uint32_t*) (cq + params.cq_off.head);
+    uring->cq_tail = (uint32_t*) (cq + params.cq_off.tail);
+    uring->cq_mask = (uint32_t*) (cq + params.cq_off.ring_mask);
+    uring->cqes = (void*) (cq + params.cq_off.cqes);
+    /* The kernel rounds up to a power of two, a batch must still fit the `LASER_URING_MAX_DEPTH` completion slots. */
+    uring->depth = params.sq_entries < uring->depth ? params.sq_entries: uring->depth;
+
+    if(uring->flags & LASER_URING_REGISTER_BUFFERS) {
+        struct iovec iov;
+        iov.iov_base = (void*) uring->bounce;
+        iov.iov_len = uring->bounce_size;
+        if(!uring->bounce || syscall(__NR_io_uring_register, uring->ring, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+            uring->flags &= ~LASER_URING_REGISTER_BUFFERS;
+        }
+    }
+    return 1;
+}
+
+/*
+ *  Submits `count` reads of `size` bytes each (the last one `last_size`) and waits for all of them, returns the
+ *  number of contiguous bytes read from the start or -1 on error. Short reads past EOF end the contiguous run.
+ *  Interrupted or busy `io_uring_enter` calls are retried. Even on error, every read the kernel accepted is reaped
+ *  before returning, so no stale completion reaches the next batch and the kernel never writes to `data` afterwards.
+ */
+static int64_t _laser_uring_batch(laserUring* uring, uint8_t* data, uint64_t offset, uint64_t size, uint32_t count, uint64_t last_size, int fixed) {
+    uint32_t tail = *uring->sq_tail;
+    uint32_t mask = *uring->sq_mask;
+    struct io_uring_sqe* sqes = (struct io_uring_sqe*) uring->sqes;
+    for(uint32_t i = 0; i < count; i++) {
+        uint32_t index = (tail + i) & mask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED: IORING_OP_READ;
+        sqe->fd = uring->file;
+        sqe->addr = (uint64_t) (uintptr_t) (data + i * size);
+        sqe->len = (uint32_t) (i + 1 == count ? last_size: size);
+        sqe->off = offset + i * size;
+        sqe->user_data = i;
+        uring->sq_array[index] = index;
+    }
+    __atomic_store_n(uring->sq_tail, tail + count, __ATOMIC_RELEASE);
+
+    uint64_t lengths[LASER_URING_MAX_DEPTH];
+    uint32_t submitted = 0;
+    uint32_t completed = 0;
+    int failed = 0;
+    int waiting = 1;
+    while(completed < submitted || (submitted < count && !failed)) {
+        if(waiting) {
+            uint32_t submit = failed ? 0: count - submitted;
+            long res = syscall(__NR_io_uring_enter, uring->ring, submit, submitted + submit - completed, IORING_ENTER_GETEVENTS, 0, 0);
+            if(res >= 0) {
+                submitted += (uint32_t) res;
+            } else if(errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                /* Reads already in flight still complete into the ring, without a working `io_uring_enter` spin on it. */
+                failed = 1;
+                waiting = 0;
+            }
+            if(res < 0 || submit == 0) {
+                /* Partial submissions don't report which entries the kernel took, its `sq_head` does. */
+                submitted = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) - tail;
+            }
+        } else {
+            sched_yield();
+        }
+
+        uint32_t head = *uring->cq_head;
+        uint32_t cq_tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+        struct io_uring_cqe* cqes = (struct io_uring_cqe*) uring->cqes;
+        for(; head != cq_tail; head++) {
+            struct io_uring_cqe* cqe = &cqes[head & *uring->cq_mask];
+            if(cqe->user_data < count) {
+                failed |= cqe->res < 0;
+                lengths[cqe->user_data] = cqe->res < 0 ? 0: (uint64_t) cqe->res;
+            }
+            completed++;
+        }
+        __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    if(submitted < count) {
+        /* Withdraw entries the kernel never consumed, otherwise the next `io_uring_enter` would submit them. */
+        __atomic_store_n(uring->sq_tail, tail + submitted, __ATOMIC_RELEASE);
+    }
+
+    if(failed) {
+        return -1;
+    }
+
+    /* Short reads are finished with `pread`, EOF ends the contiguous run. */
+    int64_t total = 0;
+    for(uint32_t i = 0; i < count; i++) {
+        uint64_t expected = i + 1 == count ? last_size: size;
+        while(lengths[i] < expected) {
+            ssize_t read = pread(uring->file, data + i * size + lengths[i], expected - lengths[i], offset + i * size + lengths[i]);
+            if(read <= 0) {
+                break;
+            }
+            lengths[i] += (uint64_t) read;
+        }
+        total += (int64_t) lengths[i];
+        if(lengths[i] < expected) {
+            break;
+        }
+    }
+    return total;
+}
+
+static uint64_t _laser_uring_read_direct(laserUring* uring, uint8_t* data, uint64_t size, uint64_t offset) {
+    uint64_t read = 0;
+    while(read < size) {
+        if(uring->ring < 0) {
+            ssize_t res = pread(uring->file, data + read, size - read, offset + read);
+            if(res <= 0) {
+                break;
+            }
+            read += (uint64_t) res;
+            continue;
+        }
+
+        uint64_t remaining = size - read;
+        uint64_t total = remaining < (uint64_t) uring->depth * LASER_URING_SEGMENT_SIZE ? remaining: (uint64_t) uring->depth * LASER_URING_SEGMENT_SIZE;
+        uint32_t count = (uint32_t) ((total + LASER_URING_SEGMENT_SIZE - 1) / LASER_URING_SEGMENT_SIZE);
+        uint64_t last_size = total - (uint64_t) (count - 1) * LASER_URING_SEGMENT_SIZE;
+        int64_t res = _laser_uring_batch(uring, data + read, offset + read, LASER_URING_SEGMENT_SIZE, count, last_size, 0);
+        if(res <= 0) {
+            break;
+        }
+        read += (uint64_t) res;
+        if((uint64_t) res < total) {
+            break;
+        }
+    }
+    return read;
+}
+
+static uint64_t _laser_uring_read_bounce(laserUring* uring, uint8_t* data, uint64_t size, uint64_t offset) {
+    uint64_t align = LASER_URING_ALIGNMENT;
+    uint32_t depth = uring->ring < 0 ? 1: uring->depth;
+    uint64_t segment = (uring->bounce_size / depth) & ~(align - 1);
+    uint64_t read = 0;
+    while(read < size) {
+        uint64_t start = (offset + read) & ~(align - 1);
+        uint64_t skip = (offset + read) - start;
+        uint64_t total = ((skip + (size - read) + align - 1) & ~(align - 1));
+        total = total > segment * depth ? segment * depth: total;
+
+        int64_t res = 0;
+        if(uring->ring < 0) {
+            ssize_t bytes = pread(uring->file, uring->bounce, total, start);
+            res = bytes < 0 ? -1: (int64_t) bytes;
+        } else {
+            uint32_t count = (uint32_t) ((total + segment - 1) / segment);
+            uint64_t last_size = total - (uint64_t) (count - 1) * segment;
+            res = _laser_uring_batch(uring, uring->bounce, start, segment, count, last_size, (uring->flags & LASER_URING_REGISTER_BUFFERS) != 0);
+        }
+        if(res <= (int64_t) skip) {
+            break;
+        }
+
+        uint64_t available = (uint64_t) res - skip;
+        uint64_t copy = available < (size - read) ? available: (size - read);
+        memcpy(data + read, uring->bounce + skip, copy);
+        read += copy;
+        if((uint64_t) res < total) {
+            break;
+        }
+    }
+    return read;
+}
+
+laserResult laser_uring_open(laserUring* uring, const char* path, uint32_t depth, uint32_t flags, void* bounce, uint64_t bounce_size) {
+    memset(uring, 0, sizeof(*uring));
+    uring->ring = -1;
+    uring->depth = depth < 1 ? 1: (depth > LASER_URING_MAX_DEPTH ? LASER_URING_MAX_DEPTH: depth);
+    uring->flags = flags;
+    uring->bounce = (uint8_t*) bounce;
+    uring->bounce_size = bounce_size;
+    if((flags & (LASER_URING_DIRECT | LASER_URING_REGISTER_BUFFERS)) &&
+            (!bounce || ((uintptr_t) bounce & (LASER_URING_ALIGNMENT - 1)) || bounce_size < (uint64_t) uring->depth * LASER_URING_ALIGNMENT)) {
+        return LASER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    uring->file = open(path, O_RDONLY | ((flags & LASER_URING_DIRECT) ? O_DIRECT: 0));
+    if(uring->file < 0) {
+        return LASER_ERROR_IO_READ;
+    }
+    _laser_uring_setup(uring);
+    return LASER_SUCCESS;
+}
+
+uint64_t laser_uring_read(void* usr, void* data, uint64_t size, uint64_t offset) {
+    laserUring* uring = (laserUring*) usr;
+    if(uring->flags & (LASER_URING_DIRECT | LASER_URING_REGISTER_BUFFERS)) {
+        return _laser_uring_read_bounce(uring, (uint8_t*) data, size, offset);
+    }
+    return _laser_uring_read_direct(uring, (uint8_t*) data, size, offset);
+}
+
+void laser_uring_close(laserUring* uring) {
+    _laser_uring_unmap(uring);
+    if(uring->file >= 0) {
+        close(uring->file);
+    }
+    uring->file = -1;
+}
+#endif
+
+#if defined(LASER_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static uint64_t _laser_map_read(void* usr, void* data, uint64_t size, uint64_t offset) {
+    laserMap* map = (laserMap*) usr;
+    uint64_t read = 0;
+    while(read < size) {
+        ssize_t res = pread(map->fd, ((uint8_t*) data) + read, size - read, (off_t) (offset + read));
+        if(res <= 0) {
+            break;
+        }
+        read += (uint64_t) res;
+    }
+    return read;
+}
+
+static void _laser_map_advise(const laserMap* map, uint8_t* base, uint64_t offset, uint64_t length) {
+    uint64_t page_size = (uint64_t) sysconf(_SC_PAGESIZE);
+    uint64_t start = offset & ~(page_size - 1);
+    uint8_t* address = base + start;
+    length += offset - start;
+
+    if(map->flags & LASER_MAP_SEQUENTIAL) {
+        madvise(address, length, MADV_SEQUENTIAL);
+    }
+    if(map->flags & LASER_MAP_RANDOM) {
+        madvise(address, length, MADV_RANDOM);
+    }
+    if(map->flags & LASER_MAP_WILLNEED) {
+        madvise(address, length, MADV_WILLNEED);
+    }
+#if defined(MADV_HUGEPAGE)
+    if(map->flags & LASER_MAP_HUGE_PAGES) {
+        madvise(address, length, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+laserResult laser_map_open(laserMap* map, const char* path, uint32_t flags, uint64_t window_size) {
+    struct stat s;
+    map->fd = open(path, O_RDONLY);
+    map->flags = flags;
+    map->base = 0;
+    map->length = 0;
+    if(map->fd < 0 || fstat(map->fd, &s) != 0) {
+        laser_map_close(map);
+        return LASER_ERROR_IO_READ;
+    }
+
+    uint64_t page_size = (uint64_t) sysconf(_SC_PAGESIZE);
+    map->file_size = (uint64_t) s.st_size;
+    map->window_size = (window_size + page_size - 1) & ~(page_size - 1);
+
+    laserResult res = LASER_SUCCESS;
+    if(map->window_size && map->window_size < map->file_size) {
+        if((res = laser_open_from_io(&map->file, _laser_map_read, (void*) map)) != LASER_SUCCESS) {
+            laser_map_close(map);
+        } else if(!_laser_points_fit(&map->file.info, map->file_size)) {
+            laser_map_close(map);
+            res = LASER_ERROR_INVALID_FILE;
+        } else if(map->window_size < map->file.info.point_size + page_size) {
+            laser_map_close(map);
+            res = LASER_ERROR_BUFFER_TOO_SMALL;
+        }
+        return res;
+    }
+
+    void* base = mmap(0, map->file_size, PROT_READ, MAP_PRIVATE, map->fd, 0);
+    if(base == MAP_FAILED) {
+        laser_map_close(map);
+        return LASER_ERROR_IO_READ;
+    }
+    map->base = (uint8_t*) base;
+    map->length = map->file_size;
+    map->window_size = 0;
+
+    if((res = laser_open_from_mem(&map->file, base, map->file_size)) != LASER_SUCCESS) {
+        laser_map_close(map);
+        return res;
+    }
+
+    const laserInfo* info = &map->file.info;
+    _laser_map_advise(map, map->base, info->point_offset, info->point_count * info->point_size);
+    return LASER_SUCCESS;
+}
+
+laserResult laser_map_read_range(laserMap* map, const laserPlan* plan, void* points, uint64_t first, uint64_t count) {
+    if(plan->filter) {
+        return LASER_ERROR_FILTERED_PLAN;
+    } else if(!map->window_size || map->file.info.compressed) {
+        return laser_file_read_range(&map->file, plan, points, first, count);
+    }
+
+    const laserInfo* info = &map->file.info;
+    count = count == LASER_ALL_POINTS ? info->point_count: count;
+    if(first > info->point_count || count > info->point_count - first) {
+        return LASER_ERROR_INVALID_RANGE;
+    }
+
+    /* Pages past the end of the file fault with `SIGBUS` instead of failing `mmap`, so a window must not reach them. */
+    struct stat s;
+    if(fstat(map->fd, &s) != 0) {
+        return LASER_ERROR_IO_READ;
+    }
+    map->file_size = (uint64_t) s.st_size;
+
+    uint64_t page_size = (uint64_t) sysconf(_SC_PAGESIZE);
+    uint64_t index = 0;
+    laserResult res = LASER_SUCCESS;
+    while(count > 0 && res == LASER_SUCCESS) {
+        uint64_t offset = info->point_offset + first * info->point_size;
+        uint64_t start = offset & ~(page_size - 1);
+        uint64_t window_count = (map->window_size - (offset - start)) / info->point_size;
+        window_count = window_count > count ? count: window_count;
+
+        uint64_t length = (offset - start) + window_count * info->point_size;
+        if(start > map->file_size || length > map->file_size - start) {
+            return LASER_ERROR_INVALID_FILE;
+        }
+        void* base = mmap(0, length, PROT_READ, MAP_PRIVATE, map->fd, (off_t) start);
+        if(base == MAP_FAILED) {
+            return LASER_ERROR_IO_READ;
+        }
+        _laser_map_advise(map, (uint8_t*) base, offset - start, window_count * info->point_size);
+
+        res = _laser_read_attribs_from_mem(points, index, plan, info, ((uint8_t*) base) + (offset - start), window_count * info->point_size, 0, window_count);
+        munmap(base, length);
+        index += window_count;
+        first += window_count;
+        count -= window_count;
+    }
+    return res;
+}
+
+laserResult laser_map_open_columnar(laserMap* map, laserColumnar* columnar, const char* path) {
+    struct stat s;
+    map->fd = open(path, O_RDONLY);
+    map->flags = 0;
+    map->base = 0;
+    map->length = 0;
+    map->window_size = 0;
+    if(map->fd < 0 || fstat(map->fd, &s) != 0) {
+        laser_map_close(map);
+        return LASER_ERROR_IO_READ;
+    }
+
+    map->file_size = (uint64_t) s.st_size;
+    void* base = map->file_size ? mmap(0, map->file_size, PROT_READ, MAP_PRIVATE, map->fd, 0): MAP_FAILED;
+    if(base == MAP_FAILED) {
+        laser_map_close(map);
+        return LASER_ERROR_IO_READ;
+    }
+    map->base = (uint8_t*) base;
+    map->length = map->file_size;
+
+    laserResult res = laser_columnar_open(columnar, base, map->file_size);
+    if(res != LASER_SUCCESS) {
+        laser_map_close(map);
+    }
+    return res;
+}
+
+void laser_map_close(laserMap* map) {
+    if(map->base) {
+        munmap(map->base, map->length);
+    }
+    if(map->fd >= 0) {
+        close(map->fd);
+    }
+    map->base = 0;
+    map->length = 0;
+    map->fd = -1;
 }
+#endif
 
 const char* laser_result_str(laserResult res) {
     switch(res) {
         case LASER_SUCCESS: return "Success";
         case LASER_ERROR_INVALID_FILE: return "Unknown file format";
         case LASER_ERROR_INVALID_RANGE: return "Invalid point range";
-        case LASER_ERROR_VERSION_UNSUPPORTED: return "Unsupported version, supported versions: 1.0, 1.1, 1.2 and 1.3";
-        case LASER_ERROR_FORMAT_UNSUPPORTED: return "Unknown point format, known formats: 0, 1, 2, 3, 4 and 5";
+        case LASER_ERROR_VERSION_UNSUPPORTED: return "Unsupported version, supported versions: 1.0, 1.1, 1.2, 1.3 and 1.4";
+        case LASER_ERROR_FORMAT_UNSUPPORTED: return "Unknown point format, known formats: 0 - 10";
         case LASER_ERROR_IO_READ: return "Truncated read";
+        case LASER_ERROR_BUFFER_TOO_SMALL: return "Buffer too small";
+        case LASER_ERROR_IO_WRITE: return "Truncated write";
+        case LASER_ERROR_FILTERED_PLAN: return "Plan has a filter or sample, read it with laser_file_read_filtered";
         default: return "Unknown error";
     }
 }
@@ -0,0 +1,226 @@
+/*
+ *  `laser.hpp`
+ *
+ *  USAGE:
+ *      #define LASER_IMPL
+ *      #include "laser.hpp"
+ *
+ *      Header-only C++11 layer over `laser.h`, the implementation part is the same and still only required *once*.
+ *
+ *  LICENSE:
+ *      See end of `laser.h` for license information.
+ *
+ *  API:
+ *      `laser::layout<T>` - Specialized by the user, maps the fields of `T` to attributes with `LASER_FIELD`.
+ *      `laser::plan<T>` - A `laserPlan` compiled from the layout of `T`.
+ *      `laser::range<T>` - Lazily decodes a range of points in batches into a caller-provided buffer.
+ */
+
+#if !defined(LASER_HPP)
+#define LASER_HPP
+
+#include <stddef.h>
+#include <iterator>
+#include <type_traits>
+
+#include "laser.h"
+
+namespace laser {
+
+/* The type the reads decode each attribute into, as documented on `laserAttribType`. */
+template<laserAttribType Type> struct attrib_traits;
+
+#define _LASER_ATTRIB_TRAITS(attrib, decoded) \
+    template<> struct attrib_traits<LASER_ATTRIB_TYPE_##attrib> { typedef decoded type; };
+
+_LASER_ATTRIB_TRAITS(X, float)
+_LASER_ATTRIB_TRAITS(Y, float)
+_LASER_ATTRIB_TRAITS(Z, float)
+_LASER_ATTRIB_TRAITS(INTENSITY, uint16_t)
+_LASER_ATTRIB_TRAITS(FLAGS, uint8_t)
+_LASER_ATTRIB_TRAITS(CLASSIFICATION, uint8_t)
+_LASER_ATTRIB_TRAITS(SCAN_ANGLE, int8_t)
+_LASER_ATTRIB_TRAITS(USR, uint8_t)
+_LASER_ATTRIB_TRAITS(POINT_ID, uint16_t)
+_LASER_ATTRIB_TRAITS(GPS_TIME, double)
+_LASER_ATTRIB_TRAITS(RED, uint16_t)
+_LASER_ATTRIB_TRAITS(GREEN, uint16_t)
+_LASER_ATTRIB_TRAITS(BLUE, uint16_t)
+_LASER_ATTRIB_TRAITS(WAVEFORM_ID, uint8_t)
+_LASER_ATTRIB_TRAITS(WAVEFORM_OFFSET, uint64_t)
+_LASER_ATTRIB_TRAITS(WAVEFORM_SIZE, uint32_t)
+_LASER_ATTRIB_TRAITS(WAVEFORM_LOCATION, float)
+_LASER_ATTRIB_TRAITS(X_TIME, float)
+_LASER_ATTRIB_TRAITS(Y_TIME, float)
+_LASER_ATTRIB_TRAITS(Z_TIME, float)
+_LASER_ATTRIB_TRAITS(NIR, uint16_t)
+_LASER_ATTRIB_TRAITS(EXTENDED_RETURNS, uint8_t)
+_LASER_ATTRIB_TRAITS(EXTENDED_CLASSIFICATION, uint8_t)
+_LASER_ATTRIB_TRAITS(CLASSIFICATION_FLAGS, uint8_t)
+_LASER_ATTRIB_TRAITS(SCANNER_CHANNEL, uint8_t)
+_LASER_ATTRIB_TRAITS(SCAN_ANGLE_DEGREES, float)
+_LASER_ATTRIB_TRAITS(GPS_TIME_RELATIVE, float)
+_LASER_ATTRIB_TRAITS(RGB8, uint32_t)
+
+#undef _LASER_ATTRIB_TRAITS
+
+/*
+ *  One field of a layout. Arithmetic members must have exactly the decoded type, anything else (bit-field structs like
+ *  those of `laserPoint`, enums) only its size.
+ */
+template<laserAttribType Type, typename Member, size_t Offset>
+struct field {
+    typedef typename attrib_traits<Type>::type decoded;
+    static_assert(sizeof(Member) == sizeof(decoded), "member size doesn't match the decoded attribute");
+    static_assert(!std::is_arithmetic<Member>::value || std::is_same<Member, decoded>::value, "member type doesn't match the decoded attribute");
+
+    static const laserAttribType type = Type;
+    static const size_t offset = Offset;
+};
+
+#define LASER_FIELD(attrib, type, member) ::laser::field<LASER_ATTRIB_TYPE_##attrib, decltype(((type*) 0)->member), offsetof(type, member)>
+
+template<typename... Fields>
+struct fields {
+    static const size_t count = sizeof...(Fields);
+
+    /* Terminated by `LASER_ATTRIB_END`, built once per layout. */
+    static const laserAttrib* attribs() {
+        static const laserAttrib list[] = { { Fields::type, Fields::offset }..., LASER_ATTRIB_END };
+        return list;
+    }
+};
+
+/*
+ *  Specialize for each point type inside `namespace laser`, the plan then uses exactly these offsets and `sizeof(T)`:
+ *      struct Point { float x, y; uint8_t classification; };
+ *      template<> struct layout<Point> : fields<LASER_FIELD(X, Point, x), LASER_FIELD(Y, Point, y), LASER_FIELD(CLASSIFICATION, Point, classification)> {};
+ */
+template<typename T>
+struct layout;
+
+template<typename T>
+class plan {
+    static_assert(std::is_standard_layout<T>::value, "point types need a standard layout for `offsetof`");
+    static_assert(layout<T>::count > 0, "empty layout");
+
+public:
+    /* Attributes the format doesn't have are zero-filled, like the granular reads do. */
+    explicit plan(const laserFile& file) {
+        laser_plan_attribs(&plan_, &file, layout<T>::attribs(), sizeof(T));
+    }
+
+    laserResult read(const laserFile& file, T* points, uint64_t first, uint64_t count) const {
+        return laser_file_read_range(&file, &plan_, points, first, count);
+    }
+
+    void time_base(double time_base) {
+        laser_plan_time_base(&plan_, time_base);
+    }
+
+    const laserPlan* get() const {
+        return &plan_;
+    }
+
+private:
+    laserPlan plan_;
+};
+
+/*
+ *  Decodes `count` points from `first` in batches of up to `capacity`, each batch when the previous one is used up.
+ *  Iterating stops early on an error, which `result` then holds. A range is a single pass (input iterators), walk the
+ *  batches directly with `next` / `data` / `size` to hand whole blocks to vectorized code instead.
+ *
+ *  Example:
+ *      Point batch[4096];
+ *      laser::range<Point> points(file, batch, 4096);
+ *      for(const Point& point: points) {
+ *          ...
+ *      }
+ *      if(points.result() != LASER_SUCCESS) {
+ *          ...
+ *      }
+ */
+template<typename T>
+class range {
+public:
+    class iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        iterator(): range_(0), index_(0) {}
+        iterator(range* owner, uint64_t index): range_(owner), index_(index) {}
+
+        reference operator*() const { return range_->buffer_[index_]; }
+        pointer operator->() const { return range_->buffer_ + index_; }
+
+        /* Index of the current point in the file. */
+        uint64_t position() const { return range_->batch_first_ + index_; }
+
+        iterator& operator++() {
+            if(++index_ == range_->batch_size_) {
+                index_ = 0;
+                range_ = range_->next() ? range_: 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return range_ == other.range_ && index_ == other.index_; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        range* range_;
+        uint64_t index_;
+    };
+
+    range(const laserFile& file, T* buffer, uint64_t capacity, uint64_t first = 0, uint64_t count = LASER_ALL_POINTS):
+        file_(&file), plan_(file), buffer_(buffer), capacity_(capacity), next_(first),
+        last_(first + (count == LASER_ALL_POINTS ? (first < file.info.point_count ? file.info.point_count - first: 0): count)),
+        batch_first_(first), batch_size_(0), result_(capacity ? LASER_SUCCESS: LASER_ERROR_BUFFER_TOO_SMALL) {}
+
+    /* Decodes the first batch, `begin` is only meant to be called once. */
+    iterator begin() { return next() ? iterator(this, 0): iterator(); }
+    iterator end() { return iterator(); }
+
+    /* Decodes the next batch, `false` once the range is done or failed. */
+    bool next() {
+        batch_size_ = 0;
+        if(result_ != LASER_SUCCESS || next_ >= last_) {
+            return false;
+        }
+
+        uint64_t count = last_ - next_ < capacity_ ? last_ - next_: capacity_;
+        if((result_ = plan_.read(*file_, buffer_, next_, count)) != LASER_SUCCESS) {
+            return false;
+        }
+        batch_first_ = next_;
+        batch_size_ = count;
+        next_ += count;
+        return true;
+    }
+
+    const T* data() const { return buffer_; }
+    uint64_t size() const { return batch_size_; }
+    uint64_t first() const { return batch_first_; }
+    laserResult result() const { return result_; }
+    laser::plan<T>& plan() { return plan_; }
+
+private:
+    const laserFile* file_;
+    laser::plan<T> plan_;
+    T* buffer_;
+    uint64_t capacity_;
+    uint64_t next_;
+    uint64_t last_;
+    uint64_t batch_first_;
+    uint64_t batch_size_;
+    laserResult result_;
+};
+
+}
+
+#endif
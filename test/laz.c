@@ -0,0 +1,133 @@
+/*
+ *  `laz.c` - Checks the LAZ decoder against LASzip-produced files.
+ *
+ *  USAGE:
+ *      cc -O2 -o laz_test test/laz.c
+ *      laz_test FILE.laz FILE.las [FILE.laz FILE.las ...]
+ *
+ *  Every pair is a LAS file (point formats 0 - 3) and the same file compressed by LASzip, e.g.
+ *  `laszip -i FILE.las -o FILE.laz`. Both are read with every attribute of the format, once whole and once in ranges
+ *  starting inside chunks, the decoded points must match byte for byte. Returns non-zero on any mismatch.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LASER_IMPL
+#include "../laser.h"
+
+#define TEST_POINT_SIZE 34
+
+static const laserAttribType TEST_TYPES[] = {
+    LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_INTENSITY, LASER_ATTRIB_TYPE_FLAGS,
+    LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_ATTRIB_TYPE_SCAN_ANGLE, LASER_ATTRIB_TYPE_USR, LASER_ATTRIB_TYPE_POINT_ID,
+    LASER_ATTRIB_TYPE_GPS_TIME, LASER_ATTRIB_TYPE_RED, LASER_ATTRIB_TYPE_GREEN, LASER_ATTRIB_TYPE_BLUE,
+};
+
+static const uint64_t TEST_OFFSETS[] = { 0, 4, 8, 12, 14, 15, 16, 17, 18, 20, 28, 30, 32 };
+
+static void* test_load(const char* path, uint64_t* size) {
+    FILE* file = fopen(path, "rb");
+    if(!file) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = (uint64_t) ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void* data = malloc(*size);
+    if(data && fread(data, 1, *size, file) != *size) {
+        free(data);
+        data = 0;
+    }
+    fclose(file);
+    return data;
+}
+
+static int test_pair(const char* laz_path, const char* las_path) {
+    uint64_t laz_size = 0, las_size = 0;
+    void* laz_data = test_load(laz_path, &laz_size);
+    void* las_data = test_load(las_path, &las_size);
+    laserFile laz, las;
+    laserResult res = LASER_SUCCESS;
+    if(!laz_data || !las_data) {
+        printf("%s: can't load the pair\n", laz_path);
+        return 1;
+    } else if((res = laser_open_from_mem(&laz, laz_data, laz_size)) != LASER_SUCCESS || (res = laser_open_from_mem(&las, las_data, las_size)) != LASER_SUCCESS) {
+        printf("%s: %s\n", laz_path, laser_result_str(res));
+        return 1;
+    } else if(!laz.info.compressed || laz.info.point_format != las.info.point_format || laz.info.point_count != las.info.point_count) {
+        printf("%s: header doesn't match %s\n", laz_path, las_path);
+        return 1;
+    }
+
+    uint64_t decoders_size = 0;
+    laser_laz_size(&laz, 1, &decoders_size);
+    void* decoders = malloc(decoders_size);
+    if((res = laser_laz_attach(&laz, decoders, decoders_size, 1)) != LASER_SUCCESS) {
+        printf("%s: %s\n", laz_path, laser_result_str(res));
+        return 1;
+    }
+
+    laserAttrib attribs[sizeof(TEST_TYPES) / sizeof(TEST_TYPES[0]) + 1];
+    for(uint32_t i = 0; i < sizeof(TEST_TYPES) / sizeof(TEST_TYPES[0]); i++) {
+        attribs[i].type = TEST_TYPES[i];
+        attribs[i].offset = TEST_OFFSETS[i];
+    }
+    attribs[sizeof(TEST_TYPES) / sizeof(TEST_TYPES[0])].type = LASER_ATTRIB_TYPE_NONE;
+
+    laserPlan laz_plan, las_plan;
+    laser_plan_attribs(&laz_plan, &laz, attribs, TEST_POINT_SIZE);
+    laser_plan_attribs(&las_plan, &las, attribs, TEST_POINT_SIZE);
+
+    uint64_t count = las.info.point_count;
+    uint8_t* expected = (uint8_t*) calloc(count ? count: 1, TEST_POINT_SIZE);
+    uint8_t* decoded = (uint8_t*) calloc(count ? count: 1, TEST_POINT_SIZE);
+    int failed = (res = laser_file_read_range(&las, &las_plan, expected, 0, count)) != LASER_SUCCESS;
+
+    /* The whole file, then ranges with odd starts so most of them begin inside a chunk. */
+    uint64_t first = 0, step = count;
+    for(int pass = 0; !failed && pass < 2; pass++) {
+        for(first = 0; !failed && first < count; first += step) {
+            uint64_t length = count - first < step ? count - first: step;
+            memset(decoded, 0, length * TEST_POINT_SIZE);
+            if((res = laser_file_read_range(&laz, &laz_plan, decoded, first, length)) != LASER_SUCCESS) {
+                failed = 1;
+            } else {
+                for(uint64_t i = 0; i < length; i++) {
+                    if(memcmp(decoded + i * TEST_POINT_SIZE, expected + (first + i) * TEST_POINT_SIZE, TEST_POINT_SIZE)) {
+                        printf("%s: point %llu differs\n", laz_path, (unsigned long long) (first + i));
+                        failed = 1;
+                        break;
+                    }
+                }
+            }
+        }
+        step = count / 7 + 1;
+    }
+    if(res != LASER_SUCCESS) {
+        printf("%s: %s at point %llu\n", laz_path, laser_result_str(res), (unsigned long long) first);
+    } else if(!failed) {
+        printf("%s: %llu points of format %u match\n", laz_path, (unsigned long long) count, laz.info.point_format);
+    }
+
+    free(expected);
+    free(decoded);
+    free(decoders);
+    free(laz_data);
+    free(las_data);
+    return failed;
+}
+
+int main(int argc, const char** argv) {
+    if(argc < 3 || (argc - 1) % 2) {
+        printf("%s FILE.laz FILE.las [FILE.laz FILE.las ...]\n", argv[0]);
+        return -1;
+    }
+
+    int failed = 0;
+    for(int i = 1; i + 1 < argc; i += 2) {
+        failed |= test_pair(argv[i], argv[i + 1]);
+    }
+    return failed;
+}
@@ -0,0 +1,225 @@
+/*
+ *  `simd.c` - Checks the SSE2 kernels against the scalar ones.
+ *
+ *  USAGE:
+ *      cc -O2 -DLASER_NO_SIMD -c -o simd_scalar.o test/simd.c
+ *      cc -O2 -o simd_test test/simd.c simd_scalar.o
+ *      simd_test [POINTS]
+ *
+ *  The file is compiled twice, the copy built with `LASER_NO_SIMD` only provides `simd_scalar_write` and
+ *  `simd_scalar_read`, the other one the same entry points over the SSE2 kernels and `main`. Both copies of the library
+ *  are `LASER_STATIC`. For every point format (0 - 10) both writers quantize the same float and double coordinates,
+ *  including rounding ties and values past the int32 range, and must produce identical files. Both readers then decode
+ *  XYZ from that file into interleaved layouts of several strides and into packed and strided columns, at offsets and
+ *  counts which leave partial vectors, with stats attached. Outputs and stats must match byte for byte.
+ *  Returns non-zero on any mismatch. On CPUs without SSE2 both copies are scalar and the check is trivially met.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LASER_STATIC
+#define LASER_IMPL
+#include "../laser.h"
+
+#if defined(LASER_NO_SIMD)
+#define SIMD_ENTRY(name) simd_scalar_##name
+#else
+#define SIMD_ENTRY(name) simd_sse2_##name
+#endif
+
+enum {
+    SIMD_ATTRIBS = 0,
+    SIMD_COLUMNS = 1
+};
+
+typedef struct SimdSink {
+    uint8_t* data;
+    uint64_t capacity;
+    uint64_t size;
+} SimdSink;
+
+laserResult simd_scalar_write(uint32_t format, uint32_t flags, double scale, const void* xyz, uint64_t count, SimdSink* sink);
+laserResult simd_scalar_read(const SimdSink* sink, uint32_t layout, uint64_t stride, uint64_t first, uint64_t count, uint8_t* points, laserStats* stats);
+laserResult simd_sse2_write(uint32_t format, uint32_t flags, double scale, const void* xyz, uint64_t count, SimdSink* sink);
+laserResult simd_sse2_read(const SimdSink* sink, uint32_t layout, uint64_t stride, uint64_t first, uint64_t count, uint8_t* points, laserStats* stats);
+
+static uint64_t simd_sink_write(void* usr, const void* data, uint64_t size, uint64_t offset) {
+    SimdSink* sink = (SimdSink*) usr;
+    if(offset + size > sink->capacity) {
+        return 0;
+    }
+    memcpy(sink->data + offset, data, size);
+    sink->size = offset + size > sink->size ? offset + size: sink->size;
+    return size;
+}
+
+/* `xyz` holds `count` packed float[3] or, with `LASER_WRITER_DOUBLE_XYZ`, double[3]. */
+laserResult SIMD_ENTRY(write)(uint32_t format, uint32_t flags, double scale, const void* xyz, uint64_t count, SimdSink* sink) {
+    uint64_t size = (flags & LASER_WRITER_DOUBLE_XYZ) ? sizeof(double): sizeof(float);
+    laserWriterInfo info;
+    memset(&info, 0, sizeof(info));
+    info.point_format = format;
+    info.flags = flags;
+    info.scale_x = scale;
+    info.scale_y = scale;
+    info.scale_z = scale;
+    info.offset_x = 1000.0;
+    info.offset_y = -2000.0;
+
+    laserAttrib attribs[] = { { LASER_ATTRIB_TYPE_X, 0 }, { LASER_ATTRIB_TYPE_Y, size }, { LASER_ATTRIB_TYPE_Z, 2 * size }, LASER_ATTRIB_END };
+    static uint8_t buffer[1 << 16];
+    laserWriter writer;
+    sink->size = 0;
+    laser_writer_begin(&writer, &info, buffer, sizeof(buffer), simd_sink_write, (void*) sink);
+    laser_write_attribs(&writer, xyz, 3 * size, attribs, count);
+    return laser_writer_finish(&writer);
+}
+
+/* Interleaved layouts put X, Y and Z at 0, 4 and 8 of `stride`, columns follow each other in `points`. */
+laserResult SIMD_ENTRY(read)(const SimdSink* sink, uint32_t layout, uint64_t stride, uint64_t first, uint64_t count, uint8_t* points, laserStats* stats) {
+    laserFile file;
+    laserResult res = laser_open_from_mem(&file, sink->data, sink->size);
+    if(res != LASER_SUCCESS) {
+        return res;
+    }
+
+    laserPlan plan;
+    if(layout == SIMD_ATTRIBS) {
+        laserAttrib attribs[] = { { LASER_ATTRIB_TYPE_X, 0 }, { LASER_ATTRIB_TYPE_Y, 4 }, { LASER_ATTRIB_TYPE_Z, 8 }, LASER_ATTRIB_END };
+        laser_plan_attribs(&plan, &file, attribs, stride);
+    } else {
+        uint64_t column_size = count * (stride == LASER_DEFAULT_STRIDE ? sizeof(float): stride);
+        laserColumn columns[] = {
+            { LASER_ATTRIB_TYPE_X, points, stride },
+            { LASER_ATTRIB_TYPE_Y, points + column_size, stride },
+            { LASER_ATTRIB_TYPE_Z, points + 2 * column_size, stride },
+            LASER_COLUMN_END
+        };
+        laser_plan_columns(&plan, &file, columns);
+    }
+    laser_plan_stats(&plan, stats, 1);
+    return laser_file_read_range(&file, &plan, layout == SIMD_ATTRIBS ? points: 0, first, count);
+}
+
+#if !defined(LASER_NO_SIMD)
+
+#define SIMD_MAX_STRIDE 32
+
+static const uint64_t SIMD_STRIDES[] = { 12, 13, 16, 20, 32 };
+static const uint64_t SIMD_COLUMN_STRIDES[] = { LASER_DEFAULT_STRIDE, 8 };
+static const uint64_t SIMD_FIRSTS[] = { 0, 1, 3 };
+
+static uint64_t simd_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Mostly regular coordinates, some exactly halfway between two steps of `scale` and some beyond the int32 range. */
+static double simd_coordinate(uint64_t* state, double scale, double offset) {
+    uint64_t r = simd_random(state);
+    int64_t steps = (int64_t) (r >> 40) - (1 << 23);
+    switch(r & 15) {
+        case 0: return offset + ((double) steps + 0.5) * scale;
+        case 1: return offset - ((double) steps + 0.5) * scale;
+        case 2: return offset + 3.0e9 * scale * ((r & 16) ? 1.0: -1.0);
+        default: return offset + (double) steps * scale + (double) (r & 0xFFFF) / 65536.0 * scale;
+    }
+}
+
+static int simd_compare(const char* what, uint32_t format, uint64_t case_index, const void* a, const void* b, uint64_t size) {
+    if(memcmp(a, b, size) != 0) {
+        printf("format %u: %s %llu differs\n", format, what, (unsigned long long) case_index);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, const char** argv) {
+    uint64_t count = argc > 1 ? strtoull(argv[1], 0, 10): 10007;
+    count = count < 8 ? 8: count;
+
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    double* wide = (double*) malloc(count * 3 * sizeof(double));
+    float* narrow = (float*) malloc(count * 3 * sizeof(float));
+    SimdSink sinks[2];
+    for(uint32_t i = 0; i < 2; i++) {
+        sinks[i].capacity = 1024 + count * 80;
+        sinks[i].data = (uint8_t*) malloc(sinks[i].capacity);
+        sinks[i].size = 0;
+    }
+    uint8_t* points[2];
+    points[0] = (uint8_t*) malloc(count * 3 * SIMD_MAX_STRIDE);
+    points[1] = (uint8_t*) malloc(count * 3 * SIMD_MAX_STRIDE);
+
+    int failed = 0;
+    for(uint32_t format = 0; format <= 10; format++) {
+        uint64_t cases = 0;
+        for(uint32_t variant = 0; variant < 4; variant++) {
+            uint32_t flags = (variant & 1) ? LASER_WRITER_DOUBLE_XYZ: 0;
+            double scale = (variant & 2) ? 0.5: 0.01;
+            for(uint64_t i = 0; i < count; i++) {
+                wide[3 * i + 0] = simd_coordinate(&state, scale, 1000.0);
+                wide[3 * i + 1] = simd_coordinate(&state, scale, -2000.0);
+                wide[3 * i + 2] = simd_coordinate(&state, scale, 0.0);
+            }
+            for(uint64_t i = 0; i < 3 * count; i++) {
+                narrow[i] = (float) wide[i];
+            }
+
+            const void* xyz = flags ? (const void*) wide: (const void*) narrow;
+            laserResult res = simd_scalar_write(format, flags, scale, xyz, count, &sinks[0]);
+            laserResult other = simd_sse2_write(format, flags, scale, xyz, count, &sinks[1]);
+            if(res != LASER_SUCCESS || other != LASER_SUCCESS) {
+                printf("format %u: write failed, %s / %s\n", format, laser_result_str(res), laser_result_str(other));
+                failed = 1;
+                continue;
+            }
+            failed |= sinks[0].size != sinks[1].size || simd_compare("written file", format, variant, sinks[0].data, sinks[1].data, sinks[0].size);
+            cases++;
+
+            /* Both readers decode the scalar writer's file. */
+            for(uint32_t layout = SIMD_ATTRIBS; layout <= SIMD_COLUMNS; layout++) {
+                const uint64_t* strides = layout == SIMD_ATTRIBS ? SIMD_STRIDES: SIMD_COLUMN_STRIDES;
+                uint64_t stride_count = layout == SIMD_ATTRIBS ? sizeof(SIMD_STRIDES) / sizeof(SIMD_STRIDES[0]): sizeof(SIMD_COLUMN_STRIDES) / sizeof(SIMD_COLUMN_STRIDES[0]);
+                for(uint64_t s = 0; s < stride_count; s++) {
+                    for(uint64_t f = 0; f < sizeof(SIMD_FIRSTS) / sizeof(SIMD_FIRSTS[0]); f++) {
+                        uint64_t first = SIMD_FIRSTS[f];
+                        uint64_t length = count - first - f;
+                        laserStats stats[2];
+                        for(uint32_t i = 0; i < 2; i++) {
+                            memset(points[i], 0xA5, count * 3 * SIMD_MAX_STRIDE);
+                            memset(&stats[i], 0, sizeof(stats[i]));
+                            laser_stats_init(&stats[i]);
+                        }
+                        res = simd_scalar_read(&sinks[0], layout, strides[s], first, length, points[0], &stats[0]);
+                        other = simd_sse2_read(&sinks[0], layout, strides[s], first, length, points[1], &stats[1]);
+                        if(res != LASER_SUCCESS || other != LASER_SUCCESS) {
+                            printf("format %u: read failed, %s / %s\n", format, laser_result_str(res), laser_result_str(other));
+                            failed = 1;
+                            continue;
+                        }
+                        failed |= simd_compare("decode", format, cases, points[0], points[1], count * 3 * SIMD_MAX_STRIDE);
+                        failed |= simd_compare("stats", format, cases, &stats[0], &stats[1], sizeof(stats[0]));
+                        cases++;
+                    }
+                }
+            }
+        }
+        printf("format %u: %llu cases checked\n", format, (unsigned long long) cases);
+    }
+
+    free(wide);
+    free(narrow);
+    free(sinks[0].data);
+    free(sinks[1].data);
+    free(points[0]);
+    free(points[1]);
+    printf(failed ? "MISMATCH\n": "scalar and SSE2 agree\n");
+    return failed;
+}
+
+#endif
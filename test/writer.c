@@ -0,0 +1,398 @@
+/*
+ *  `writer.c` - Round trips every point format through the writer and the reader.
+ *
+ *  USAGE:
+ *      cc -O2 -o writer_test test/writer.c
+ *      writer_test [POINTS]
+ *
+ *  For every point format (0 - 10) a file of random records is read with every attribute the format stores into a
+ *  packed layout, written back from that layout, from one column per attribute and, with `LASER_WRITER_DOUBLE_XYZ`,
+ *  from a layout with double coordinates, then read again. All three reads must match the first one byte for byte and
+ *  the headers must carry the point count and the bounds of the points. Writes go through a small buffer in uneven
+ *  batches, so records are flushed across many callbacks. Ranges whose end wraps around must be rejected by the reader.
+ *  Headers must carry the version that introduced the format (1.2 at least) and, for formats 6 - 10, the WKT bit.
+ *  Returns non-zero on any mismatch.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LASER_IMPL
+#include "../laser.h"
+
+#define TEST_MAX_ATTRIBS 20
+#define TEST_BUFFER_SIZE 4099
+
+/* Every attribute a format stores, the extended ones for formats 6 - 10 as they share fields with the legacy ones. */
+static const laserAttribType TEST_LEGACY[] = {
+    LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_INTENSITY, LASER_ATTRIB_TYPE_FLAGS,
+    LASER_ATTRIB_TYPE_CLASSIFICATION, LASER_ATTRIB_TYPE_SCAN_ANGLE, LASER_ATTRIB_TYPE_USR, LASER_ATTRIB_TYPE_POINT_ID,
+    LASER_ATTRIB_TYPE_GPS_TIME, LASER_ATTRIB_TYPE_RED, LASER_ATTRIB_TYPE_GREEN, LASER_ATTRIB_TYPE_BLUE,
+    LASER_ATTRIB_TYPE_WAVEFORM_ID, LASER_ATTRIB_TYPE_WAVEFORM_OFFSET, LASER_ATTRIB_TYPE_WAVEFORM_SIZE,
+    LASER_ATTRIB_TYPE_WAVEFORM_LOCATION, LASER_ATTRIB_TYPE_X_TIME, LASER_ATTRIB_TYPE_Y_TIME, LASER_ATTRIB_TYPE_Z_TIME,
+};
+
+static const laserAttribType TEST_EXTENDED[] = {
+    LASER_ATTRIB_TYPE_X, LASER_ATTRIB_TYPE_Y, LASER_ATTRIB_TYPE_Z, LASER_ATTRIB_TYPE_INTENSITY,
+    LASER_ATTRIB_TYPE_EXTENDED_RETURNS, LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION, LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS,
+    LASER_ATTRIB_TYPE_SCANNER_CHANNEL, LASER_ATTRIB_TYPE_SCAN_ANGLE_DEGREES, LASER_ATTRIB_TYPE_USR, LASER_ATTRIB_TYPE_POINT_ID,
+    LASER_ATTRIB_TYPE_GPS_TIME, LASER_ATTRIB_TYPE_RED, LASER_ATTRIB_TYPE_GREEN, LASER_ATTRIB_TYPE_BLUE, LASER_ATTRIB_TYPE_NIR,
+    LASER_ATTRIB_TYPE_WAVEFORM_ID, LASER_ATTRIB_TYPE_WAVEFORM_OFFSET, LASER_ATTRIB_TYPE_WAVEFORM_SIZE,
+    LASER_ATTRIB_TYPE_WAVEFORM_LOCATION,
+};
+
+typedef struct TestSink {
+    uint8_t* data;
+    uint64_t capacity;
+    uint64_t size;
+} TestSink;
+
+/* Decoded sizes, as documented on `laserAttribType`. */
+static uint64_t test_type_size(laserAttribType type) {
+    switch(type) {
+        case LASER_ATTRIB_TYPE_FLAGS: case LASER_ATTRIB_TYPE_CLASSIFICATION: case LASER_ATTRIB_TYPE_SCAN_ANGLE:
+        case LASER_ATTRIB_TYPE_USR: case LASER_ATTRIB_TYPE_WAVEFORM_ID: case LASER_ATTRIB_TYPE_EXTENDED_RETURNS:
+        case LASER_ATTRIB_TYPE_EXTENDED_CLASSIFICATION: case LASER_ATTRIB_TYPE_CLASSIFICATION_FLAGS:
+        case LASER_ATTRIB_TYPE_SCANNER_CHANNEL:
+            return 1;
+        case LASER_ATTRIB_TYPE_INTENSITY: case LASER_ATTRIB_TYPE_POINT_ID: case LASER_ATTRIB_TYPE_RED:
+        case LASER_ATTRIB_TYPE_GREEN: case LASER_ATTRIB_TYPE_BLUE: case LASER_ATTRIB_TYPE_NIR:
+            return 2;
+        case LASER_ATTRIB_TYPE_GPS_TIME: case LASER_ATTRIB_TYPE_WAVEFORM_OFFSET:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+static int test_format_has(uint32_t format, laserAttribType type) {
+    switch(type) {
+        case LASER_ATTRIB_TYPE_GPS_TIME:
+            return format == 1 || format >= 3;
+        case LASER_ATTRIB_TYPE_RED: case LASER_ATTRIB_TYPE_GREEN: case LASER_ATTRIB_TYPE_BLUE:
+            return format == 2 || format == 3 || format == 5 || format == 7 || format == 8 || format == 10;
+        case LASER_ATTRIB_TYPE_NIR:
+            return format == 8 || format == 10;
+        case LASER_ATTRIB_TYPE_WAVEFORM_ID: case LASER_ATTRIB_TYPE_WAVEFORM_OFFSET: case LASER_ATTRIB_TYPE_WAVEFORM_SIZE:
+        case LASER_ATTRIB_TYPE_WAVEFORM_LOCATION: case LASER_ATTRIB_TYPE_X_TIME: case LASER_ATTRIB_TYPE_Y_TIME:
+        case LASER_ATTRIB_TYPE_Z_TIME:
+            return format == 4 || format == 5 || format == 9 || format == 10;
+        default:
+            return 1;
+    }
+}
+
+/* Packs the attributes of `format` from `xyz_size` wide coordinates on, returns the stride. */
+static uint64_t test_attribs(laserAttrib* attribs, uint32_t format, uint64_t xyz_size) {
+    const laserAttribType* types = format >= 6 ? TEST_EXTENDED: TEST_LEGACY;
+    uint32_t count = 0;
+    uint64_t offset = 0;
+    for(uint32_t i = 0; i < TEST_MAX_ATTRIBS; i++) {
+        if(test_format_has(format, types[i])) {
+            attribs[count].type = types[i];
+            attribs[count].offset = offset;
+            offset += i < 3 ? xyz_size: test_type_size(types[i]);
+            count++;
+        }
+    }
+    attribs[count].type = LASER_ATTRIB_TYPE_NONE;
+    attribs[count].offset = 0;
+    return offset;
+}
+
+static uint64_t test_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static uint64_t test_sink_write(void* usr, const void* data, uint64_t size, uint64_t offset) {
+    TestSink* sink = (TestSink*) usr;
+    if(offset + size > sink->capacity) {
+        return 0;
+    }
+    memcpy(sink->data + offset, data, size);
+    sink->size = offset + size > sink->size ? offset + size: sink->size;
+    return size;
+}
+
+static void test_info(laserWriterInfo* info, uint32_t format, uint32_t flags) {
+    memset(info, 0, sizeof(*info));
+    info->point_format = format;
+    info->flags = flags;
+    info->scale_x = 0.01;
+    info->scale_y = 0.01;
+    info->scale_z = 0.001;
+    info->offset_x = 1000.0;
+    info->offset_y = -500.0;
+}
+
+/*
+ *  Random records: coordinates stay within 2^20 steps so the float reads are exact, floating point fields are
+ *  finite and scan angles valid. Everything else is random bits.
+ */
+static laserResult test_source(TestSink* sink, uint32_t format, uint64_t count, uint64_t* state) {
+    laserWriterInfo info;
+    test_info(&info, format, 0);
+    uint8_t buffer[TEST_BUFFER_SIZE];
+    laserWriter writer;
+    laser_writer_begin(&writer, &info, buffer, sizeof(buffer), test_sink_write, sink);
+    for(uint64_t i = 0; i < count; i++) {
+        float zero[3] = { 1000.0f, -500.0f, 0.0f };
+        laserAttrib attribs[] = { { LASER_ATTRIB_TYPE_X, 0 }, { LASER_ATTRIB_TYPE_Y, 4 }, { LASER_ATTRIB_TYPE_Z, 8 }, LASER_ATTRIB_END };
+        laser_write_attribs(&writer, zero, sizeof(zero), attribs, 1);
+    }
+    laserResult res = laser_writer_finish(&writer);
+
+    laserFile file;
+    if(res != LASER_SUCCESS || (res = laser_open_from_mem(&file, sink->data, sink->size)) != LASER_SUCCESS) {
+        return res;
+    }
+    for(uint64_t i = 0; i < count; i++) {
+        uint8_t* record = sink->data + file.info.point_offset + i * file.info.point_size;
+        for(uint32_t j = 0; j < file.info.point_size; j++) {
+            record[j] = (uint8_t) test_random(state);
+        }
+        for(uint32_t axis = 0; axis < 3; axis++) {
+            int32_t value = (int32_t) (test_random(state) % (1u << 21)) - (1 << 20);
+            memcpy(record + 4 * axis, &value, 4);
+        }
+
+        /* LAS 1.4 scan angles are valid within +-30000 steps (+-180 degrees), the writer clamps to that. */
+        if(format >= 6) {
+            int16_t scan_angle = (int16_t) ((int32_t) (test_random(state) % 60001) - 30000);
+            memcpy(record + 18, &scan_angle, 2);
+        }
+
+        /* GPS time and the float waveform fields, where the format has them. */
+        uint32_t time = format >= 6 ? 22: 20;
+        if(format == 1 || format >= 3) {
+            double gps_time = (double) (test_random(state) % 1000000000) / 1024.0;
+            memcpy(record + time, &gps_time, 8);
+        }
+        if(format == 4 || format == 5 || format == 9 || format == 10) {
+            uint32_t waveform = format == 4 ? 28: (format == 5 ? 34: (format == 9 ? 30: 38));
+            for(uint32_t j = 0; j < 4; j++) {
+                float value = (float) ((int64_t) (test_random(state) % 2000001) - 1000000) / 256.0f;
+                memcpy(record + waveform + 13 + 4 * j, &value, 4);
+            }
+        }
+    }
+    return LASER_SUCCESS;
+}
+
+static laserResult test_read(const TestSink* sink, const laserAttrib* attribs, uint64_t stride, uint8_t* points, laserInfo* info) {
+    laserFile file;
+    laserResult res = laser_open_from_mem(&file, sink->data, sink->size);
+    if(res != LASER_SUCCESS) {
+        return res;
+    }
+    *info = file.info;
+    laserPlan plan;
+    laser_plan_attribs(&plan, &file, attribs, stride);
+    return laser_file_read_range(&file, &plan, points, 0, LASER_ALL_POINTS);
+}
+
+/*
+ *  Default versions are 1.2 for formats 0 - 3 and the version that introduced the format after that, older ones must
+ *  be refused. Formats 6 - 10 must set the WKT bit of the global encoding.
+ */
+static int test_versions(TestSink* sink, uint32_t format) {
+    static const uint32_t versions[11] = { 2, 2, 2, 2, 3, 3, 4, 4, 4, 4, 4 };
+    laserWriterInfo info;
+    test_info(&info, format, 0);
+    uint8_t buffer[TEST_BUFFER_SIZE];
+    laserWriter writer;
+    sink->size = 0;
+    laser_writer_begin(&writer, &info, buffer, sizeof(buffer), test_sink_write, sink);
+    if(laser_writer_finish(&writer) != LASER_SUCCESS || sink->size < 227 || sink->data[25] != versions[format] ||
+            ((sink->data[6] >> 4) & 1) != (format >= 6)) {
+        return 0;
+    }
+
+    info.version_minor = format >= 4 ? versions[format] - 1: 0;
+    return !info.version_minor || laser_writer_begin(&writer, &info, buffer, sizeof(buffer), test_sink_write, sink) == LASER_ERROR_FORMAT_UNSUPPORTED;
+}
+
+/* Ranges whose end wraps past 2^64 must be rejected before anything is read. */
+static int test_ranges(const TestSink* sink, const laserAttrib* attribs, uint64_t stride, uint8_t* points) {
+    static const uint64_t ranges[][2] = { { UINT64_MAX - 1000000, 1000002 }, { 1, UINT64_MAX }, { UINT64_MAX, 2 } };
+    laserFile file;
+    if(laser_open_from_mem(&file, sink->data, sink->size) != LASER_SUCCESS) {
+        return 0;
+    }
+    laserPlan plan;
+    laser_plan_attribs(&plan, &file, attribs, stride);
+    for(uint32_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        if(laser_file_read_range(&file, &plan, points, ranges[i][0], ranges[i][1]) != LASER_ERROR_INVALID_RANGE) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+typedef enum TestLayout {
+    TEST_ATTRIBS,
+    TEST_COLUMNS,
+    TEST_DOUBLE_XYZ
+} TestLayout;
+
+static const char* TEST_LAYOUT_NAMES[] = { "attribs", "columns", "double xyz" };
+
+/* Writes `points` (the packed layout of `attribs`) through `layout` in uneven batches. */
+static laserResult test_write(TestSink* sink, uint32_t format, TestLayout layout, const laserAttrib* attribs, uint64_t stride, const uint8_t* points, uint64_t count, uint8_t* scratch) {
+    laserAttrib wide[TEST_MAX_ATTRIBS + 1];
+    laserColumn columns[TEST_MAX_ATTRIBS + 1];
+    uint64_t wide_stride = test_attribs(wide, format, 8);
+    uint32_t attrib_count = 0;
+    for(uint64_t offset = 0; attribs[attrib_count].type != LASER_ATTRIB_TYPE_NONE; attrib_count++) {
+        uint64_t size = test_type_size(attribs[attrib_count].type);
+        columns[attrib_count].type = attribs[attrib_count].type;
+        columns[attrib_count].data = scratch + offset;
+        columns[attrib_count].stride = LASER_DEFAULT_STRIDE;
+        offset += count * size;
+    }
+    columns[attrib_count].type = LASER_ATTRIB_TYPE_NONE;
+
+    /* Columns and the double layout are filled from the packed points. */
+    for(uint64_t i = 0; i < count; i++) {
+        const uint8_t* point = points + i * stride;
+        for(uint32_t j = 0; j < attrib_count; j++) {
+            uint64_t size = test_type_size(attribs[j].type);
+            if(layout == TEST_COLUMNS) {
+                memcpy((uint8_t*) columns[j].data + i * size, point + attribs[j].offset, size);
+            } else if(layout == TEST_DOUBLE_XYZ && j < 3) {
+                float value;
+                memcpy(&value, point + attribs[j].offset, 4);
+                double widened = value;
+                memcpy(scratch + i * wide_stride + wide[j].offset, &widened, 8);
+            } else if(layout == TEST_DOUBLE_XYZ) {
+                memcpy(scratch + i * wide_stride + wide[j].offset, point + attribs[j].offset, size);
+            }
+        }
+    }
+
+    laserWriterInfo info;
+    test_info(&info, format, layout == TEST_DOUBLE_XYZ ? LASER_WRITER_DOUBLE_XYZ: 0);
+    uint8_t buffer[TEST_BUFFER_SIZE];
+    laserWriter writer;
+    sink->size = 0;
+    laserResult res = laser_writer_begin(&writer, &info, buffer, sizeof(buffer), test_sink_write, sink);
+    for(uint64_t first = 0, batch = 1; res == LASER_SUCCESS && first < count; first += batch, batch = batch * 3 + 1) {
+        batch = batch < count - first ? batch: count - first;
+        if(layout == TEST_ATTRIBS) {
+            res = laser_write_attribs(&writer, points + first * stride, stride, attribs, batch);
+        } else if(layout == TEST_DOUBLE_XYZ) {
+            res = laser_write_attribs(&writer, scratch + first * wide_stride, wide_stride, wide, batch);
+        } else {
+            laserColumn window[TEST_MAX_ATTRIBS + 1];
+            for(uint32_t j = 0; j <= attrib_count; j++) {
+                window[j] = columns[j];
+                window[j].data = j < attrib_count ? (uint8_t*) columns[j].data + first * test_type_size(columns[j].type): 0;
+            }
+            res = laser_write_columns(&writer, window, batch);
+        }
+    }
+    return res == LASER_SUCCESS ? laser_writer_finish(&writer): res;
+}
+
+/* The header bounds are the exact extremes, the float reads of them may round differently by a fraction of a step. */
+static int test_bounds(const laserInfo* info, const uint8_t* points, uint64_t stride, uint64_t count) {
+    float min[3] = { 1e30f, 1e30f, 1e30f }, max[3] = { -1e30f, -1e30f, -1e30f };
+    float header_min[3] = { info->min_x, info->min_y, info->min_z }, header_max[3] = { info->max_x, info->max_y, info->max_z };
+    float scale[3] = { info->scale_x, info->scale_y, info->scale_z };
+    for(uint64_t i = 0; i < count; i++) {
+        for(uint32_t axis = 0; axis < 3; axis++) {
+            float value;
+            memcpy(&value, points + i * stride + 4 * axis, 4);
+            min[axis] = value < min[axis] ? value: min[axis];
+            max[axis] = value > max[axis] ? value: max[axis];
+        }
+    }
+    for(uint32_t axis = 0; axis < 3; axis++) {
+        float tolerance = scale[axis] * 0.5f;
+        if(min[axis] - header_min[axis] > tolerance || header_min[axis] - min[axis] > tolerance ||
+                max[axis] - header_max[axis] > tolerance || header_max[axis] - max[axis] > tolerance) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, const char** argv) {
+    uint64_t count = argc > 1 ? strtoull(argv[1], 0, 10): 5003;
+    count = count < 1 ? 1: count;
+
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    TestSink source, sink;
+    source.capacity = sink.capacity = 4096 + count * 80;
+    source.data = (uint8_t*) malloc(source.capacity);
+    sink.data = (uint8_t*) malloc(sink.capacity);
+    uint8_t* expected = (uint8_t*) malloc(count * 128);
+    uint8_t* decoded = (uint8_t*) malloc(count * 128);
+    uint8_t* scratch = (uint8_t*) malloc(count * 128);
+
+    int failed = 0;
+    for(uint32_t format = 0; format <= 10; format++) {
+        laserAttrib attribs[TEST_MAX_ATTRIBS + 1];
+        uint64_t stride = test_attribs(attribs, format, 4);
+        laserInfo info;
+        source.size = 0;
+        laserResult res = test_source(&source, format, count, &state);
+        if(res != LASER_SUCCESS || (res = test_read(&source, attribs, stride, expected, &info)) != LASER_SUCCESS) {
+            printf("format %u: source failed, %s\n", format, laser_result_str(res));
+            failed = 1;
+            continue;
+        }
+
+        if(!test_versions(&sink, format)) {
+            printf("format %u: wrong version or global encoding\n", format);
+            failed = 1;
+        }
+        if(!test_ranges(&source, attribs, stride, decoded)) {
+            printf("format %u: wrapping range not rejected\n", format);
+            failed = 1;
+        }
+
+        uint32_t passed = 0;
+        for(uint32_t layout = TEST_ATTRIBS; layout <= TEST_DOUBLE_XYZ; layout++) {
+            memset(decoded, 0xA5, count * stride);
+            if((res = test_write(&sink, format, (TestLayout) layout, attribs, stride, expected, count, scratch)) != LASER_SUCCESS ||
+                    (res = test_read(&sink, attribs, stride, decoded, &info)) != LASER_SUCCESS) {
+                printf("format %u, %s: %s\n", format, TEST_LAYOUT_NAMES[layout], laser_result_str(res));
+                failed = 1;
+                continue;
+            }
+
+            uint64_t mismatch = count;
+            for(uint64_t i = 0; i < count && mismatch == count; i++) {
+                mismatch = memcmp(expected + i * stride, decoded + i * stride, stride) ? i: count;
+            }
+            if(mismatch < count) {
+                for(uint32_t j = 0; attribs[j].type != LASER_ATTRIB_TYPE_NONE; j++) {
+                    uint64_t offset = mismatch * stride + attribs[j].offset;
+                    if(memcmp(expected + offset, decoded + offset, test_type_size(attribs[j].type))) {
+                        printf("format %u, %s: point %llu, attribute %d differs\n", format, TEST_LAYOUT_NAMES[layout], (unsigned long long) mismatch, (int) attribs[j].type);
+                        break;
+                    }
+                }
+                failed = 1;
+            } else if(info.point_count != count || !test_bounds(&info, decoded, stride, count)) {
+                printf("format %u, %s: header doesn't match the points\n", format, TEST_LAYOUT_NAMES[layout]);
+                failed = 1;
+            } else {
+                passed++;
+            }
+        }
+        printf("format %u: %u of 3 layouts round trip %llu points\n", format, passed, (unsigned long long) count);
+    }
+
+    free(source.data);
+    free(sink.data);
+    free(expected);
+    free(decoded);
+    free(scratch);
+    return failed;
+}